@@ -0,0 +1,317 @@
+#include "body_parser.h"
+
+namespace {
+
+const int MAX_NESTING = 64;
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+struct Cursor {
+    const char* pos;
+    const char* end;
+    
+    bool atEnd() const { return pos == end; }
+    
+    void skipSpace() {
+        while (pos != end && isSpace(*pos)) ++pos;
+    }
+    
+    bool consume(char c) {
+        if (pos != end && *pos == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+    
+    bool literal(std::string_view word) {
+        if ((size_t)(end - pos) < word.size() || std::string_view(pos, word.size()) != word) {
+            return false;
+        }
+        pos += word.size();
+        return true;
+    }
+    
+    // Opening quote already consumed; leaves pos after the closing quote
+    bool string(std::string_view& out, bool& escaped) {
+        const char* start = pos;
+        escaped = false;
+        while (pos != end) {
+            unsigned char c = (unsigned char)*pos;
+            if (c == '"') {
+                out = std::string_view(start, pos - start);
+                ++pos;
+                return true;
+            }
+            if (c < 0x20) {
+                return false;
+            }
+            if (c == '\\') {
+                escaped = true;
+                if (++pos == end) return false;
+                switch (*pos) {
+                    case '"': case '\\': case '/':
+                    case 'b': case 'f': case 'n': case 'r': case 't':
+                        break;
+                    case 'u':
+                        if (end - pos < 5) return false;
+                        for (int i = 1; i <= 4; i++) {
+                            if (hexValue(pos[i]) < 0) return false;
+                        }
+                        pos += 4;
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            ++pos;
+        }
+        return false;
+    }
+    
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool number(std::string_view& out) {
+        const char* start = pos;
+        consume('-');
+        if (consume('0')) {
+            // No leading zeros
+        } else if (pos != end && isDigit(*pos)) {
+            while (pos != end && isDigit(*pos)) ++pos;
+        } else {
+            return false;
+        }
+        if (consume('.')) {
+            if (pos == end || !isDigit(*pos)) return false;
+            while (pos != end && isDigit(*pos)) ++pos;
+        }
+        if (pos != end && (*pos == 'e' || *pos == 'E')) {
+            ++pos;
+            if (!consume('+')) consume('-');
+            if (pos == end || !isDigit(*pos)) return false;
+            while (pos != end && isDigit(*pos)) ++pos;
+        }
+        out = std::string_view(start, pos - start);
+        return true;
+    }
+    
+    // Skip an object or array whose opening bracket is at pos. Strings inside
+    // are validated, brackets must balance; scalars are not checked further.
+    bool nested(std::string_view& out) {
+        const char* start = pos;
+        char stack[MAX_NESTING];
+        int depth = 0;
+        while (pos != end) {
+            char c = *pos++;
+            if (c == '{' || c == '[') {
+                if (depth == MAX_NESTING) return false;
+                stack[depth++] = (c == '{') ? '}' : ']';
+            } else if (c == '}' || c == ']') {
+                if (depth == 0 || stack[depth - 1] != c) return false;
+                if (--depth == 0) {
+                    out = std::string_view(start, pos - start);
+                    return true;
+                }
+            } else if (c == '"') {
+                std::string_view ignored;
+                bool escaped;
+                if (!string(ignored, escaped)) return false;
+            }
+        }
+        return false;
+    }
+};
+
+void appendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out += (char)codepoint;
+    } else if (codepoint < 0x800) {
+        out += (char)(0xC0 | (codepoint >> 6));
+        out += (char)(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += (char)(0xE0 | (codepoint >> 12));
+        out += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codepoint & 0x3F));
+    } else {
+        out += (char)(0xF0 | (codepoint >> 18));
+        out += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        out += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codepoint & 0x3F));
+    }
+}
+
+uint32_t readHex4(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hexValue(p[i]);
+        value = (value << 4) | (uint32_t)(digit < 0 ? 0 : digit);
+    }
+    return value;
+}
+
+}  // namespace
+
+bool BodyParser::parse(std::string_view body) {
+    if (!parseMembers(body)) {
+        count_ = 0;  // A rejected body exposes no fields
+        return false;
+    }
+    return true;
+}
+
+bool BodyParser::parseMembers(std::string_view body) {
+    count_ = 0;
+    Cursor in{body.data(), body.data() + body.size()};
+    
+    in.skipSpace();
+    if (!in.consume('{')) return false;
+    in.skipSpace();
+    
+    if (!in.consume('}')) {
+        while (true) {
+            if (!in.consume('"')) return false;
+            Field field;
+            bool keyEscaped;
+            if (!in.string(field.name, keyEscaped)) return false;
+            
+            in.skipSpace();
+            if (!in.consume(':')) return false;
+            in.skipSpace();
+            if (in.atEnd()) return false;
+            
+            field.escaped = false;
+            char c = *in.pos;
+            if (c == '"') {
+                ++in.pos;
+                field.type = BodyValueType::String;
+                if (!in.string(field.value, field.escaped)) return false;
+            } else if (c == '{' || c == '[') {
+                field.type = BodyValueType::Nested;
+                if (!in.nested(field.value)) return false;
+            } else if (c == 't' || c == 'f') {
+                field.type = BodyValueType::Bool;
+                const char* start = in.pos;
+                if (!in.literal("true") && !in.literal("false")) return false;
+                field.value = std::string_view(start, in.pos - start);
+            } else if (c == 'n') {
+                field.type = BodyValueType::Null;
+                if (!in.literal("null")) return false;
+                field.value = std::string_view();
+            } else {
+                field.type = BodyValueType::Number;
+                if (!in.number(field.value)) return false;
+            }
+            
+            if (count_ == MAX_FIELDS || find(field.name)) return false;
+            fields_[count_++] = field;
+            
+            in.skipSpace();
+            if (in.consume('}')) break;
+            if (!in.consume(',')) return false;
+            in.skipSpace();
+        }
+    }
+    
+    // Nothing but whitespace may follow the object
+    in.skipSpace();
+    return in.atEnd();
+}
+
+const BodyParser::Field* BodyParser::find(std::string_view name) const {
+    for (int i = 0; i < count_; i++) {
+        if (fields_[i].name == name) {
+            return &fields_[i];
+        }
+    }
+    return nullptr;
+}
+
+bool BodyParser::getInt(std::string_view name, int& out) const {
+    const Field* field = find(name);
+    if (!field || field->type != BodyValueType::Number) return false;
+    return parseInteger(field->value, out);
+}
+
+bool BodyParser::getBool(std::string_view name, bool& out) const {
+    const Field* field = find(name);
+    if (!field || field->type != BodyValueType::Bool) return false;
+    out = field->value == "true";
+    return true;
+}
+
+bool BodyParser::getRawString(std::string_view name, std::string_view& out, bool* escaped) const {
+    const Field* field = find(name);
+    if (!field || field->type != BodyValueType::String) return false;
+    out = field->value;
+    if (escaped) *escaped = field->escaped;
+    return true;
+}
+
+bool BodyParser::getString(std::string_view name, std::string& out) const {
+    const Field* field = find(name);
+    if (!field || field->type != BodyValueType::String) return false;
+    if (field->escaped) {
+        unescape(field->value, out);
+    } else {
+        out.assign(field->value.data(), field->value.size());
+    }
+    return true;
+}
+
+void BodyParser::unescape(std::string_view raw, std::string& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < raw.size()) {
+        char c = raw[i++];
+        if (c != '\\' || i == raw.size()) {
+            out += c;
+            continue;
+        }
+        
+        char e = raw[i++];
+        switch (e) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if (raw.size() - i < 4) return;
+                uint32_t codepoint = readHex4(raw.data() + i);
+                i += 4;
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    // High surrogate: combine with a following low surrogate
+                    if (raw.size() - i >= 6 && raw[i] == '\\' && raw[i + 1] == 'u') {
+                        uint32_t low = readHex4(raw.data() + i + 2);
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                            i += 6;
+                        } else {
+                            codepoint = 0xFFFD;
+                        }
+                    } else {
+                        codepoint = 0xFFFD;
+                    }
+                } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                    codepoint = 0xFFFD;  // Lone low surrogate
+                }
+                appendUtf8(out, codepoint);
+                break;
+            }
+            default:
+                out += e;  // \" \\ \/
+        }
+    }
+}
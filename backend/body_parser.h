@@ -0,0 +1,77 @@
+#ifndef BODY_PARSER_H
+#define BODY_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+
+// Parse a whole decimal integer (no sign for unsigned types, no whitespace,
+// no trailing characters). Returns false on garbage or overflow.
+template <typename T>
+bool parseInteger(std::string_view text, T& out) {
+    if (text.empty()) return false;
+    T value{};
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+enum class BodyValueType : uint8_t {
+    String,
+    Number,
+    Bool,
+    Null,
+    Nested   // Object or array: validated and skipped, not readable
+};
+
+// Single-pass parser for the flat JSON objects our POST endpoints accept,
+// e.g. {"x":3,"y":7,"color":2,"sessionId":"..."}. Members are recorded as
+// string_views into the body (fixed-size table, no heap allocation); numbers
+// are converted on lookup with std::from_chars. Any syntax error, duplicate
+// key or more than MAX_FIELDS members makes parse() fail so the handler can
+// answer 400 instead of throwing.
+class BodyParser {
+public:
+    static const int MAX_FIELDS = 16;
+    
+    BodyParser() : count_(0) {}
+    
+    bool parse(std::string_view body);
+    
+    bool has(std::string_view name) const { return find(name) != nullptr; }
+    
+    // False if the member is missing, has another type or is out of range
+    bool getInt(std::string_view name, int& out) const;
+    bool getBool(std::string_view name, bool& out) const;
+    
+    // Raw string contents between the quotes, still escaped. escaped is set
+    // when the slice contains a backslash and needs unescape().
+    bool getRawString(std::string_view name, std::string_view& out, bool* escaped = nullptr) const;
+    
+    // Unescaped copy of a string member (reuses out's capacity)
+    bool getString(std::string_view name, std::string& out) const;
+    
+    // Decode JSON escapes (\n, \", \uXXXX incl. surrogate pairs -> UTF-8)
+    // from a raw string slice. The slice has already been validated by parse().
+    static void unescape(std::string_view raw, std::string& out);
+    
+private:
+    struct Field {
+        std::string_view name;
+        std::string_view value;
+        BodyValueType type;
+        bool escaped;
+    };
+    
+    Field fields_[MAX_FIELDS];
+    int count_;
+    
+    bool parseMembers(std::string_view body);
+    const Field* find(std::string_view name) const;
+};
+
+#endif
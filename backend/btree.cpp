@@ -1,110 +1,135 @@
 #include "btree.h"
 
-BTree::BTree(int order) : order_(order), root_(nullptr) {
-    root_ = std::make_shared<BTreeNode>(true);
-}
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BTREE_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
-BTree::~BTree() {
-}
+#ifdef BTREE_X86_SIMD
 
-void BTree::insert(uint32_t key, int value) {
-    if (root_->keys.size() == (size_t)(order_ - 1)) {
-        // Root is full, need to split
-        auto newRoot = std::make_shared<BTreeNode>(false);
-        newRoot->children.push_back(root_);
-        splitChild(newRoot, 0);
-        root_ = newRoot;
+// There is no unsigned compare below AVX-512: k <= key exactly when
+// min(k, key) == k, and k < key when max(k, key) != k. Lanes past `count` are
+// masked off the movemask before the popcount.
+
+__attribute__((target("sse4.1,popcnt")))
+uint32_t NodeSearch::SSE41::countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key) {
+    __m128i needle = _mm_set1_epi32((int)key);
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count; i += 4) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        __m128i le = _mm_cmpeq_epi32(_mm_min_epu32(k, needle), k);
+        uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(le));
+        if (count - i < 4) {
+            bits &= (1u << (count - i)) - 1;
+        }
+        pos += (uint32_t)__builtin_popcount(bits);
     }
-    
-    insertNonFull(root_, key, value);
+    return pos;
 }
 
-int BTree::search(uint32_t key) {
-    return searchNode(root_, key);
+__attribute__((target("sse4.1,popcnt")))
+uint32_t NodeSearch::SSE41::countLess(const uint32_t* keys, uint32_t count, uint32_t key) {
+    __m128i needle = _mm_set1_epi32((int)key);
+    uint32_t notLess = 0;
+    for (uint32_t i = 0; i < count; i += 4) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        __m128i ge = _mm_cmpeq_epi32(_mm_max_epu32(k, needle), k);
+        uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(ge));
+        if (count - i < 4) {
+            bits &= (1u << (count - i)) - 1;
+        }
+        notLess += (uint32_t)__builtin_popcount(bits);
+    }
+    return count - notLess;
 }
 
-void BTree::remove(uint32_t key) {
-    // Simplified remove - not fully implemented for prototype
-    // In production, implement full B-Tree deletion
+__attribute__((target("avx2,popcnt")))
+uint32_t NodeSearch::AVX2::countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key) {
+    __m256i needle = _mm256_set1_epi32((int)key);
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i le = _mm256_cmpeq_epi32(_mm256_min_epu32(k, needle), k);
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(le));
+        if (count - i < 8) {
+            bits &= (1u << (count - i)) - 1;
+        }
+        pos += (uint32_t)__builtin_popcount(bits);
+    }
+    return pos;
 }
 
-void BTree::insertNonFull(std::shared_ptr<BTreeNode> node, uint32_t key, int value) {
-    int i = (int)node->keys.size() - 1;
-    
-    if (node->isLeaf) {
-        // Insert into leaf node
-        node->keys.push_back(0);
-        node->values.push_back(0);
-        
-        while (i >= 0 && key < node->keys[i]) {
-            node->keys[i + 1] = node->keys[i];
-            node->values[i + 1] = node->values[i];
-            i--;
-        }
-        
-        node->keys[i + 1] = key;
-        node->values[i + 1] = value;
-    } else {
-        // Find child to insert into
-        while (i >= 0 && key < node->keys[i]) {
-            i--;
+__attribute__((target("avx2,popcnt")))
+uint32_t NodeSearch::AVX2::countLess(const uint32_t* keys, uint32_t count, uint32_t key) {
+    __m256i needle = _mm256_set1_epi32((int)key);
+    uint32_t notLess = 0;
+    for (uint32_t i = 0; i < count; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(k, needle), k);
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(ge));
+        if (count - i < 8) {
+            bits &= (1u << (count - i)) - 1;
         }
-        i++;
-        
-        if (node->children[i]->keys.size() == (size_t)(order_ - 1)) {
-            splitChild(node, i);
-            
-            if (key > node->keys[i]) {
-                i++;
-            }
-        }
-        
-        insertNonFull(node->children[i], key, value);
+        notLess += (uint32_t)__builtin_popcount(bits);
     }
+    return count - notLess;
 }
 
-void BTree::splitChild(std::shared_ptr<BTreeNode> parent, int index) {
-    auto fullChild = parent->children[index];
-    auto newChild = std::make_shared<BTreeNode>(fullChild->isLeaf);
-    
-    int mid = order_ / 2;
-    
-    // Move half of keys to new node
-    newChild->keys.assign(fullChild->keys.begin() + mid + 1, fullChild->keys.end());
-    newChild->values.assign(fullChild->values.begin() + mid + 1, fullChild->values.end());
-    
-    if (!fullChild->isLeaf) {
-        newChild->children.assign(fullChild->children.begin() + mid + 1, fullChild->children.end());
-        fullChild->children.resize(mid + 1);
-    }
-    
-    // Move middle key up to parent
-    parent->keys.insert(parent->keys.begin() + index, fullChild->keys[mid]);
-    parent->values.insert(parent->values.begin() + index, fullChild->values[mid]);
-    parent->children.insert(parent->children.begin() + index + 1, newChild);
-    
-    // Truncate original child
-    fullChild->keys.resize(mid);
-    fullChild->values.resize(mid);
+#else
+
+// Never picked without x86 SIMD; defined so every tree instantiation links
+uint32_t NodeSearch::SSE41::countLess(const uint32_t* keys, uint32_t count, uint32_t key) {
+    return Scalar::countLess(keys, count, key);
+}
+
+uint32_t NodeSearch::SSE41::countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key) {
+    return Scalar::countLessEqual(keys, count, key);
 }
 
-int BTree::searchNode(std::shared_ptr<BTreeNode> node, uint32_t key) {
-    if (!node) {
-        return -1;
+uint32_t NodeSearch::AVX2::countLess(const uint32_t* keys, uint32_t count, uint32_t key) {
+    return Scalar::countLess(keys, count, key);
+}
+
+uint32_t NodeSearch::AVX2::countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key) {
+    return Scalar::countLessEqual(keys, count, key);
+}
+
+#endif
+
+namespace {
+
+NodeSearch::Level detectLevel() {
+#ifdef BTREE_X86_SIMD
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("popcnt")) {
+        return NodeSearch::Level::Scalar;
     }
-    
-    int i = 0;
-    while (i < (int)node->keys.size() && key > node->keys[i]) {
-        i++;
+    if (__builtin_cpu_supports("avx2")) {
+        return NodeSearch::Level::AVX2;
     }
-    
-    if (i < (int)node->keys.size() && key == node->keys[i]) {
-        return node->values[i];
+    if (__builtin_cpu_supports("sse4.1")) {
+        return NodeSearch::Level::SSE41;
     }
-    
-    if (node->isLeaf) {
-        return -1;
+#endif
+    return NodeSearch::Level::Scalar;
+}
+
+}  // namespace
+
+const bool NodeSearch::avx2_ = NodeSearch::bestLevel() == NodeSearch::Level::AVX2;
+
+NodeSearch::Level NodeSearch::bestLevel() {
+    static const Level best = detectLevel();
+    return best;
+}
+
+const char* NodeSearch::name(Level level) {
+    switch (level) {
+        case Level::AVX2:
+            return "AVX2";
+        case Level::SSE41:
+            return "SSE4.1";
+        default:
+            return "scalar";
     }
-    
-    return searchNode(node->children[i], key);
-}
\ No newline at end of file
+}
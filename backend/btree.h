@@ -2,36 +2,284 @@
 #define BTREE_H
 
 #include <vector>
-#include <memory>
 #include <cstdint>
+#include <cstddef>
 
-// B-Tree node
-struct BTreeNode {
-    bool isLeaf;
-    std::vector<uint32_t> keys;
-    std::vector<int> values;
-    std::vector<std::shared_ptr<BTreeNode>> children;
+// Slot search inside a node: how many of the sorted keys[0..count) are below
+// `key`. Each kernel is a type, passed to BTree as its Search parameter, so
+// the tree calls it directly instead of through a pointer. Scalar is plain
+// C++ and inlines into the tree walk. SSE41 and AVX2 (compare, movemask,
+// popcount over packed keys) are compiled for those instruction sets only,
+// so they stay out-of-line, and must not be used above bestLevel(). They load
+// keys in whole vectors: `keys` must stay readable up to the next multiple of
+// 8 entries, and lanes past `count` are ignored.
+class NodeSearch {
+public:
+    enum class Level { Scalar, SSE41, AVX2 };
+    
+    struct Scalar {
+        static uint32_t countLess(const uint32_t* keys, uint32_t count, uint32_t key) {
+            uint32_t pos = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                pos += keys[i] < key;
+            }
+            return pos;
+        }
+        
+        static uint32_t countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key) {
+            uint32_t pos = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                pos += keys[i] <= key;
+            }
+            return pos;
+        }
+    };
+    
+    struct SSE41 {
+        static uint32_t countLess(const uint32_t* keys, uint32_t count, uint32_t key);
+        static uint32_t countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key);
+    };
     
-    BTreeNode(bool leaf = true) : isLeaf(leaf) {}
+    struct AVX2 {
+        static uint32_t countLess(const uint32_t* keys, uint32_t count, uint32_t key);
+        static uint32_t countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key);
+    };
+    
+    // AVX2 where the CPU has it (the one that beats Scalar in bench_btree,
+    // on trees that fit in cache), Scalar otherwise: a branch on a flag set
+    // at startup, and the scalar path still inlines
+    struct Best {
+        static uint32_t countLess(const uint32_t* keys, uint32_t count, uint32_t key) {
+            return avx2_ ? AVX2::countLess(keys, count, key) : Scalar::countLess(keys, count, key);
+        }
+        
+        static uint32_t countLessEqual(const uint32_t* keys, uint32_t count, uint32_t key) {
+            return avx2_ ? AVX2::countLessEqual(keys, count, key) : Scalar::countLessEqual(keys, count, key);
+        }
+    };
+    
+    static Level bestLevel();   // What this CPU supports
+    static const char* name(Level level);
+
+private:
+    static const bool avx2_;
 };
 
-// B-Tree implementation for indexing
+// B+ tree index from uint32_t keys to int values. Nodes live in one
+// contiguous arena and refer to each other by 32-bit index, so there is no
+// per-node allocation or reference counting, and lookups walk down from the
+// root without recursion. With the default fanout of 31 a node is four cache
+// lines: the keys and count in the first two, child or value slots in the
+// other two. Values sit in the leaves only; leaves are chained left to right.
+// Nodes are searched with NodeSearch::Best unless `Search` names another
+// kernel.
+template <uint32_t Fanout = 31, typename Search = NodeSearch::Best>
 class BTree {
+    static_assert(Fanout >= 3, "a node must hold at least three keys");
+    static_assert(Fanout < 65536, "key counts are 16-bit");
+
 public:
-    BTree(int order = 5);
-    ~BTree();
+    BTree() { clear(); }
+    
+    void clear() {
+        nodes_.clear();
+        root_ = allocate(true);
+    }
     
+    // Insert or replace
     void insert(uint32_t key, int value);
-    int search(uint32_t key);
+    
+    // Value for `key`, or -1
+    int search(uint32_t key) const {
+        uint32_t n = root_;
+        while (!nodes_[n].leaf) {
+            const Node& node = nodes_[n];
+            n = node.slots[upperBound(node, key)];
+        }
+        const Node& leaf = nodes_[n];
+        uint32_t pos = lowerBound(leaf, key);
+        return pos < leaf.count && leaf.keys[pos] == key ? (int)leaf.slots[pos] : -1;
+    }
+    
+    // Leaves are not merged when they shrink (the index only ever grows)
     void remove(uint32_t key);
     
+    size_t nodeCount() const { return nodes_.size(); }
+    size_t arenaBytes() const { return nodes_.size() * sizeof(Node); }
+
 private:
-    std::shared_ptr<BTreeNode> root_;
-    int order_;  // Maximum number of keys per node
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr int MAX_DEPTH = 32;
     
-    void insertNonFull(std::shared_ptr<BTreeNode> node, uint32_t key, int value);
-    void splitChild(std::shared_ptr<BTreeNode> parent, int index);
-    int searchNode(std::shared_ptr<BTreeNode> node, uint32_t key);
+    struct alignas(64) Node {
+        uint32_t keys[Fanout];
+        uint16_t count;
+        uint16_t leaf;
+        // Inner nodes: count + 1 children. Leaves: count values, then the
+        // next leaf in the last slot.
+        uint32_t slots[Fanout + 1];
+    };
+    
+    // NodeSearch reads keys in vectors of 8; the overrun stays inside the node
+    static_assert(sizeof(Node) >= (Fanout + 7) / 8 * 8 * sizeof(uint32_t), "node too small for vector loads");
+    
+    std::vector<Node> nodes_;
+    uint32_t root_;
+    
+    uint32_t allocate(bool leaf) {
+        Node node{};
+        node.leaf = leaf;
+        node.slots[Fanout] = NO_NODE;
+        nodes_.push_back(node);
+        return (uint32_t)(nodes_.size() - 1);
+    }
+    
+    // Keys < key (leaf position) and keys <= key (child to descend into)
+    static uint32_t lowerBound(const Node& node, uint32_t key) {
+        return Search::countLess(node.keys, node.count, key);
+    }
+    
+    static uint32_t upperBound(const Node& node, uint32_t key) {
+        return Search::countLessEqual(node.keys, node.count, key);
+    }
 };
 
-#endif
\ No newline at end of file
+template <uint32_t Fanout, typename Search>
+void BTree<Fanout, Search>::insert(uint32_t key, int value) {
+    // Walk down, remembering the path for splits
+    uint32_t path[MAX_DEPTH];
+    uint32_t childPos[MAX_DEPTH];
+    int depth = 0;
+    uint32_t n = root_;
+    while (!nodes_[n].leaf) {
+        uint32_t pos = upperBound(nodes_[n], key);
+        path[depth] = n;
+        childPos[depth++] = pos;
+        n = nodes_[n].slots[pos];
+    }
+    
+    uint32_t pos = lowerBound(nodes_[n], key);
+    if (pos < nodes_[n].count && nodes_[n].keys[pos] == key) {
+        nodes_[n].slots[pos] = (uint32_t)value;
+        return;
+    }
+    
+    // Insert into the leaf, splitting it in half if it is full. Node
+    // references are taken again after allocate(), which may move the arena.
+    uint32_t keys[Fanout + 1];
+    uint32_t slots[Fanout + 2];
+    {
+        Node& leaf = nodes_[n];
+        if (leaf.count < Fanout) {
+            for (uint32_t i = leaf.count; i > pos; --i) {
+                leaf.keys[i] = leaf.keys[i - 1];
+                leaf.slots[i] = leaf.slots[i - 1];
+            }
+            leaf.keys[pos] = key;
+            leaf.slots[pos] = (uint32_t)value;
+            ++leaf.count;
+            return;
+        }
+        for (uint32_t i = 0, j = 0; i <= Fanout; ++i) {
+            bool inserted = i == pos;
+            keys[i] = inserted ? key : leaf.keys[j];
+            slots[i] = inserted ? (uint32_t)value : leaf.slots[j];
+            j += !inserted;
+        }
+    }
+    uint32_t right = allocate(true);
+    Node& leaf = nodes_[n];
+    Node& sibling = nodes_[right];
+    uint32_t half = (Fanout + 1) / 2;
+    leaf.count = (uint16_t)half;
+    sibling.count = (uint16_t)(Fanout + 1 - half);
+    for (uint32_t i = 0; i < half; ++i) {
+        leaf.keys[i] = keys[i];
+        leaf.slots[i] = slots[i];
+    }
+    for (uint32_t i = 0; i < sibling.count; ++i) {
+        sibling.keys[i] = keys[half + i];
+        sibling.slots[i] = slots[half + i];
+    }
+    sibling.slots[Fanout] = leaf.slots[Fanout];
+    leaf.slots[Fanout] = right;
+    uint32_t separator = sibling.keys[0];
+    
+    // Push the separator up, splitting inner nodes as needed
+    while (depth > 0) {
+        uint32_t parent = path[--depth];
+        uint32_t at = childPos[depth];
+        {
+            Node& node = nodes_[parent];
+            if (node.count < Fanout) {
+                for (uint32_t i = node.count; i > at; --i) {
+                    node.keys[i] = node.keys[i - 1];
+                    node.slots[i + 1] = node.slots[i];
+                }
+                node.keys[at] = separator;
+                node.slots[at + 1] = right;
+                ++node.count;
+                return;
+            }
+            for (uint32_t i = 0, j = 0; i <= Fanout; ++i) {
+                bool inserted = i == at;
+                keys[i] = inserted ? separator : node.keys[j];
+                j += !inserted;
+            }
+            for (uint32_t i = 0, j = 0; i <= Fanout + 1; ++i) {
+                bool inserted = i == at + 1;
+                slots[i] = inserted ? right : node.slots[j];
+                j += !inserted;
+            }
+        }
+        
+        // The middle key moves up; the halves keep the keys on either side
+        uint32_t newRight = allocate(false);
+        Node& node = nodes_[parent];
+        Node& sibling = nodes_[newRight];
+        uint32_t mid = (Fanout + 1) / 2;
+        node.count = (uint16_t)mid;
+        sibling.count = (uint16_t)(Fanout - mid);
+        for (uint32_t i = 0; i < mid; ++i) {
+            node.keys[i] = keys[i];
+            node.slots[i] = slots[i];
+        }
+        node.slots[mid] = slots[mid];
+        for (uint32_t i = 0; i < sibling.count; ++i) {
+            sibling.keys[i] = keys[mid + 1 + i];
+            sibling.slots[i] = slots[mid + 1 + i];
+        }
+        sibling.slots[sibling.count] = slots[Fanout + 1];
+        separator = keys[mid];
+        right = newRight;
+    }
+    
+    // The root split: grow the tree by one level
+    uint32_t oldRoot = root_;
+    root_ = allocate(false);
+    Node& root = nodes_[root_];
+    root.count = 1;
+    root.keys[0] = separator;
+    root.slots[0] = oldRoot;
+    root.slots[1] = right;
+}
+
+template <uint32_t Fanout, typename Search>
+void BTree<Fanout, Search>::remove(uint32_t key) {
+    uint32_t n = root_;
+    while (!nodes_[n].leaf) {
+        n = nodes_[n].slots[upperBound(nodes_[n], key)];
+    }
+    Node& leaf = nodes_[n];
+    uint32_t pos = lowerBound(leaf, key);
+    if (pos >= leaf.count || leaf.keys[pos] != key) {
+        return;
+    }
+    for (uint32_t i = pos + 1; i < leaf.count; ++i) {
+        leaf.keys[i - 1] = leaf.keys[i];
+        leaf.slots[i - 1] = leaf.slots[i];
+    }
+    --leaf.count;
+}
+
+#endif
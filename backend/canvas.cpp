@@ -1,7 +1,9 @@
 #include "canvas.h"
 #include "snapshot.h"
+#include "episode_archive.h"
+#include "event_hub.h"
+#include "logger.h"
 #include <filesystem>
-#include <iostream>
 #include <algorithm>
 #include <chrono>
 #include <vector>
@@ -9,31 +11,31 @@
 namespace fs = std::filesystem;
 
 // Constants
-const int CANVAS_SIZE = 50;
 const int EPISODE_DURATION = 900;  // 15 minutes in seconds
 const int USER_COOLDOWN = 5;       // 5 seconds
 const int GUEST_COOLDOWN = 10;     // 10 seconds
 const int SEASON_INTERVAL = 180;   // 3 minutes
-const int SNAPSHOT_INTERVAL = 10;  // 10 seconds
+const int SNAPSHOT_INTERVAL = 10;  // Replay frame spacing, 10 seconds
+const int KEYFRAME_INTERVAL = 10;  // Time-travel queries replay at most this many seconds of placements
 const int FREEZE_DURATION = 10;    // 10 seconds
+const int COOLDOWN_SWEEP_INTERVAL = 60;  // Drop lapsed cooldown entries every minute
+const size_t MAX_DELTA_CELLS = 4096;  // Larger deltas fall back to a full resync
 
-Canvas::Canvas(Database* db)
-    : db_(db), running_(false), episodeNumber_(1), episodeStartTime_(0),
-      episodeFrozen_(false), currentSeason_(Season::Calm) {
-    
-    // Initialize canvas
-    canvas_.resize(CANVAS_SIZE);
-    for (int i = 0; i < CANVAS_SIZE; ++i) {
-        canvas_[i].resize(CANVAS_SIZE);
-        for (int j = 0; j < CANVAS_SIZE; ++j) {
-            canvas_[i][j] = {j, i, 15, PixelMood::Calm, 0, 0};  // White, calm
-        }
+// Marks a stripe whose writer has not yet drawn its version
+const uint64_t VERSION_PENDING = UINT64_MAX;
+
+Canvas::Canvas(Database* db, Scheduler* scheduler, int width, int height)
+    : db_(db), scheduler_(scheduler), events_(nullptr), running_(false), episodeTimer_(0), canvas_(width, height), version_(1), resetVersion_(1), episodeNumber_(1),
+      episodeStartTime_(0), phase_(EpisodePhase::Active), freezeStartTime_(0), currentSeason_(Season::Calm), timeline_(width, height) {
+}
+
+const char* episodePhaseName(EpisodePhase phase) {
+    switch (phase) {
+        case EpisodePhase::Active: return "active";
+        case EpisodePhase::Frozen: return "frozen";
+        case EpisodePhase::Resetting: return "resetting";
+        default: return "active";
     }
-    
-    // Initialize quests
-    quests_.push_back({"Place 40 blue pixels", 0, 40, false});
-    quests_.push_back({"Fill top-left 10x10 area", 0, 100, false});
-    quests_.push_back({"Place 20 calm pixels", 0, 20, false});
 }
 
 Canvas::~Canvas() {
@@ -43,36 +45,48 @@ Canvas::~Canvas() {
 void Canvas::start() {
     running_ = true;
     episodeStartTime_ = getCurrentTime();
+    timeline_.reset(episodeNumber_, episodeStartTime_);
     
-    episodeThread_ = std::thread(&Canvas::episodeLoop, this);
-    seasonThread_ = std::thread(&Canvas::seasonLoop, this);
-    snapshotThread_ = std::thread(&Canvas::snapshotLoop, this);
+    armEpisodeTimer("episode-end", EPISODE_DURATION, &Canvas::freezeEpisode);
+    {
+        std::lock_guard lock(timersMutex_);
+        periodicTimers_.push_back(scheduler_->scheduleEvery(
+            "season", std::chrono::seconds(SEASON_INTERVAL), [this] { advanceSeason(); }));
+        periodicTimers_.push_back(scheduler_->scheduleEvery(
+            "keyframe", std::chrono::seconds(KEYFRAME_INTERVAL), [this] { buildKeyframe(); }, JobMode::Worker));
+        periodicTimers_.push_back(scheduler_->scheduleEvery(
+            "cooldown-expiry", std::chrono::seconds(COOLDOWN_SWEEP_INTERVAL), [this] { expireCooldowns(); },
+            JobMode::Worker));
+    }
     
-    std::cout << "Canvas started. Episode " << episodeNumber_ << " begins!" << std::endl;
+    LOG_INFO("Canvas started. Episode ", episodeNumber_.load(), " begins!");
 }
 
 void Canvas::stop() {
     running_ = false;
-    cv_.notify_all();
     
-    if (episodeThread_.joinable()) episodeThread_.join();
-    if (seasonThread_.joinable()) seasonThread_.join();
-    if (snapshotThread_.joinable()) snapshotThread_.join();
+    // Only the timers are cancelled: a running episode step and a queued
+    // episode export are due one-shots, which Scheduler::stop still runs
+    std::lock_guard lock(timersMutex_);
+    scheduler_->cancel(episodeTimer_);
+    for (auto id : periodicTimers_) {
+        scheduler_->cancel(id);
+    }
+    periodicTimers_.clear();
 }
 
 bool Canvas::placePixel(int x, int y, uint8_t color, uint8_t mood, uint32_t userId, bool isLoggedIn) {
-    std::cerr << "[Canvas] placePixel called x=" << x << " y=" << y << " color=" << (int)color << " uid=" << userId << " loggedIn=" << isLoggedIn << std::endl;
-    std::lock_guard lock(canvasMutex_);
+    LOG_DEBUG("[Canvas] placePixel called x=", x, " y=", y, " color=", (int)color, " uid=", userId, " loggedIn=", isLoggedIn);
     
-    // Check if episode is frozen
-    if (episodeFrozen_) {
-        std::cerr << "[Canvas] placePixel failed: episode frozen" << std::endl;
+    // Only an active episode accepts pixels
+    if (phase_ != EpisodePhase::Active) {
+        LOG_DEBUG("[Canvas] placePixel failed: episode frozen");
         return false;
     }
     
     // Check bounds
-    if (x < 0 || x >= CANVAS_SIZE || y < 0 || y >= CANVAS_SIZE) {
-        std::cerr << "[Canvas] placePixel failed: out of bounds" << std::endl;
+    if (!canvas_.contains(x, y)) {
+        LOG_DEBUG("[Canvas] placePixel failed: out of bounds");
         return false;
     }
     
@@ -80,75 +94,163 @@ bool Canvas::placePixel(int x, int y, uint8_t color, uint8_t mood, uint32_t user
     uint64_t now = getCurrentTime();
     int cooldown = isLoggedIn ? USER_COOLDOWN : GUEST_COOLDOWN;
     
-    auto it = cooldowns_.find(userId);
-    if (it != cooldowns_.end()) {
-        if (now - it->second < (uint64_t)cooldown) {
-            std::cerr << "[Canvas] placePixel failed: cooldown active" << std::endl;
-            return false;  // Still in cooldown
-        }
+    if (!cooldowns_.tryAcquire(userId, now, cooldown)) {
+        LOG_DEBUG("[Canvas] placePixel failed: cooldown active");
+        return false;  // Still in cooldown
     }
     
-    // Place pixel
-    canvas_[y][x] = Pixel{x, y, color, static_cast<PixelMood>(mood), now, userId};
-    cooldowns_[userId] = now;
+    // Place pixel; only placements hashing to the same stripe serialize here,
+    // and readers never wait on it
+    {
+        Stripe& stripe = stripeFor(canvas_.tileIndex(x, y));
+        std::lock_guard lock(stripe.lock);
+        
+        // Re-check under the lock: freezeEpisode switches phase before taking every stripe
+        if (phase_ != EpisodePhase::Active) {
+            LOG_DEBUG("[Canvas] placePixel failed: episode frozen");
+            return false;
+        }
+        uint64_t version = beginWrite(stripe);
+        canvas_.set(x, y, color, static_cast<PixelMood>(mood), now, userId, version);
+        timeline_.record(x, y, color, static_cast<PixelMood>(mood), userId);
+        endWrite(stripe);
+        
+        // Queued under the stripe lock (an append; the fan-out to streams runs
+        // on the dispatcher), so placements on one cell reach the hub in
+        // version order and a coalesced cell always ends on the newest
+        if (events_) {
+            events_->publishPixel({x, y, color, static_cast<PixelMood>(mood), now, userId}, version);
+        }
+    }
     
     // Update quests
-    updateQuests(x, y, color, static_cast<PixelMood>(mood));
-
-    std::cerr << "[Canvas] placePixel success x=" << x << " y=" << y << " uid=" << userId << std::endl;
+    bool questsChanged = quests_.record(x, y, color, static_cast<PixelMood>(mood));
+    
+    if (events_ && questsChanged) {
+        events_->publishQuests(quests_.getQuests());
+    }
+    
+    LOG_DEBUG("[Canvas] placePixel success x=", x, " y=", y, " uid=", userId);
     return true;
 }
 
 std::vector<Pixel> Canvas::getRegion(int x, int y, int width, int height) {
-    std::cerr << "[Canvas] getRegion called x=" << x << " y=" << y << " w=" << width << " h=" << height << std::endl;
-    std::lock_guard lock(canvasMutex_);
+    LOG_DEBUG("[Canvas] getRegion called x=", x, " y=", y, " w=", width, " h=", height);
     
+    // Lock-free: each tile is read under its seqlock and retried if a write overlapped
     std::vector<Pixel> result;
+    canvas_.appendRegion(x, y, width, height, result);
+    LOG_DEBUG("[Canvas] getRegion returning ", result.size(), " pixels");
+    return result;
+}
+
+// Draw the next canvas version for a write under `stripe` (caller holds stripe.lock).
+// The stripe advertises VERSION_PENDING before the draw, so a reader that loads
+// version_ after the draw is guaranteed to see this write as pending.
+uint64_t Canvas::beginWrite(Stripe& stripe) {
+    stripe.pendingVersion.store(VERSION_PENDING);
+    uint64_t version = version_.fetch_add(1) + 1;
+    stripe.pendingVersion.store(version);
+    return version;
+}
+
+void Canvas::endWrite(Stripe& stripe) {
+    stripe.pendingVersion.store(0, std::memory_order_release);
+}
+
+uint64_t Canvas::getVersion() {
+    uint64_t current = version_.load();
     
-    int endX = std::min(x + width, CANVAS_SIZE);
-    int endY = std::min(y + height, CANVAS_SIZE);
-    
-    for (int j = y; j < endY; ++j) {
-        for (int i = x; i < endX; ++i) {
-            result.push_back(canvas_[j][i]);
+    // Wait out writes that already drew a version <= current; writes that start
+    // later draw a higher version and are picked up by the next delta
+    for (auto& stripe : stripes_) {
+        for (;;) {
+            uint64_t pending = stripe.pendingVersion.load(std::memory_order_acquire);
+            if (pending == 0 || (pending != VERSION_PENDING && pending > current)) {
+                break;
+            }
+            std::this_thread::yield();
         }
     }
-    std::cerr << "[Canvas] getRegion returning " << result.size() << " pixels" << std::endl;
-    return result;
+    return current;
 }
 
-std::vector<Pixel> Canvas::getAllPixels() {
-    std::cerr << "[Canvas] getAllPixels called" << std::endl;
-    std::lock_guard lock(canvasMutex_);
-    return getAllPixelsUnlocked();
+CanvasDelta Canvas::getDelta(uint64_t since, int x, int y, int width, int height) {
+    CanvasDelta delta;
+    delta.version = getVersion();
+    delta.fullResync = false;
+    
+    // Unknown cursor, a cursor from before the last reset, or one from a previous server run
+    if (since == 0 || since < resetVersion_.load() || since > delta.version) {
+        delta.fullResync = true;
+        return delta;
+    }
+    
+    if (!canvas_.appendChanges(since, x, y, width, height, MAX_DELTA_CELLS, delta.pixels)) {
+        delta.fullResync = true;
+        delta.pixels.clear();
+    }
+    LOG_DEBUG("[Canvas] getDelta since=", since, " version=", delta.version, " changed=", delta.pixels.size(), " resync=", delta.fullResync);
+    return delta;
 }
 
-// Assumes caller already holds `canvasMutex_` if needed. Copies current canvas state without locking.
-std::vector<Pixel> Canvas::getAllPixelsUnlocked() {
-    std::vector<Pixel> result;
-    result.reserve(CANVAS_SIZE * CANVAS_SIZE);
-    for (int j = 0; j < CANVAS_SIZE; ++j) {
-        for (int i = 0; i < CANVAS_SIZE; ++i) {
-            result.push_back(canvas_[j][i]);
-        }
+// Take every stripe in index order (writers only ever hold one)
+std::array<std::unique_lock<std::mutex>, Canvas::LOCK_STRIPES> Canvas::lockAllTiles() {
+    std::array<std::unique_lock<std::mutex>, LOCK_STRIPES> locks;
+    for (int i = 0; i < LOCK_STRIPES; ++i) {
+        locks[i] = std::unique_lock<std::mutex>(stripes_[i].lock);
     }
-    return result;
+    return locks;
 }
 
 EpisodeInfo Canvas::getEpisodeInfo() {
-    std::lock_guard lock(canvasMutex_);
-    
     uint64_t now = getCurrentTime();
-    int elapsed = now - episodeStartTime_;
-    int remaining = std::max(0, EPISODE_DURATION - elapsed);
-    std::cerr << "[Canvas] getEpisodeInfo called remaining=" << remaining << " episode=" << episodeNumber_ << std::endl;
+    EpisodePhase phase = phase_;
+    uint32_t episode = episodeNumber_;
+    
+    int remaining = 0;
+    int freezeRemaining = 0;
+    if (phase == EpisodePhase::Active) {
+        int elapsed = now - episodeStartTime_;
+        remaining = std::max(0, EPISODE_DURATION - elapsed);
+    } else {
+        int frozenFor = now - freezeStartTime_;
+        freezeRemaining = std::max(0, FREEZE_DURATION - frozenFor);
+    }
+    LOG_DEBUG("[Canvas] getEpisodeInfo called remaining=", remaining, " episode=", episode,
+              " phase=", episodePhaseName(phase));
+    
+    bool active = phase == EpisodePhase::Active;
+    return {episode, remaining, active, !active, phase, freezeRemaining};
+}
+
+std::vector<SnapshotHandle> Canvas::getSnapshots(const EpisodeTimeline::Capture& capture) const {
+    return timeline_.sample(capture, (uint64_t)SNAPSHOT_INTERVAL * 1000);
+}
 
-    return {episodeNumber_, remaining, !episodeFrozen_, episodeFrozen_};
+uint64_t Canvas::getSnapshotCount(const EpisodeTimeline::Capture& capture) {
+    // sample() emits a frame at every whole interval before the end, plus the end
+    uint64_t intervalMs = (uint64_t)SNAPSHOT_INTERVAL * 1000;
+    uint64_t durationMs = capture.durationMs;
+    return (durationMs > 0 ? (durationMs - 1) / intervalMs : 0) + 1;
 }
 
-std::vector<std::vector<Pixel>> Canvas::getSnapshots() {
-    std::lock_guard lock(canvasMutex_);
-    return snapshots_;
+bool Canvas::getArchivedSnapshots(uint32_t episode, std::vector<SnapshotHandle>& frames) {
+    EpisodeArchive archive;
+    return archive.open(EpisodeArchive::pathFor(episode)) &&
+           archive.sample((uint64_t)SNAPSHOT_INTERVAL * 1000, frames);
+}
+
+bool Canvas::getArchivedFrame(uint32_t episode, PixelGrid& frame) {
+    EpisodeArchive archive;
+    TimelinePosition position;
+    return archive.open(EpisodeArchive::pathFor(episode)) &&
+           archive.boardAt(archive.info().durationMs, frame, position);
+}
+
+TimelinePosition Canvas::getRegionAt(uint64_t offsetMs, int x, int y, int width, int height,
+                                     std::vector<Pixel>& out) {
+    return timeline_.regionAt(offsetMs, x, y, width, height, out);
 }
 
 std::string Canvas::getCurrentSeason() {
@@ -162,8 +264,7 @@ std::string Canvas::getCurrentSeason() {
 }
 
 std::vector<Quest> Canvas::getQuests() {
-    std::lock_guard lock(canvasMutex_);
-    return quests_;
+    return quests_.getQuests();
 }
 
 void Canvas::addChatMessage(const std::string& username, const std::string& message) {
@@ -176,6 +277,10 @@ void Canvas::addChatMessage(const std::string& username, const std::string& mess
     if (chatMessages_.size() > 100) {
         chatMessages_.erase(chatMessages_.begin());
     }
+    
+    if (events_) {
+        events_->publishChat(msg);
+    }
 }
 
 std::vector<ChatMessage> Canvas::getChatMessages() {
@@ -183,134 +288,130 @@ std::vector<ChatMessage> Canvas::getChatMessages() {
     return chatMessages_;
 }
 
-void Canvas::episodeLoop() {
-    std::unique_lock<std::mutex> cvLock(cvMutex_);
-    while (running_) {
-        uint64_t now = getCurrentTime();
-        int elapsed = now - episodeStartTime_;
-        
-        if (elapsed >= EPISODE_DURATION) {
-            endEpisode();
-        }
-        
-        cv_.wait_for(cvLock, std::chrono::seconds(1));
+// Arm the one-shot timer for the next episode phase change
+void Canvas::armEpisodeTimer(const char* name, int seconds, void (Canvas::*step)()) {
+    std::lock_guard lock(timersMutex_);
+    if (!running_) {
+        return;
     }
+    episodeTimer_ = scheduler_->scheduleAfter(name, std::chrono::seconds(seconds),
+                                              [this, step] { (this->*step)(); }, JobMode::Worker);
 }
 
-void Canvas::seasonLoop() {
-    std::unique_lock<std::mutex> cvLock(cvMutex_);
-    int seasonIndex = 0;
-    Season seasons[] = {Season::Bloom, Season::Frost, Season::Warm, Season::Calm};
+void Canvas::advanceSeason() {
+    static const Season seasons[] = {Season::Bloom, Season::Frost, Season::Warm, Season::Calm};
+    int next = ((int)currentSeason_.load() + 1) % 4;
+    currentSeason_ = seasons[next];
     
-    while (running_) {
-        cv_.wait_for(cvLock, std::chrono::seconds(SEASON_INTERVAL));
-        
-        if (!running_) break;
-        
-        seasonIndex = (seasonIndex + 1) % 4;
-        currentSeason_ = seasons[seasonIndex];
-        
-        applySeason();
-        
-        std::cout << "Season changed to: " << getCurrentSeason() << std::endl;
+    applySeason();
+    if (events_) {
+        events_->publishSeason(getCurrentSeason());
     }
+    
+    LOG_INFO("Season changed to: ", getCurrentSeason());
 }
 
-void Canvas::snapshotLoop() {
-    std::unique_lock<std::mutex> cvLock(cvMutex_);
-    while (running_) {
-        cv_.wait_for(cvLock, std::chrono::seconds(SNAPSHOT_INTERVAL));
-        
-        if (!running_) break;
-        
-        if (!episodeFrozen_) {
-            std::lock_guard canvasLock(canvasMutex_);
-
-            std::cerr << "[Canvas] snapshotLoop: taking snapshot" << std::endl;
-            // Store snapshot (we already hold the lock; use unlocked helper to avoid re-locking)
-            std::vector<Pixel> snapshot = getAllPixelsUnlocked();
-            snapshots_.push_back(std::move(snapshot));
+void Canvas::buildKeyframe() {
+    timeline_.buildKeyframe();
+    LOG_DEBUG("[Canvas] keyframe built (", timeline_.keyframeCount(), " keyframes, ",
+              timeline_.eventCount(), " placements)");
+}
 
-            std::cout << "Snapshot taken (" << snapshots_.size() << " total)" << std::endl;
-        }
-    }
+void Canvas::expireCooldowns() {
+    size_t removed = cooldowns_.expire(getCurrentTime(), std::max(USER_COOLDOWN, GUEST_COOLDOWN));
+    LOG_DEBUG("[Canvas] expired ", removed, " cooldown entries");
 }
 
 void Canvas::resetCanvas() {
-    for (int i = 0; i < CANVAS_SIZE; ++i) {
-        for (int j = 0; j < CANVAS_SIZE; ++j) {
-            canvas_[i][j] = {j, i, 15, PixelMood::Calm, 0, 0};  // White, calm
+    {
+        auto locks = lockAllTiles();
+        for (auto& stripe : stripes_) {
+            stripe.pendingVersion.store(VERSION_PENDING);
+        }
+        uint64_t version = version_.fetch_add(1) + 1;
+        for (auto& stripe : stripes_) {
+            stripe.pendingVersion.store(version);
+        }
+        
+        canvas_.clear();  // Every cell back to white, calm, version 0
+        resetVersion_ = version;
+        
+        for (auto& stripe : stripes_) {
+            endWrite(stripe);
         }
     }
     
     // Reset quests
-    for (auto& quest : quests_) {
-        quest.progress = 0;
-        quest.completed = false;
-    }
+    quests_.reset();
     
     cooldowns_.clear();
 }
 
-void Canvas::endEpisode() {
-    std::lock_guard lock(canvasMutex_);
-
-    std::cerr << "[Canvas] endEpisode called for episode " << episodeNumber_ << std::endl;
-    std::cout << "Episode " << episodeNumber_ << " ended!" << std::endl;
+// Active -> Frozen: stop accepting pixels and hand the final frame to the
+// export worker. Returns right away; readers keep working throughout.
+void Canvas::freezeEpisode() {
+    uint32_t episode = episodeNumber_;
+    LOG_INFO("Episode ", episode, " ended!");
     
-    // Freeze canvas
-    episodeFrozen_ = true;
+    // Taking every stripe once after the phase switch flushes placements
+    // already in flight, so the captured frame is final
+    freezeStartTime_ = getCurrentTime();
+    phase_ = EpisodePhase::Frozen;
+    lockAllTiles();
+    timeline_.finish();
     
-    // Save final snapshot (we hold the lock; use unlocked helper to avoid deadlock)
-    fs::create_directories("exports");
-    std::string filename = "exports/episode_" + std::to_string(episodeNumber_) + ".png";
-    auto finalSnapshot = getAllPixelsUnlocked();
-    Snapshot::exportPNG(finalSnapshot, CANVAS_SIZE, CANVAS_SIZE, filename);
+    PixelGrid finalFrame = canvas_.toGrid();
+    uint64_t startTime = episodeStartTime_;
+    uint64_t endTime = freezeStartTime_;
     
-    // Save episode metadata
-    db_->saveEpisode(episodeNumber_, episodeStartTime_, getCurrentTime());
+    // The log view stays valid after the next episode resets the timeline
+    EpisodeTimeline::LogView log = timeline_.log();
+    ArchiveInfo archive{episode, startTime, endTime, canvas_.width(), canvas_.height(), log.count,
+                        (uint32_t)timeline_.durationMs()};
+    std::vector<Quest> quests = quests_.getQuests();
     
-    // Wait for freeze duration
-    std::this_thread::sleep_for(std::chrono::seconds(FREEZE_DURATION));
+    if (events_) {
+        events_->publishEpisode(getEpisodeInfo());
+    }
     
-    // Reset for next episode
-    snapshots_.clear();
-    resetCanvas();
-    episodeNumber_++;
-    episodeStartTime_ = getCurrentTime();
-    episodeFrozen_ = false;
+    // Save final snapshot, archive and episode metadata in the background
+    scheduler_->scheduleAfter("episode-export", std::chrono::seconds(0),
+                              [this, episode, startTime, endTime, archive, log, quests = std::move(quests),
+                               frame = std::move(finalFrame)] {
+        fs::create_directories("exports");
+        std::string filename = "exports/episode_" + std::to_string(episode) + ".png";
+        Snapshot::exportPNG(frame, filename);
+        
+        fs::create_directories("data/episodes");
+        std::string archivePath = EpisodeArchive::pathFor(episode);
+        if (EpisodeArchive::write(archivePath, archive, quests, log)) {
+            LOG_INFO("Episode archived: ", archivePath, " (", log.count, " placements)");
+        }
+        db_->saveEpisode(episode, startTime, endTime);
+        LOG_DEBUG("[Canvas] episode ", episode, " exported");
+    }, JobMode::Worker);
     
-    std::cout << "Episode " << episodeNumber_ << " started!" << std::endl;
-    std::cerr << "[Canvas] endEpisode completed, new episode " << episodeNumber_ << std::endl;
+    armEpisodeTimer("episode-reset", FREEZE_DURATION, &Canvas::startNextEpisode);
 }
 
-void Canvas::updateQuests(int x, int y, uint8_t color, PixelMood mood) {
-    // Quest 0: Place 40 blue pixels
-    if (color == 2 && !quests_[0].completed) {  // Blue
-        quests_[0].progress++;
-        if (quests_[0].progress >= quests_[0].target) {
-            quests_[0].completed = true;
-            std::cout << "Quest completed: " << quests_[0].description << std::endl;
-        }
-    }
+// Frozen -> Resetting -> Active: clear the board and open the next episode
+void Canvas::startNextEpisode() {
+    phase_ = EpisodePhase::Resetting;
     
-    // Quest 1: Fill top-left 10x10 area
-    if (x < 10 && y < 10 && !quests_[1].completed) {
-        quests_[1].progress++;
-        if (quests_[1].progress >= quests_[1].target) {
-            quests_[1].completed = true;
-            std::cout << "Quest completed: " << quests_[1].description << std::endl;
-        }
-    }
+    resetCanvas();
+    episodeNumber_++;
+    episodeStartTime_ = getCurrentTime();
+    timeline_.reset(episodeNumber_, episodeStartTime_);
+    phase_ = EpisodePhase::Active;
     
-    // Quest 2: Place 20 calm pixels
-    if (mood == PixelMood::Calm && !quests_[2].completed) {
-        quests_[2].progress++;
-        if (quests_[2].progress >= quests_[2].target) {
-            quests_[2].completed = true;
-            std::cout << "Quest completed: " << quests_[2].description << std::endl;
-        }
+    if (events_) {
+        events_->publishEpisode(getEpisodeInfo());
+        events_->publishQuests(quests_.getQuests());
+        events_->publishResync();  // Board was cleared
     }
+    
+    LOG_INFO("Episode ", episodeNumber_.load(), " started!");
+    armEpisodeTimer("episode-end", EPISODE_DURATION, &Canvas::freezeEpisode);
 }
 
 void Canvas::applySeason() {
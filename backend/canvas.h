@@ -2,31 +2,17 @@
 #define CANVAS_H
 
 #include "database.h"
+#include "tile_grid.h"
+#include "episode_timeline.h"
+#include "cooldown_table.h"
+#include "quest_board.h"
+#include "scheduler.h"
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <atomic>
-#include <thread>
 #include <mutex>
-#include <map>
-#include <condition_variable>
-
-// Pixel moods
-enum class PixelMood : uint8_t {
-    Happy = 0,
-    Sad = 1,
-    Calm = 2,
-    Energetic = 3
-};
-
-// Pixel structure
-struct Pixel {
-    int x, y;
-    uint8_t color;
-    PixelMood mood;
-    uint64_t timestamp;
-    uint32_t userId;
-};
+#include <array>
 
 // Season types
 enum class Season {
@@ -36,14 +22,6 @@ enum class Season {
     Calm
 };
 
-// Quest structure
-struct Quest {
-    std::string description;
-    int progress;
-    int target;
-    bool completed;
-};
-
 // Chat message
 struct ChatMessage {
     std::string username;
@@ -51,31 +29,73 @@ struct ChatMessage {
     uint64_t timestamp;
 };
 
+class EventHub;
+
+// Cells changed since a client's last seen version
+struct CanvasDelta {
+    uint64_t version;          // Cursor to send back as `since` on the next poll
+    bool fullResync;           // Client is too far behind (or the board was reset); refetch instead
+    std::vector<Pixel> pixels;
+};
+
+// Episode lifecycle: Active (painting) -> Frozen (read-only, final frame is
+// being exported) -> Resetting (board being cleared) -> next episode Active
+enum class EpisodePhase : uint8_t {
+    Active,
+    Frozen,
+    Resetting
+};
+
 // Episode info
 struct EpisodeInfo {
     uint32_t episodeNumber;
-    int timeRemaining;
+    int timeRemaining;     // Seconds of painting left (0 unless Active)
     bool isActive;
-    bool isFrozen;
+    bool isFrozen;         // Frozen or Resetting
+    EpisodePhase phase;
+    int freezeRemaining;   // Seconds until the next episode starts (0 when Active)
 };
 
+const char* episodePhaseName(EpisodePhase phase);
+
 class Canvas {
 public:
-    Canvas(Database* db);
+    Canvas(Database* db, Scheduler* scheduler, int width, int height);
     ~Canvas();
     
     void start();
     void stop();
     
+    // Push updates to open event streams (optional)
+    void setEventHub(EventHub* events) { events_ = events; }
+    
     // Pixel operations
     bool placePixel(int x, int y, uint8_t color, uint8_t mood, uint32_t userId, bool isLoggedIn);
     std::vector<Pixel> getRegion(int x, int y, int width, int height);
-    std::vector<Pixel> getAllPixels();
+    // Version that every completed write is covered by; read it before a region
+    // so the region is at least as new as the version handed to the client
+    uint64_t getVersion();
+    CanvasDelta getDelta(uint64_t since, int x, int y, int width, int height);
+    int getWidth() const { return canvas_.width(); }
+    int getHeight() const { return canvas_.height(); }
     
     // Episode management
-    uint32_t getEpisodeNumber() const { return episodeNumber_; }
+    uint32_t getEpisodeNumber() const { return episodeNumber_.load(); }
+    EpisodePhase getEpisodePhase() const { return phase_.load(); }
     EpisodeInfo getEpisodeInfo();
-    std::vector<std::vector<Pixel>> getSnapshots();
+    // The current episode's placement log as of now, to render later
+    EpisodeTimeline::Capture captureEpisode() { return timeline_.capture(); }
+    // Board and replay frames (oldest first) rebuilt from a capture
+    PixelGrid getFrame(const EpisodeTimeline::Capture& capture) const { return timeline_.board(capture); }
+    std::vector<SnapshotHandle> getSnapshots(const EpisodeTimeline::Capture& capture) const;
+    // Number of frames getSnapshots() returns for `capture`
+    static uint64_t getSnapshotCount(const EpisodeTimeline::Capture& capture);
+    // Replay frames of an earlier episode from its archive; false if there is none
+    bool getArchivedSnapshots(uint32_t episode, std::vector<SnapshotHandle>& frames);
+    // Final board of an earlier episode from its archive
+    bool getArchivedFrame(uint32_t episode, PixelGrid& frame);
+    // Region as it was `offsetMs` into the current episode
+    TimelinePosition getRegionAt(uint64_t offsetMs, int x, int y, int width, int height, std::vector<Pixel>& out);
     
     // Season management
     std::string getCurrentSeason();
@@ -91,49 +111,67 @@ public:
     uint64_t getCurrentTime();
     
 private:
+    // Tiles hash onto this many writer locks
+    static const int LOCK_STRIPES = 64;
+    
     Database* db_;
+    Scheduler* scheduler_;
+    EventHub* events_;
     std::atomic<bool> running_;
-    std::thread episodeThread_;
-    std::thread seasonThread_;
-    std::thread snapshotThread_;
-    std::mutex canvasMutex_;
     std::mutex chatMutex_;
-    std::mutex cvMutex_;
-    std::condition_variable cv_;
     
-    // Canvas state
-    std::vector<std::vector<Pixel>> canvas_;
-    uint32_t episodeNumber_;
-    uint64_t episodeStartTime_;
-    bool episodeFrozen_;
+    // Housekeeping jobs on the scheduler; the episode timer is re-armed on
+    // every phase change
+    std::mutex timersMutex_;
+    Scheduler::JobId episodeTimer_;
+    std::vector<Scheduler::JobId> periodicTimers_;
+    
+    // Writer lock for the tiles hashing here, plus the canvas version currently
+    // being written under it (0 = idle) so version readers can wait it out
+    struct alignas(64) Stripe {
+        std::mutex lock;
+        std::atomic<uint64_t> pendingVersion{0};
+    };
+    
+    // Canvas state; writers hold their tile's stripe lock, readers go through the tile seqlocks
+    TileGrid canvas_;
+    std::array<Stripe, LOCK_STRIPES> stripes_;
+    std::atomic<uint64_t> version_;       // Bumped by every placement and reset
+    std::atomic<uint64_t> resetVersion_;  // Version of the last board reset
+    std::atomic<uint32_t> episodeNumber_;
+    std::atomic<uint64_t> episodeStartTime_;
+    std::atomic<EpisodePhase> phase_;
+    std::atomic<uint64_t> freezeStartTime_;
     
     // Cooldowns (userId -> timestamp)
-    std::map<uint32_t, uint64_t> cooldowns_;
+    CooldownTable cooldowns_;
     
     // Season
-    Season currentSeason_;
+    std::atomic<Season> currentSeason_;
     
     // Quests
-    std::vector<Quest> quests_;
+    QuestBoard quests_;
     
     // Chat
     std::vector<ChatMessage> chatMessages_;
     
-    // Snapshots
-    std::vector<std::vector<Pixel>> snapshots_;
+    // Every placement of the current episode, with periodic keyframes
+    EpisodeTimeline timeline_;
     
-    // Thread functions
-    void episodeLoop();
-    void seasonLoop();
-    void snapshotLoop();
-
-    // Internal helper: copy all pixels without taking the mutex (caller must hold lock if needed)
-    std::vector<Pixel> getAllPixelsUnlocked();
+    // Scheduled jobs
+    void advanceSeason();
+    void buildKeyframe();
+    void expireCooldowns();
     
     // Helper functions
+    Stripe& stripeFor(size_t tileIndex) { return stripes_[tileIndex % LOCK_STRIPES]; }
+    std::array<std::unique_lock<std::mutex>, LOCK_STRIPES> lockAllTiles();
+    uint64_t beginWrite(Stripe& stripe);
+    void endWrite(Stripe& stripe);
     void resetCanvas();
-    void endEpisode();
-    void updateQuests(int x, int y, uint8_t color, PixelMood mood);
+    void freezeEpisode();
+    void startNextEpisode();
+    void armEpisodeTimer(const char* name, int seconds, void (Canvas::*step)());
     void applySeason();
 };
 
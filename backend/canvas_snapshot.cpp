@@ -0,0 +1,109 @@
+#include "canvas_snapshot.h"
+#include <algorithm>
+
+CanvasSnapshot::CanvasSnapshot(int width, int height, int tilesX, int tilesY)
+    : width_(width), height_(height), tilesX_(tilesX), tilesY_(tilesY),
+      tiles_((size_t)tilesX * tilesY) {
+}
+
+SnapshotHandle CanvasSnapshot::capture(const TileGrid& grid, const CanvasSnapshot* previous) {
+    std::shared_ptr<CanvasSnapshot> snapshot(
+        new CanvasSnapshot(grid.width(), grid.height(), grid.tilesX(), grid.tilesY()));
+    if (previous && previous->tiles_.size() != snapshot->tiles_.size()) {
+        previous = nullptr;
+    }
+    
+    for (int ty = 0; ty < grid.tilesY(); ++ty) {
+        for (int tx = 0; tx < grid.tilesX(); ++tx) {
+            const Tile* t = grid.tile(tx, ty);
+            if (!t) {
+                continue;  // Never painted: stays null
+            }
+            size_t index = (size_t)ty * grid.tilesX() + tx;
+            const std::shared_ptr<const TileImage>* before = previous ? &previous->tiles_[index] : nullptr;
+            
+            // Tile versions only grow within an episode, so an unchanged
+            // version means the previous image is still exact
+            std::shared_ptr<TileImage> image;
+            bool unchanged = false;
+            t->readConsistent([&]() {
+                uint64_t version = t->version.load(std::memory_order_relaxed);
+                unchanged = before && *before && (*before)->version == version;
+                if (unchanged) {
+                    return;
+                }
+                if (!image) {
+                    image = std::make_shared<TileImage>();
+                }
+                image->version = version;
+                for (int i = 0; i < TILE_CELLS; ++i) {
+                    image->color[i] = t->color[i].load(std::memory_order_relaxed);
+                    image->mood[i] = t->mood[i].load(std::memory_order_relaxed);
+                    image->timestamp[i] = t->timestamp[i].load(std::memory_order_relaxed);
+                    image->userId[i] = t->userId[i].load(std::memory_order_relaxed);
+                }
+            });
+            
+            if (unchanged) {
+                snapshot->tiles_[index] = *before;
+            } else {
+                snapshot->tiles_[index] = std::move(image);
+            }
+        }
+    }
+    return snapshot;
+}
+
+void CanvasSnapshot::appendRegion(int x, int y, int w, int h, std::vector<Pixel>& out) const {
+    int startX = std::max(0, x);
+    int startY = std::max(0, y);
+    int endX = (int)std::min<int64_t>((int64_t)x + w, width_);   // x + w may not fit in an int
+    int endY = (int)std::min<int64_t>((int64_t)y + h, height_);
+    if (startX >= endX || startY >= endY) {
+        return;
+    }
+    
+    size_t offset = out.size();
+    int stride = endX - startX;
+    out.resize(offset + (size_t)stride * (endY - startY));
+    for (int j = startY; j < endY; ++j) {
+        Pixel* row = out.data() + offset + (size_t)(j - startY) * stride;
+        for (int i = startX; i < endX; ++i) {
+            const TileImage* image = tile(i / TILE_SIZE, j / TILE_SIZE);
+            if (!image) {
+                row[i - startX] = {i, j, DEFAULT_COLOR, DEFAULT_MOOD, 0, 0};
+                continue;
+            }
+            int index = (j % TILE_SIZE) * TILE_SIZE + i % TILE_SIZE;
+            row[i - startX] = {i, j, image->color[index], static_cast<PixelMood>(image->mood[index]),
+                               image->timestamp[index], image->userId[index]};
+        }
+    }
+}
+
+PixelGrid CanvasSnapshot::toGrid() const {
+    PixelGrid grid(width_, height_);
+    
+    for (int ty = 0; ty < tilesY_; ++ty) {
+        for (int tx = 0; tx < tilesX_; ++tx) {
+            const TileImage* image = tile(tx, ty);
+            if (!image) {
+                continue;  // Dense grid already holds the default cell
+            }
+            
+            int x0 = tx * TILE_SIZE;
+            int y0 = ty * TILE_SIZE;
+            int x1 = std::min(width_, x0 + TILE_SIZE);
+            int y1 = std::min(height_, y0 + TILE_SIZE);
+            for (int y = y0; y < y1; ++y) {
+                int rowOffset = (y - y0) * TILE_SIZE;
+                for (int x = x0; x < x1; ++x) {
+                    int index = rowOffset + (x - x0);
+                    grid.set(x, y, image->color[index], static_cast<PixelMood>(image->mood[index]),
+                             image->timestamp[index], image->userId[index]);
+                }
+            }
+        }
+    }
+    return grid;
+}
@@ -0,0 +1,57 @@
+#ifndef CANVAS_SNAPSHOT_H
+#define CANVAS_SNAPSHOT_H
+
+#include "tile_grid.h"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Frozen copy of one tile's cells (no per-cell versions: snapshots are only
+// ever rendered)
+struct TileImage {
+    uint8_t color[TILE_CELLS];
+    uint8_t mood[TILE_CELLS];
+    uint32_t timestamp[TILE_CELLS];
+    uint32_t userId[TILE_CELLS];
+    uint64_t version;   // Tile version the copy was taken at
+};
+
+class CanvasSnapshot;
+using SnapshotHandle = std::shared_ptr<const CanvasSnapshot>;
+
+// Immutable point-in-time view of the board, built from reference-counted
+// tile images. A snapshot taken after `previous` reuses every image whose
+// tile has not been written since, so taking one costs a copy of the dirty
+// tiles only and a series of snapshots holds each distinct tile state once.
+// Handles are cheap to copy and safe to read from any thread.
+class CanvasSnapshot {
+public:
+    // Capture `grid` without blocking its writers (tiles are read under their
+    // seqlocks). `previous` must come from the same grid in the same episode.
+    static SnapshotHandle capture(const TileGrid& grid, const CanvasSnapshot* previous);
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int tilesX() const { return tilesX_; }
+    int tilesY() const { return tilesY_; }
+    
+    // Image for tile (tx, ty), or nullptr if it was never painted
+    const TileImage* tile(int tx, int ty) const { return tiles_[(size_t)ty * tilesX_ + tx].get(); }
+    
+    // Append the clipped region [x, x+w) x [y, y+h) to `out` in row-major order
+    void appendRegion(int x, int y, int w, int h, std::vector<Pixel>& out) const;
+    
+    // Expand into a dense frame (for PNG/video rendering)
+    PixelGrid toGrid() const;
+
+private:
+    int width_;
+    int height_;
+    int tilesX_;
+    int tilesY_;
+    std::vector<std::shared_ptr<const TileImage>> tiles_;
+    
+    CanvasSnapshot(int width, int height, int tilesX, int tilesY);
+};
+
+#endif
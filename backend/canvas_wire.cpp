@@ -0,0 +1,66 @@
+#include "canvas_wire.h"
+#include <cstring>
+
+namespace {
+
+void put16(std::string& out, size_t offset, uint16_t value) {
+    out[offset] = (char)(value & 0xFF);
+    out[offset + 1] = (char)(value >> 8);
+}
+
+void put32(std::string& out, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[offset + i] = (char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void put64(std::string& out, size_t offset, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[offset + i] = (char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+}  // namespace
+
+std::string CanvasWire::encode(const WireRegion& region, const std::vector<Pixel>& pixels, uint16_t flags) {
+    size_t cells = pixels.size();
+    size_t colorBytes = (cells + 1) / 2;
+    size_t moodBytes = (flags & WIRE_MOOD_PLANE) ? (cells + 3) / 4 : 0;
+    size_t timestampBytes = (flags & WIRE_TIMESTAMP_PLANE) ? cells * 4 : 0;
+    
+    // Zero-filled, so the planes only need their set bits ORed in
+    std::string out(WIRE_HEADER_SIZE + colorBytes + moodBytes + timestampBytes, '\0');
+    
+    std::memcpy(&out[0], "SCNV", 4);
+    put16(out, 4, WIRE_FORMAT_VERSION);
+    put16(out, 6, flags);
+    put32(out, 8, (uint32_t)region.x);
+    put32(out, 12, (uint32_t)region.y);
+    put32(out, 16, (uint32_t)region.width);
+    put32(out, 20, (uint32_t)region.height);
+    put32(out, 24, (uint32_t)region.boardWidth);
+    put32(out, 28, (uint32_t)region.boardHeight);
+    put64(out, 32, region.version);
+    put64(out, 40, region.timestamp);
+    
+    uint8_t* colors = reinterpret_cast<uint8_t*>(&out[WIRE_HEADER_SIZE]);
+    for (size_t i = 0; i < cells; ++i) {
+        colors[i >> 1] |= (uint8_t)((pixels[i].color & 0x0F) << ((i & 1) * 4));
+    }
+    
+    if (moodBytes) {
+        uint8_t* moods = colors + colorBytes;
+        for (size_t i = 0; i < cells; ++i) {
+            moods[i >> 2] |= (uint8_t)((static_cast<uint8_t>(pixels[i].mood) & 0x03) << ((i & 3) * 2));
+        }
+    }
+    
+    if (timestampBytes) {
+        size_t offset = WIRE_HEADER_SIZE + colorBytes + moodBytes;
+        for (size_t i = 0; i < cells; ++i) {
+            put32(out, offset + i * 4, (uint32_t)pixels[i].timestamp);
+        }
+    }
+    
+    return out;
+}
@@ -0,0 +1,47 @@
+#ifndef CANVAS_WIRE_H
+#define CANVAS_WIRE_H
+
+#include "pixel_grid.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Binary canvas region format (application/octet-stream), little-endian:
+//
+//   offset size  field
+//   0      4     magic "SCNV"
+//   4      2     format version (1)
+//   6      2     flags (WIRE_MOOD_PLANE | WIRE_TIMESTAMP_PLANE)
+//   8      4     region x (int32)
+//   12     4     region y (int32)
+//   16     4     region width
+//   20     4     region height
+//   24     4     board width
+//   28     4     board height
+//   32     8     canvas version
+//   40     8     server timestamp (seconds)
+//   48     ...   color plane: 4-bit palette indices, two cells per byte, even cell in the low nibble
+//          ...   mood plane (optional): 2 bits per cell, four cells per byte, first cell in the low bits
+//          ...   timestamp plane (optional): uint32 per cell
+//
+// Cells are row-major within the region.
+const uint16_t WIRE_FORMAT_VERSION = 1;
+const uint16_t WIRE_MOOD_PLANE = 1 << 0;
+const uint16_t WIRE_TIMESTAMP_PLANE = 1 << 1;
+const size_t WIRE_HEADER_SIZE = 48;
+
+struct WireRegion {
+    int x, y;
+    int width, height;
+    int boardWidth, boardHeight;
+    uint64_t version;
+    uint64_t timestamp;
+};
+
+class CanvasWire {
+public:
+    // `pixels` must be the row-major contents of `region`
+    static std::string encode(const WireRegion& region, const std::vector<Pixel>& pixels, uint16_t flags);
+};
+
+#endif
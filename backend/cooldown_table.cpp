@@ -0,0 +1,37 @@
+#include "cooldown_table.h"
+
+bool CooldownTable::tryAcquire(uint32_t userId, uint64_t now, uint64_t cooldown) {
+    Shard& shard = shardFor(userId);
+    std::lock_guard lock(shard.mutex);
+    
+    auto it = shard.lastPlacement.find(userId);
+    if (it != shard.lastPlacement.end() && now - it->second < cooldown) {
+        return false;  // Still in cooldown
+    }
+    
+    shard.lastPlacement[userId] = now;
+    return true;
+}
+
+size_t CooldownTable::expire(uint64_t now, uint64_t maxCooldown) {
+    size_t removed = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        for (auto it = shard.lastPlacement.begin(); it != shard.lastPlacement.end();) {
+            if (it->second + maxCooldown <= now) {
+                it = shard.lastPlacement.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return removed;
+}
+
+void CooldownTable::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        shard.lastPlacement.clear();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef COOLDOWN_TABLE_H
+#define COOLDOWN_TABLE_H
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// Per-user placement cooldowns, sharded by userId so placements from
+// different users rarely contend on the same lock.
+class CooldownTable {
+public:
+    // If `userId` last placed at least `cooldown` seconds before `now`, record
+    // `now` as its new placement time and return true; otherwise return false.
+    bool tryAcquire(uint32_t userId, uint64_t now, uint64_t cooldown);
+    
+    // Forget users whose last placement is at least `maxCooldown` seconds old
+    // (they could place again anyway). Returns the number of entries removed.
+    size_t expire(uint64_t now, uint64_t maxCooldown);
+    
+    void clear();
+    
+private:
+    static const int SHARDS = 32;
+    
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint32_t, uint64_t> lastPlacement;
+    };
+    
+    std::array<Shard, SHARDS> shards_;
+    
+    Shard& shardFor(uint32_t userId) { return shards_[userId % SHARDS]; }
+};
+
+#endif
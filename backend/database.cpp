@@ -1,113 +1,436 @@
 #include "database.h"
 #include "sha256.h"
+#include "logger.h"
 #include <filesystem>
 #include <algorithm>
-#include <iostream>
 #include <ctime>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
 
 namespace fs = std::filesystem;
 
+// Format 1 base file (little-endian): magic, next user ID, then users,
+// episodes and sessions, each preceded by their count. Only read, to migrate.
+const uint32_t DATABASE_MAGIC_V1 = 0x4F4D4E49;  // "OMNI"
+const size_t SESSION_SHARDS = 64;
+
+namespace {
+
+// Little-endian fields for log payloads and session entries
+void putU32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putU64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, const std::string& value) {
+    putU32(out, (uint32_t)value.size());
+    out += value;
+}
+
+// Bounds-checked reader over one log payload
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view data) : data_(data), ok_(true) {}
+    
+    bool ok() const { return ok_ && data_.empty(); }
+    
+    uint32_t u32() { uint32_t v = 0; take(&v, sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v = 0; take(&v, sizeof(v)); return v; }
+    std::string string() {
+        uint32_t length = u32();
+        if (!ok_ || length > data_.size()) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string value(data_.substr(0, length));
+        data_.remove_prefix(length);
+        return value;
+    }
+    
+private:
+    std::string_view data_;
+    bool ok_;
+    
+    void take(void* out, size_t size) {
+        if (!ok_ || data_.size() < size) {
+            ok_ = false;
+            return;
+        }
+        std::memcpy(out, data_.data(), size);
+        data_.remove_prefix(size);
+    }
+};
+
+// Create the data directory if it doesn't exist; returns it ("." for none)
+fs::path createParentDirectory(const std::string& path) {
+    fs::path directory = fs::path(path).parent_path();
+    if (directory.empty()) {
+        return ".";
+    }
+    std::error_code error;
+    fs::create_directories(directory, error);
+    return directory;
+}
+
+void encodeUser(std::string& out, const User& user) {
+    putU32(out, user.id);
+    putString(out, user.email);
+    putString(out, user.username);
+    putString(out, user.passwordHash);
+    putU64(out, user.registrationTime);
+}
+
+}  // namespace
+
 Database::Database(const std::string& filename)
-    : filename_(filename), nextUserId_(1), userIdIndex_(5) {
+    : filename_(filename), wal_(filename + ".wal"), nextUserId_(1) {
+    clear();
 }
 
 Database::~Database() {
     save();
+    wal_.close();
 }
 
 bool Database::load() {
-    std::ifstream in(filename_, std::ios::binary);
-    if (!in) {
-        return false;
+    bool loaded = false;
+    bool migrate = false;
+    size_t records;
+    {
+        std::lock_guard checkpointLock(checkpointMutex_);
+        std::lock_guard lock(mutex_);
+        if (base_->open(filename_)) {
+            // Only the header is parsed; users stay in the mapping
+            nextUserId_ = base_->nextUserId();
+            for (const auto& episode : base_->episodes()) {
+                insertEpisode(episode);
+            }
+            if (!base_->forEachSession([this](const std::string& id, uint32_t userId) { editSessions(id)[id] = userId; })) {
+                LOG_WARN("Database file ", filename_, " has a malformed session section");
+            }
+            LOG_INFO("Database loaded: ", base_->userCount(), " users, ", episodes_.size(), " episodes");
+            loaded = true;
+        } else {
+            std::ifstream in(filename_, std::ios::binary);
+            if (in) {
+                try {
+                    deserialize(in);
+                    loaded = true;
+                    migrate = true;
+                } catch (...) {
+                    clear();
+                }
+            }
+        }
+        
+        // Changes made after the base file was written
+        records = wal_.replay([this](uint8_t type, std::string_view payload) { applyRecord(type, payload); });
+        if (records > 0) {
+            LOG_INFO("Database log replayed: ", records, " changes");
+        }
+        createParentDirectory(filename_);
+        wal_.open();
     }
     
-    try {
-        deserialize(in);
-        return true;
-    } catch (...) {
-        return false;
+    if (migrate) {
+        LOG_INFO("Migrating ", filename_, " to format v", DATABASE_FORMAT_VERSION);
+        save();
     }
+    return loaded || records > 0;
 }
 
 bool Database::save() {
-    // Create data directory if it doesn't exist
-    fs::create_directories("data");
+    return writeCheckpoint(true);
+}
+
+bool Database::checkpoint() {
+    return writeCheckpoint(false);
+}
+
+bool Database::writeCheckpoint(bool force) {
+    std::lock_guard checkpointLock(checkpointMutex_);
+    createParentDirectory(filename_);
+    
+    // Point-in-time view. Request threads wait only while it is taken: users
+    // registered since the last checkpoint are referenced, not copied (the
+    // deque keeps them in place), and session shards are shared and copied
+    // on their next write. base_ only changes under checkpointMutex_.
+    DatabaseFile::Image image;
+    std::vector<std::shared_ptr<SessionShard>> shards;
+    {
+        std::lock_guard lock(mutex_);
+        if (!force && wal_.pendingBytes() == 0) {
+            return true;
+        }
+        if (!wal_.rotate()) {
+            return false;
+        }
+        image.nextUserId = nextUserId_;
+        image.base = base_.get();
+        for (const User& user : users_) {
+            image.users.push_back(&user);
+        }
+        image.episodes = episodes_;
+        shards = sessionShards_;
+    }
     
-    std::ofstream out(filename_, std::ios::binary);
-    if (!out) {
+    // Only shards changed since the last checkpoint are encoded again
+    for (const auto& shard : shards) {
+        image.sessionCount += (uint32_t)shard->sessions.size();
+        if (shard->encoded) {
+            image.sessions.push_back(shard->encoded);
+            continue;
+        }
+        auto bytes = std::make_shared<std::string>();
+        for (const auto& p : shard->sessions) {
+            putString(*bytes, p.first);
+            putU32(*bytes, p.second);
+        }
+        image.sessions.push_back(std::move(bytes));
+    }
+    
+    // A crash before the new version is committed (header written, or the
+    // file renamed when compacting) keeps the old one and both log segments;
+    // a crash after it replays changes the new version already has, which
+    // applyRecord skips
+    auto next = std::make_unique<DatabaseFile>();
+    if (!DatabaseFile::write(filename_, image) || !next->open(filename_)) {
         return false;
     }
+    wal_.dropRotated();
     
-    serialize(out);
-    return true;
+    // Users now in the base file leave the in-memory part. Only the users
+    // registered during the write are re-indexed under the lock; the old
+    // structures are freed after it is released.
+    std::deque<User> users;
+    std::unordered_map<std::string, uint32_t> emailToUserId;
+    BTree<> userIdIndex;
+    {
+        std::lock_guard lock(mutex_);
+        base_.swap(next);
+        users.assign(users_.begin() + image.users.size(), users_.end());
+        for (size_t i = 0; i < users.size(); ++i) {
+            emailToUserId[users[i].email] = users[i].id;
+            userIdIndex.insert(users[i].id, (int)i);
+        }
+        users_.swap(users);
+        emailToUserId_.swap(emailToUserId);
+        std::swap(userIdIndex_, userIdIndex);
+        
+        // Keep the encoding of every shard nobody has written to since
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (sessionShards_[i] == shards[i] && !shards[i]->encoded) {
+                shards[i]->encoded = image.sessions[i];
+            }
+        }
+    }
+    return true;   // The old mapping goes away here too
 }
 
-void Database::initialize() {
+// Called with both locks held
+void Database::clear() {
     nextUserId_ = 1;
     users_.clear();
     episodes_.clear();
     emailToUserId_.clear();
-    sessions_.clear();
-    userIdIndex_ = BTree(5);
-    
-    std::cout << "Database initialized with default values." << std::endl;
+    sessionShards_.clear();
+    for (size_t i = 0; i < SESSION_SHARDS; ++i) {
+        sessionShards_.push_back(std::make_shared<SessionShard>());
+    }
+    userIdIndex_.clear();
+    base_ = std::make_unique<DatabaseFile>();
+}
 
-    // Add default test users when initializing a fresh database
-    if (users_.empty()) {
-        uint32_t id1 = registerUser("bscs24045@itu.edu.pk", "israr", "itu123");
-        if (id1) {
-            std::cout << "Default user created: bscs24045@itu.edu.pk (ID: " << id1 << ")" << std::endl;
-        }
-        uint32_t id2 = registerUser("bscs24009@itu.edu.pk", "abdullah", "itu123");
-        if (id2) {
-            std::cout << "Default user created: bscs24009@itu.edu.pk (ID: " << id2 << ")" << std::endl;
-        }
-        uint32_t id3 = registerUser("bscs24017@itu.edu.pk", "ali", "itu123");
-        if (id3) {
-            std::cout << "Default user created: bscs24017@itu.edu.pk (ID: " << id3 << ")" << std::endl;
+const std::unordered_map<std::string, uint32_t>& Database::sessions(const std::string& sessionId) const {
+    return sessionShards_[std::hash<std::string>()(sessionId) % sessionShards_.size()]->sessions;
+}
+
+std::unordered_map<std::string, uint32_t>& Database::editSessions(const std::string& sessionId) {
+    auto& shard = sessionShards_[std::hash<std::string>()(sessionId) % sessionShards_.size()];
+    if (shard.use_count() > 1) {
+        shard = std::make_shared<SessionShard>(*shard);   // A checkpoint is still writing it
+    }
+    shard->encoded.reset();
+    return shard->sessions;
+}
+
+void Database::initialize() {
+    {
+        std::lock_guard checkpointLock(checkpointMutex_);
+        std::lock_guard lock(mutex_);
+        clear();
+        createParentDirectory(filename_);
+        wal_.open();
+        
+        LOG_INFO("Database initialized with default values.");
+        
+        // Add default test users when initializing a fresh database
+        const char* defaults[][2] = {
+            {"bscs24045@itu.edu.pk", "israr"},
+            {"bscs24009@itu.edu.pk", "abdullah"},
+            {"bscs24017@itu.edu.pk", "ali"}
+        };
+        for (const auto& entry : defaults) {
+            uint64_t lsn;
+            uint32_t id = addUser(entry[0], entry[1], hashPassword("itu123"),
+                                  static_cast<uint64_t>(std::time(nullptr)), lsn);
+            if (id) {
+                LOG_INFO("Default user created: ", entry[0], " (ID: ", id, ")");
+            }
         }
     }
+    // Start from a base file rather than a log of the defaults
+    save();
 }
 
-uint32_t Database::registerUser(const std::string& email, const std::string& username, const std::string& password) {
+void Database::insertUser(const User& user) {
+    users_.push_back(user);
+    emailToUserId_[user.email] = user.id;
+    userIdIndex_.insert(user.id, users_.size() - 1);
+    nextUserId_ = std::max(nextUserId_, user.id + 1);
+}
+
+void Database::insertEpisode(const EpisodeMetadata& episode) {
+    episodes_.push_back(episode);
+    
+    // Keep only last 10 episodes
+    if (episodes_.size() > 10) {
+        episodes_.erase(episodes_.begin());
+    }
+}
+
+// Users since the last checkpoint first, then the mapped base file
+bool Database::findUser(uint32_t userId, User& out) {
+    int userIndex = userIdIndex_.search(userId);
+    if (userIndex >= 0 && userIndex < (int)users_.size()) {
+        out = users_[userIndex];
+        return true;
+    }
+    int64_t record = base_->findById(userId);
+    return record >= 0 && base_->user((uint32_t)record, out);
+}
+
+uint32_t Database::findUserId(const std::string& email) {
+    auto it = emailToUserId_.find(email);
+    if (it != emailToUserId_.end()) {
+        return it->second;
+    }
+    int64_t record = base_->findByEmail(email);
+    User user;
+    return record >= 0 && base_->user((uint32_t)record, user) ? user.id : 0;
+}
+
+uint32_t Database::addUser(const std::string& email, const std::string& username, const std::string& passwordHash,
+                           uint64_t registrationTime, uint64_t& lsn) {
     // Check if email already exists
-    if (emailToUserId_.find(email) != emailToUserId_.end()) {
+    if (findUserId(email) != 0) {
         return 0;  // Email already registered
     }
     
     // Create new user
     User user;
-    user.id = nextUserId_++;
+    user.id = nextUserId_;
     user.email = email;
     user.username = username;
-    user.passwordHash = hashPassword(password);
-    user.registrationTime = static_cast<uint64_t>(std::time(nullptr));
-    
-    // Store user
-    users_.push_back(user);
-    emailToUserId_[email] = user.id;
-    userIdIndex_.insert(user.id, users_.size() - 1);
+    user.passwordHash = passwordHash;
+    user.registrationTime = registrationTime;
+    insertUser(user);
     
-    std::cout << "User registered: " << username << " (ID: " << user.id << ")" << std::endl;
+    std::string record;
+    encodeUser(record, user);
+    lsn = wal_.append(WalUserRegistered, record);
     
+    LOG_INFO("User registered: ", username, " (ID: ", user.id, ")");
     return user.id;
 }
 
+// Replay one log record. Records the base file already reflects (the log is
+// only truncated after the base file is renamed into place) are skipped.
+void Database::applyRecord(uint8_t type, std::string_view payload) {
+    PayloadReader in(payload);
+    switch (type) {
+        case WalUserRegistered: {
+            User user;
+            user.id = in.u32();
+            user.email = in.string();
+            user.username = in.string();
+            user.passwordHash = in.string();
+            user.registrationTime = in.u64();
+            User existing;
+            if (in.ok() && !findUser(user.id, existing) && findUserId(user.email) == 0) {
+                insertUser(user);
+            }
+            break;
+        }
+        case WalSessionCreated: {
+            std::string sessionId = in.string();
+            uint32_t userId = in.u32();
+            if (in.ok()) {
+                editSessions(sessionId)[sessionId] = userId;
+            }
+            break;
+        }
+        case WalSessionRemoved: {
+            std::string sessionId = in.string();
+            if (in.ok() && sessions(sessionId).count(sessionId)) {
+                editSessions(sessionId).erase(sessionId);
+            }
+            break;
+        }
+        case WalEpisodeSaved: {
+            EpisodeMetadata episode;
+            episode.episodeNumber = in.u32();
+            episode.startTimestamp = in.u64();
+            episode.endTimestamp = in.u64();
+            bool known = std::any_of(episodes_.begin(), episodes_.end(), [&](const EpisodeMetadata& e) {
+                return e.episodeNumber >= episode.episodeNumber;
+            });
+            if (in.ok() && !known) {
+                insertEpisode(episode);
+            }
+            break;
+        }
+        default:
+            LOG_WARN("Unknown database log record type ", (int)type);
+            return;
+    }
+    if (!in.ok()) {
+        LOG_WARN("Malformed database log record (type ", (int)type, ")");
+    }
+}
+
+uint32_t Database::registerUser(const std::string& email, const std::string& username, const std::string& password) {
+    uint64_t lsn = 0;
+    uint32_t id;
+    {
+        std::lock_guard lock(mutex_);
+        id = addUser(email, username, hashPassword(password), static_cast<uint64_t>(std::time(nullptr)), lsn);
+    }
+    // Not acknowledged until it would survive a crash
+    if (id && (lsn == 0 || !wal_.waitDurable(lsn))) {
+        LOG_WARN("Registration of ", username, " is not durable");
+    }
+    return id;
+}
+
 uint32_t Database::authenticateUser(const std::string& email, const std::string& password) {
-    auto it = emailToUserId_.find(email);
-    if (it == emailToUserId_.end()) {
+    std::lock_guard lock(mutex_);
+    uint32_t userId = findUserId(email);
+    if (userId == 0) {
         return 0;  // User not found
     }
     
-    uint32_t userId = it->second;
-    auto user = getUserById(userId);
-    
-    if (!user) {
+    User user;
+    if (!findUser(userId, user)) {
         return 0;
     }
     
-    if (verifyPassword(password, user->passwordHash)) {
+    if (verifyPassword(password, user.passwordHash)) {
         return userId;
     }
     
@@ -115,35 +438,62 @@ uint32_t Database::authenticateUser(const std::string& email, const std::string&
 }
 
 std::shared_ptr<User> Database::getUserById(uint32_t userId) {
-    int userIndex = userIdIndex_.search(userId);
-    if (userIndex >= 0 && userIndex < (int)users_.size()) {
-        return std::make_shared<User>(users_[userIndex]);
+    std::lock_guard lock(mutex_);
+    auto user = std::make_shared<User>();
+    if (findUser(userId, *user)) {
+        return user;
     }
     return nullptr;
 }
 
 std::shared_ptr<User> Database::getUserByEmail(const std::string& email) {
-    auto it = emailToUserId_.find(email);
-    if (it != emailToUserId_.end()) {
-        return getUserById(it->second);
+    uint32_t userId;
+    {
+        std::lock_guard lock(mutex_);
+        userId = findUserId(email);
+        if (userId == 0) {
+            return nullptr;
+        }
     }
-    return nullptr;
+    return getUserById(userId);
 }
 
 void Database::createSession(const std::string& sessionId, uint32_t userId) {
-    sessions_[sessionId] = userId;
+    uint64_t lsn;
+    {
+        std::lock_guard lock(mutex_);
+        editSessions(sessionId)[sessionId] = userId;
+        std::string record;
+        putString(record, sessionId);
+        putU32(record, userId);
+        lsn = wal_.append(WalSessionCreated, record);
+    }
+    wal_.waitDurable(lsn);
 }
 
 uint32_t Database::getUserIdFromSession(const std::string& sessionId) {
-    auto it = sessions_.find(sessionId);
-    if (it != sessions_.end()) {
+    std::lock_guard lock(mutex_);
+    const auto& shard = sessions(sessionId);
+    auto it = shard.find(sessionId);
+    if (it != shard.end()) {
         return it->second;
     }
     return 0;
 }
 
 void Database::removeSession(const std::string& sessionId) {
-    sessions_.erase(sessionId);
+    uint64_t lsn;
+    {
+        std::lock_guard lock(mutex_);
+        if (sessions(sessionId).count(sessionId) == 0) {
+            return;
+        }
+        editSessions(sessionId).erase(sessionId);
+        std::string record;
+        putString(record, sessionId);
+        lsn = wal_.append(WalSessionRemoved, record);
+    }
+    wal_.waitDurable(lsn);
 }
 
 void Database::saveEpisode(uint32_t episodeNumber, uint64_t startTime, uint64_t endTime) {
@@ -152,15 +502,21 @@ void Database::saveEpisode(uint32_t episodeNumber, uint64_t startTime, uint64_t
     episode.startTimestamp = startTime;
     episode.endTimestamp = endTime;
     
-    episodes_.push_back(episode);
-    
-    // Keep only last 10 episodes
-    if (episodes_.size() > 10) {
-        episodes_.erase(episodes_.begin());
+    uint64_t lsn;
+    {
+        std::lock_guard lock(mutex_);
+        insertEpisode(episode);
+        std::string record;
+        putU32(record, episodeNumber);
+        putU64(record, startTime);
+        putU64(record, endTime);
+        lsn = wal_.append(WalEpisodeSaved, record);
     }
+    wal_.waitDurable(lsn);
 }
 
 std::vector<EpisodeMetadata> Database::getEpisodeHistory(int count) {
+    std::lock_guard lock(mutex_);
     int start = std::max(0, (int)episodes_.size() - count);
     return std::vector<EpisodeMetadata>(episodes_.begin() + start, episodes_.end());
 }
@@ -173,67 +529,17 @@ bool Database::verifyPassword(const std::string& password, const std::string& ha
     return sha256(password) == hash;
 }
 
-void Database::serialize(std::ofstream& out) {
-    // Write magic number
-    uint32_t magic = 0x4F4D4E49;  // "OMNI"
-    out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-    
-    // Write next user ID
-    out.write(reinterpret_cast<const char*>(&nextUserId_), sizeof(nextUserId_));
-    
-    // Write users
-    uint32_t userCount = (uint32_t)users_.size();
-    out.write(reinterpret_cast<const char*>(&userCount), sizeof(userCount));
-    
-    for (const auto& user : users_) {
-        out.write(reinterpret_cast<const char*>(&user.id), sizeof(user.id));
-        
-        uint32_t emailLen = user.email.size();
-        out.write(reinterpret_cast<const char*>(&emailLen), sizeof(emailLen));
-        out.write(user.email.c_str(), emailLen);
-        
-        uint32_t usernameLen = user.username.size();
-        out.write(reinterpret_cast<const char*>(&usernameLen), sizeof(usernameLen));
-        out.write(user.username.c_str(), usernameLen);
-        
-        uint32_t hashLen = user.passwordHash.size();
-        out.write(reinterpret_cast<const char*>(&hashLen), sizeof(hashLen));
-        out.write(user.passwordHash.c_str(), hashLen);
-        
-        out.write(reinterpret_cast<const char*>(&user.registrationTime), sizeof(user.registrationTime));
-    }
-    
-    // Write episodes
-    uint32_t episodeCount = (uint32_t)episodes_.size();
-    out.write(reinterpret_cast<const char*>(&episodeCount), sizeof(episodeCount));
-    
-    for (const auto& episode : episodes_) {
-        out.write(reinterpret_cast<const char*>(&episode.episodeNumber), sizeof(episode.episodeNumber));
-        out.write(reinterpret_cast<const char*>(&episode.startTimestamp), sizeof(episode.startTimestamp));
-        out.write(reinterpret_cast<const char*>(&episode.endTimestamp), sizeof(episode.endTimestamp));
-    }
-
-    // Write sessions
-    uint32_t sessionCount = (uint32_t)sessions_.size();
-    out.write(reinterpret_cast<const char*>(&sessionCount), sizeof(sessionCount));
-    for (const auto &p : sessions_) {
-        const std::string &sid = p.first;
-        uint32_t uid = p.second;
-        uint32_t sidLen = (uint32_t)sid.size();
-        out.write(reinterpret_cast<const char*>(&sidLen), sizeof(sidLen));
-        out.write(sid.c_str(), sidLen);
-        out.write(reinterpret_cast<const char*>(&uid), sizeof(uid));
-    }
-}
-
-void Database::deserialize(std::ifstream& in) {
+// Format 1 files are read whole into memory; load() then rewrites them
+void Database::deserialize(std::istream& in) {
     // Read magic number
     uint32_t magic;
     in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    if (magic != 0x4F4D4E49) {
+    if (magic != DATABASE_MAGIC_V1) {
         throw std::runtime_error("Invalid database file format");
     }
     
+    clear();
+    
     // Read next user ID
     in.read(reinterpret_cast<char*>(&nextUserId_), sizeof(nextUserId_));
     
@@ -241,10 +547,6 @@ void Database::deserialize(std::ifstream& in) {
     uint32_t userCount;
     in.read(reinterpret_cast<char*>(&userCount), sizeof(userCount));
     
-    users_.clear();
-    emailToUserId_.clear();
-    userIdIndex_ = BTree(5);
-    
     for (uint32_t i = 0; i < userCount; ++i) {
         User user;
         in.read(reinterpret_cast<char*>(&user.id), sizeof(user.id));
@@ -266,24 +568,23 @@ void Database::deserialize(std::ifstream& in) {
         
         in.read(reinterpret_cast<char*>(&user.registrationTime), sizeof(user.registrationTime));
         
-        users_.push_back(user);
-        emailToUserId_[user.email] = user.id;
-        userIdIndex_.insert(user.id, users_.size() - 1);
+        insertUser(user);
+    }
+    if (!in) {
+        throw std::runtime_error("Truncated database file");
     }
     
     // Read episodes
     uint32_t episodeCount;
     in.read(reinterpret_cast<char*>(&episodeCount), sizeof(episodeCount));
     
-    episodes_.clear();
-    
     for (uint32_t i = 0; i < episodeCount; ++i) {
         EpisodeMetadata episode;
         in.read(reinterpret_cast<char*>(&episode.episodeNumber), sizeof(episode.episodeNumber));
         in.read(reinterpret_cast<char*>(&episode.startTimestamp), sizeof(episode.startTimestamp));
         in.read(reinterpret_cast<char*>(&episode.endTimestamp), sizeof(episode.endTimestamp));
         
-        episodes_.push_back(episode);
+        insertEpisode(episode);
     }
     
     // Read sessions
@@ -297,7 +598,7 @@ void Database::deserialize(std::ifstream& in) {
         in.read(&sid[0], sidLen);
         uint32_t uid = 0;
         in.read(reinterpret_cast<char*>(&uid), sizeof(uid));
-        sessions_[sid] = uid;
+        editSessions(sid)[sid] = uid;
     }
-    std::cout << "Database loaded: " << userCount << " users, " << episodeCount << " episodes" << std::endl;
+    LOG_INFO("Database loaded (format 1): ", userCount, " users, ", episodeCount, " episodes");
 }
\ No newline at end of file
@@ -2,36 +2,43 @@
 #define DATABASE_H
 
 #include "btree.h"
+#include "database_file.h"
+#include "write_ahead_log.h"
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <memory>
 #include <vector>
+#include <deque>
 #include <unordered_map>
-#include <fstream>
-
-// User structure
-struct User {
-    uint32_t id;
-    std::string email;
-    std::string username;
-    std::string passwordHash;
-    uint64_t registrationTime;
-};
-
-// Episode metadata
-struct EpisodeMetadata {
-    uint32_t episodeNumber;
-    uint64_t startTimestamp;
-    uint64_t endTimestamp;
-};
+#include <mutex>
+#include <istream>
 
+// Users, sessions and episode history. The base file holds a full snapshot
+// and is memory-mapped (users are looked up through its persisted indexes,
+// so startup does not depend on the number of users); users registered since
+// it was written are kept in memory. Every change is appended to
+// `<file>.wal` and is on disk before the call that made it returns. load()
+// replays the log over the base file, and checkpoint() folds it back into a
+// new base file version while requests keep being served.
 class Database {
 public:
     Database(const std::string& filename);
     ~Database();
     
+    // Base file plus log; false if neither had anything to load
     bool load();
+    // Commit a new base file version from a point-in-time view and drop the
+    // log it covers. Users registered since the last one are appended with
+    // indexes of their own (merged into the newest segments of similar size,
+    // so a user is rewritten O(log users) times); episodes and all sessions
+    // are written again. With 200k users that is about 2 ms after 1000
+    // registrations. Once superseded data outweighs live data the whole file
+    // is rewritten instead (about 150 ms for 200k users). A format 1 file is
+    // rewritten this way right after load().
     bool save();
+    // save(), unless nothing was logged since the last one
+    bool checkpoint();
     void initialize();
     
     // User management
@@ -50,23 +57,53 @@ public:
     std::vector<EpisodeMetadata> getEpisodeHistory(int count);
     
 private:
+    // Log record types
+    enum WalRecord : uint8_t {
+        WalUserRegistered = 1,
+        WalSessionCreated = 2,
+        WalSessionRemoved = 3,
+        WalEpisodeSaved = 4
+    };
+    
+    // Sessions in shards, each with its encoding from the last checkpoint.
+    // A checkpoint holds on to the shards while writing them, and a shard it
+    // holds is copied before it is changed.
+    struct SessionShard {
+        std::unordered_map<std::string, uint32_t> sessions;
+        std::shared_ptr<const std::string> encoded;   // Null once changed
+    };
+    
     std::string filename_;
+    std::mutex checkpointMutex_;   // One checkpoint at a time; taken before mutex_
+    std::mutex mutex_;             // Guards everything below
+    WriteAheadLog wal_;
     uint32_t nextUserId_;
     
-    // In-memory structures
-    BTree userIdIndex_;          // B-Tree: userId -> User offset
+    // Base file, and users registered since it was written
+    std::unique_ptr<DatabaseFile> base_;   // Swapped only under checkpointMutex_ too
+    BTree<> userIdIndex_;        // B+ tree: userId -> User offset
     std::unordered_map<std::string, uint32_t> emailToUserId_;  // Hash: email -> userId
-    std::unordered_map<std::string, uint32_t> sessions_;       // Hash: sessionId -> userId
-    std::vector<User> users_;
+    std::vector<std::shared_ptr<SessionShard>> sessionShards_;   // Hash: sessionId -> userId
+    std::deque<User> users_;     // Never moved, so a checkpoint can refer to them
     std::vector<EpisodeMetadata> episodes_;
     
-    // Helper functions
+    // Helper functions (called with mutex_ held)
     std::string hashPassword(const std::string& password);
     bool verifyPassword(const std::string& password, const std::string& hash);
+    uint32_t addUser(const std::string& email, const std::string& username, const std::string& passwordHash,
+                     uint64_t registrationTime, uint64_t& lsn);
+    bool findUser(uint32_t userId, User& out);
+    uint32_t findUserId(const std::string& email);
+    void insertUser(const User& user);
+    void insertEpisode(const EpisodeMetadata& episode);
+    void clear();
+    const std::unordered_map<std::string, uint32_t>& sessions(const std::string& sessionId) const;
+    std::unordered_map<std::string, uint32_t>& editSessions(const std::string& sessionId);
+    void applyRecord(uint8_t type, std::string_view payload);
     
     // Serialization
-    void serialize(std::ofstream& out);
-    void deserialize(std::ifstream& in);
+    bool writeCheckpoint(bool force);
+    void deserialize(std::istream& in);   // Format 1
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,597 @@
+#include "database_file.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Records are read in place from the mapping (the format is little-endian,
+// like every host this runs on)
+struct DatabaseFile::UserRecord {
+    uint32_t id;
+    uint32_t emailLength;
+    uint32_t usernameLength;
+    uint32_t hashLength;
+    uint64_t registrationTime;
+    uint64_t stringOffset;
+};
+
+namespace {
+
+const uint32_t DB_PAGE_SIZE = 4096;
+const size_t HEADER_SLOT_SIZE = 2048;
+const size_t HEADER_SIZE = 92;
+const size_t RECORD_SIZE = 32;
+const size_t SEGMENT_SIZE = 56;
+const size_t EPISODE_SIZE = 24;
+const size_t NODE_KEYS = 511;
+const size_t WRITE_BUFFER_BYTES = 1 << 20;
+
+// Superseded bytes a file may carry before the next write compacts it, if
+// there are fewer live bytes than this
+const uint64_t MIN_GARBAGE_BYTES = 4 << 20;
+
+struct IndexNode {
+    uint32_t count;
+    uint32_t level;   // 0 for leaves
+    uint32_t keys[NODE_KEYS];
+    uint32_t values[NODE_KEYS];
+};
+static_assert(sizeof(IndexNode) == DB_PAGE_SIZE, "index nodes fill one page");
+
+template <typename T>
+T loadAt(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+void putFixed(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += (char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t alignPage(uint64_t offset) {
+    return (offset + DB_PAGE_SIZE - 1) / DB_PAGE_SIZE * DB_PAGE_SIZE;
+}
+
+// FNV-1a, for email hashes and header checksums
+uint32_t fnv1a(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+// Buffered sequential writer that knows its file offset, for page padding
+struct FileWriter {
+    int fd;
+    uint64_t offset;
+    bool ok = true;
+    std::string buffer;
+    
+    FileWriter(int fd, uint64_t offset) : fd(fd), offset(offset) {}
+    
+    void write(const void* data, size_t size) {
+        if (buffer.size() + size > WRITE_BUFFER_BYTES) {
+            flush();
+        }
+        if (size >= WRITE_BUFFER_BYTES) {
+            ok = ok && writeAll(fd, static_cast<const char*>(data), size);
+        } else {
+            buffer.append(static_cast<const char*>(data), size);
+        }
+        offset += size;
+    }
+    
+    void flush() {
+        ok = ok && writeAll(fd, buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    
+    void padTo(uint64_t target) {
+        static const char zeros[DB_PAGE_SIZE] = {};
+        while (ok && offset < target) {
+            write(zeros, (size_t)std::min<uint64_t>(target - offset, sizeof(zeros)));
+        }
+    }
+};
+
+// Bulk-load the ID index from (id, record) pairs sorted by id
+std::vector<IndexNode> buildIdIndex(const std::vector<std::pair<uint32_t, uint32_t>>& entries) {
+    std::vector<IndexNode> nodes;
+    nodes.reserve(entries.size() / NODE_KEYS + 2);
+    for (size_t i = 0; i < entries.size() || nodes.empty(); i += NODE_KEYS) {
+        IndexNode leaf{};
+        leaf.count = (uint32_t)std::min(NODE_KEYS, entries.size() - i);
+        for (uint32_t j = 0; j < leaf.count; ++j) {
+            leaf.keys[j] = entries[i + j].first;
+            leaf.values[j] = entries[i + j].second;
+        }
+        nodes.push_back(leaf);
+    }
+    
+    // One level of parents at a time until a single root is left
+    size_t levelStart = 0;
+    for (uint32_t level = 1; nodes.size() - levelStart > 1; ++level) {
+        size_t levelEnd = nodes.size();
+        for (size_t child = levelStart; child < levelEnd; child += NODE_KEYS) {
+            IndexNode parent{};
+            parent.level = level;
+            parent.count = (uint32_t)std::min(NODE_KEYS, levelEnd - child);
+            for (uint32_t j = 0; j < parent.count; ++j) {
+                parent.keys[j] = nodes[child + j].keys[0];
+                parent.values[j] = (uint32_t)(child + j);
+            }
+            nodes.push_back(parent);
+        }
+        levelStart = levelEnd;
+    }
+    return nodes;
+}
+
+// Record stored under `id` in one segment's ID index, or -1
+int64_t searchIdIndex(const IndexNode* nodes, uint64_t pages, uint32_t id) {
+    uint64_t n = pages - 1;   // Root
+    while (true) {
+        const IndexNode& node = nodes[n];
+        const uint32_t* keys = node.keys;
+        const uint32_t* end = keys + std::min<uint32_t>(node.count, NODE_KEYS);
+        if (node.level == 0) {
+            const uint32_t* it = std::lower_bound(keys, end, id);
+            return it != end && *it == id ? (int64_t)node.values[it - keys] : -1;
+        }
+        const uint32_t* it = std::upper_bound(keys, end, id);
+        if (it == keys) {
+            return -1;
+        }
+        // Children are written before their parents, which also rules out cycles
+        uint32_t child = node.values[it - keys - 1];
+        if (child >= n) {
+            return -1;
+        }
+        n = child;
+    }
+}
+
+}  // namespace
+
+DatabaseFile::DatabaseFile()
+    : data_(nullptr), size_(0), length_(0), generation_(0), stringBytes_(0), nextUserId_(1), userCount_(0),
+      sessionCount_(0), sessionsOffset_(0), sessionsSize_(0) {
+}
+
+DatabaseFile::~DatabaseFile() {
+    close();
+}
+
+bool DatabaseFile::write(const std::string& path, const Image& image) {
+    static_assert(sizeof(UserRecord) == RECORD_SIZE, "user records are 32 bytes");
+    static_assert(sizeof(Segment) == SEGMENT_SIZE, "segment table entries are 56 bytes");
+    
+    const DatabaseFile* base = image.base && image.base->data_ ? image.base : nullptr;
+    uint64_t userCount = (uint64_t)(base ? base->userCount_ : 0) + image.users.size();
+    if (userCount >= UINT32_MAX) {
+        return false;
+    }
+    
+    // Append to the base file unless more of it is superseded than live
+    // (index sizes estimated)
+    bool append = false;
+    if (base && base->path_ == path) {
+        uint64_t live = DB_PAGE_SIZE + base->stringBytes_ + (uint64_t)base->userCount_ * (RECORD_SIZE + 32) +
+                        base->sessionsSize_ + base->segments_.size() * 3 * DB_PAGE_SIZE;
+        append = base->length_ - std::min(base->length_, live) <= std::max(live, MIN_GARBAGE_BYTES);
+    }
+    
+    // Base segments that stay as they are; the rest are merged into the new
+    // one. When appending, the newest are merged while they hold at most
+    // twice the users merged so far, so segment sizes at least double from
+    // newest to oldest and a user is rewritten O(log users) times.
+    size_t keep = 0;
+    if (append) {
+        keep = base->segments_.size();
+        uint64_t merged = image.users.size();
+        while (merged > 0 && keep > 0 && base->segments_[keep - 1].count <= 2 * merged) {
+            merged += base->segments_[--keep].count;
+        }
+    }
+    
+    std::string tempPath = path + ".tmp";
+    int fd = append ? ::open(path.c_str(), O_WRONLY | O_CLOEXEC)
+                    : ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    FileWriter out{fd, append ? base->length_ : 0};
+    out.ok = fd >= 0 && (!append || lseek(fd, (off_t)base->length_, SEEK_SET) >= 0);
+    if (!append) {
+        out.padTo(DB_PAGE_SIZE);   // Header slots, written last
+    }
+    
+    // The new segment: users of the merged base segments (of all of them
+    // when compacting), then the new users. Compacting moves the base's
+    // strings next to the new segment; appending leaves them where they are.
+    std::vector<Segment> segments;
+    if (base) {
+        segments.assign(base->segments_.begin(), base->segments_.begin() + keep);
+    }
+    uint32_t firstRecord = !base ? 0 : keep < base->segments_.size() ? base->segments_[keep].firstRecord
+                                                                     : base->userCount_;
+    uint64_t stringBytes = base ? base->stringBytes_ : 0;
+    std::vector<UserRecord> records;
+    std::vector<uint64_t> emails;   // Email index entries
+    std::vector<std::pair<uint32_t, uint32_t>> ids;
+    records.reserve(userCount - firstRecord);
+    emails.reserve(userCount - firstRecord);
+    ids.reserve(userCount - firstRecord);
+    for (size_t s = keep; base && s < base->segments_.size(); ++s) {
+        const Segment& segment = base->segments_[s];
+        for (uint32_t i = 0; i < segment.count; ++i) {
+            UserRecord record;
+            if (!base->readRecord(segment.firstRecord + i, record)) {
+                LOG_WARN("Database file ", path, " has a record outside the file");
+                out.ok = false;
+                break;
+            }
+            if (!append) {
+                uint64_t offset = out.offset;
+                out.write(base->data_ + record.stringOffset,
+                          (size_t)record.emailLength + record.usernameLength + record.hashLength);
+                record.stringOffset = offset;
+            }
+            records.push_back(record);
+        }
+        
+        // Index entries carry the hash and record number, so they are
+        // reused without reading the strings
+        const uint8_t* slot = base->data_ + segment.emailIndex;
+        for (uint64_t i = 0; i < segment.emailSlots; ++i, slot += 8) {
+            if (uint64_t entry = loadAt<uint64_t>(slot)) {
+                emails.push_back(entry);
+            }
+        }
+        const IndexNode* node = reinterpret_cast<const IndexNode*>(base->data_ + segment.idIndex);
+        const IndexNode* end = node + segment.idPages;
+        for (; node != end && node->level == 0; ++node) {
+            for (uint32_t j = 0; j < std::min<uint32_t>(node->count, NODE_KEYS); ++j) {
+                ids.emplace_back(node->keys[j], node->values[j]);
+            }
+        }
+    }
+    for (const User* user : image.users) {
+        uint32_t record = firstRecord + (uint32_t)records.size();
+        records.push_back({user->id, (uint32_t)user->email.size(), (uint32_t)user->username.size(),
+                           (uint32_t)user->passwordHash.size(), user->registrationTime, out.offset});
+        out.write(user->email.data(), user->email.size());
+        out.write(user->username.data(), user->username.size());
+        out.write(user->passwordHash.data(), user->passwordHash.size());
+        stringBytes += user->email.size() + user->username.size() + user->passwordHash.size();
+        emails.push_back((uint64_t)fnv1a(user->email.data(), user->email.size()) << 32 | (record + 1));
+        ids.emplace_back(user->id, record);
+    }
+    
+    if (!records.empty()) {
+        Segment segment{};
+        segment.firstRecord = firstRecord;
+        segment.count = (uint32_t)records.size();
+        out.padTo(alignPage(out.offset));
+        segment.records = out.offset;
+        out.write(records.data(), records.size() * RECORD_SIZE);
+        
+        size_t slots = 16;
+        while (slots < 2 * records.size()) {
+            slots *= 2;
+        }
+        std::vector<uint64_t> table(slots, 0);
+        for (uint64_t entry : emails) {
+            size_t i = (entry >> 32) & (slots - 1);
+            while (table[i] != 0) {
+                i = (i + 1) & (slots - 1);
+            }
+            table[i] = entry;
+        }
+        out.padTo(alignPage(out.offset));
+        segment.emailIndex = out.offset;
+        segment.emailSlots = slots;
+        out.write(table.data(), slots * sizeof(uint64_t));
+        
+        if (!std::is_sorted(ids.begin(), ids.end())) {
+            std::sort(ids.begin(), ids.end());
+        }
+        std::vector<IndexNode> nodes = buildIdIndex(ids);
+        segment.minId = ids.front().first;
+        segment.maxId = ids.back().first;
+        out.padTo(alignPage(out.offset));
+        segment.idIndex = out.offset;
+        segment.idPages = nodes.size();
+        out.write(nodes.data(), nodes.size() * sizeof(IndexNode));
+        segments.push_back(segment);
+    }
+    
+    uint64_t segmentsOffset = out.offset;
+    out.write(segments.data(), segments.size() * SEGMENT_SIZE);
+    uint64_t episodesOffset = out.offset;
+    for (const auto& episode : image.episodes) {
+        std::string bytes;
+        putFixed(bytes, episode.episodeNumber, 4);
+        putFixed(bytes, 0, 4);
+        putFixed(bytes, episode.startTimestamp, 8);
+        putFixed(bytes, episode.endTimestamp, 8);
+        out.write(bytes.data(), bytes.size());
+    }
+    uint64_t sessionsOffset = out.offset;
+    for (const auto& bytes : image.sessions) {
+        out.write(bytes->data(), bytes->size());
+    }
+    uint64_t length = out.offset;
+    out.flush();
+    
+    // The data must be on disk before the header that points at it; the
+    // header goes in the slot the base is not using
+    uint64_t generation = base ? base->generation_ + 1 : 1;
+    std::string header = "OMN2";
+    putFixed(header, DATABASE_FORMAT_VERSION, 2);
+    putFixed(header, 0, 2);
+    putFixed(header, DB_PAGE_SIZE, 4);
+    putFixed(header, image.nextUserId, 4);
+    putFixed(header, userCount, 4);
+    putFixed(header, image.sessionCount, 4);
+    putFixed(header, image.episodes.size(), 4);
+    putFixed(header, segments.size(), 4);
+    putFixed(header, generation, 8);
+    putFixed(header, length, 8);
+    putFixed(header, stringBytes, 8);
+    putFixed(header, segmentsOffset, 8);
+    putFixed(header, episodesOffset, 8);
+    putFixed(header, sessionsOffset, 8);
+    putFixed(header, length - sessionsOffset, 8);
+    putFixed(header, fnv1a(header.data(), header.size()), 4);
+    out.ok = out.ok && (!append || ::fsync(fd) == 0) &&
+             ::pwrite(fd, header.data(), header.size(), (off_t)(generation % 2 * HEADER_SLOT_SIZE)) ==
+                 (ssize_t)header.size() &&
+             ::fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    
+    if (append) {
+        if (!out.ok) {
+            LOG_WARN("Failed to append to database file ", path, ": ", strerror(errno));
+        }
+        return out.ok;
+    }
+    if (!out.ok || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOG_WARN("Failed to write database file ", path, ": ", strerror(errno));
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    
+    // Make the rename itself durable
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+    return true;
+}
+
+bool DatabaseFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)DB_PAGE_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // The mapping keeps the file
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    path_ = path;
+    data_ = static_cast<const uint8_t*>(mapping);
+    size_ = (size_t)st.st_size;
+    
+    if (!parseHeader()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void DatabaseFile::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    path_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    length_ = 0;
+    generation_ = 0;
+    stringBytes_ = 0;
+    nextUserId_ = 1;
+    userCount_ = 0;
+    sessionCount_ = 0;
+    sessionsOffset_ = 0;
+    sessionsSize_ = 0;
+    segments_.clear();
+    episodes_.clear();
+}
+
+bool DatabaseFile::parseHeader() {
+    // A slot is torn if a crash interrupted its write; the other one then
+    // still holds the previous version
+    const uint8_t* header = nullptr;
+    for (size_t slot = 0; slot < 2; ++slot) {
+        const uint8_t* candidate = data_ + slot * HEADER_SLOT_SIZE;
+        if (memcmp(candidate, "OMN2", 4) != 0 || loadAt<uint16_t>(candidate + 4) != DATABASE_FORMAT_VERSION ||
+            loadAt<uint32_t>(candidate + 8) != DB_PAGE_SIZE ||
+            loadAt<uint32_t>(candidate + HEADER_SIZE - 4) != fnv1a(candidate, HEADER_SIZE - 4)) {
+            continue;
+        }
+        if (!header || loadAt<uint64_t>(candidate + 32) > loadAt<uint64_t>(header + 32)) {
+            header = candidate;
+        }
+    }
+    if (!header) {
+        return false;
+    }
+    nextUserId_ = loadAt<uint32_t>(header + 12);
+    userCount_ = loadAt<uint32_t>(header + 16);
+    sessionCount_ = loadAt<uint32_t>(header + 20);
+    uint32_t episodeCount = loadAt<uint32_t>(header + 24);
+    uint32_t segmentCount = loadAt<uint32_t>(header + 28);
+    generation_ = loadAt<uint64_t>(header + 32);
+    length_ = loadAt<uint64_t>(header + 40);
+    stringBytes_ = loadAt<uint64_t>(header + 48);
+    uint64_t segmentsOffset = loadAt<uint64_t>(header + 56);
+    uint64_t episodesOffset = loadAt<uint64_t>(header + 64);
+    sessionsOffset_ = loadAt<uint64_t>(header + 72);
+    sessionsSize_ = loadAt<uint64_t>(header + 80);
+    
+    // Everything must lie within the committed part of the file
+    if (length_ > size_) {
+        return false;
+    }
+    auto inFile = [this](uint64_t offset, uint64_t size) { return offset <= length_ && size <= length_ - offset; };
+    if (!inFile(segmentsOffset, (uint64_t)segmentCount * SEGMENT_SIZE) ||
+        !inFile(episodesOffset, (uint64_t)episodeCount * EPISODE_SIZE) || !inFile(sessionsOffset_, sessionsSize_)) {
+        return false;
+    }
+    uint64_t records = 0;
+    for (uint32_t i = 0; i < segmentCount; ++i) {
+        Segment segment = loadAt<Segment>(data_ + segmentsOffset + (uint64_t)i * SEGMENT_SIZE);
+        uint64_t slots = segment.emailSlots;
+        if (segment.firstRecord != records || segment.count == 0 ||
+            !inFile(segment.records, (uint64_t)segment.count * RECORD_SIZE) || slots == 0 ||
+            (slots & (slots - 1)) != 0 || slots > length_ / 8 || !inFile(segment.emailIndex, slots * 8) ||
+            segment.idPages == 0 || segment.idPages > length_ / DB_PAGE_SIZE ||
+            segment.idIndex % DB_PAGE_SIZE != 0 || !inFile(segment.idIndex, segment.idPages * DB_PAGE_SIZE)) {
+            return false;
+        }
+        records += segment.count;
+        segments_.push_back(segment);
+    }
+    if (records != userCount_) {
+        return false;
+    }
+    
+    const uint8_t* episode = data_ + episodesOffset;
+    for (uint32_t i = 0; i < episodeCount; ++i, episode += EPISODE_SIZE) {
+        episodes_.push_back({loadAt<uint32_t>(episode), loadAt<uint64_t>(episode + 8), loadAt<uint64_t>(episode + 16)});
+    }
+    return true;
+}
+
+const DatabaseFile::Segment* DatabaseFile::segmentOf(uint32_t record) const {
+    if (record >= userCount_) {
+        return nullptr;
+    }
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), record,
+                               [](uint32_t r, const Segment& segment) { return r < segment.firstRecord; });
+    return &*(it - 1);   // The first segment starts at record 0
+}
+
+// False if the record or its strings lie outside the file
+bool DatabaseFile::readRecord(uint32_t record, UserRecord& out) const {
+    const Segment* segment = segmentOf(record);
+    if (!segment) {
+        return false;
+    }
+    out = loadAt<UserRecord>(data_ + segment->records + (uint64_t)(record - segment->firstRecord) * RECORD_SIZE);
+    uint64_t length = (uint64_t)out.emailLength + out.usernameLength + out.hashLength;
+    return out.stringOffset <= length_ && length <= length_ - out.stringOffset;
+}
+
+int64_t DatabaseFile::findById(uint32_t id) const {
+    for (const Segment& segment : segments_) {
+        if (id < segment.minId || id > segment.maxId) {
+            continue;
+        }
+        int64_t record = searchIdIndex(reinterpret_cast<const IndexNode*>(data_ + segment.idIndex),
+                                       segment.idPages, id);
+        if (record >= 0) {
+            return record;
+        }
+    }
+    return -1;
+}
+
+int64_t DatabaseFile::findByEmail(const std::string& email) const {
+    uint32_t hash = fnv1a(email.data(), email.size());
+    for (const Segment& segment : segments_) {
+        const uint8_t* table = data_ + segment.emailIndex;
+        size_t slots = segment.emailSlots;
+        for (size_t probe = 0, i = hash & (slots - 1); probe < slots; ++probe, i = (i + 1) & (slots - 1)) {
+            uint64_t entry = loadAt<uint64_t>(table + i * 8);
+            if (entry == 0) {
+                break;
+            }
+            UserRecord r;
+            uint32_t record = (uint32_t)entry - 1;
+            if ((uint32_t)(entry >> 32) != hash || !readRecord(record, r)) {
+                continue;
+            }
+            if (r.emailLength == email.size() && memcmp(data_ + r.stringOffset, email.data(), email.size()) == 0) {
+                return record;
+            }
+        }
+    }
+    return -1;
+}
+
+bool DatabaseFile::user(uint32_t record, User& out) const {
+    UserRecord r;
+    if (!readRecord(record, r)) {
+        return false;
+    }
+    const char* strings = reinterpret_cast<const char*>(data_ + r.stringOffset);
+    out.id = r.id;
+    out.email.assign(strings, r.emailLength);
+    out.username.assign(strings + r.emailLength, r.usernameLength);
+    out.passwordHash.assign(strings + r.emailLength + r.usernameLength, r.hashLength);
+    out.registrationTime = r.registrationTime;
+    return true;
+}
+
+bool DatabaseFile::forEachSession(const std::function<void(const std::string&, uint32_t)>& visit) const {
+    const uint8_t* pos = data_ + sessionsOffset_;
+    const uint8_t* end = pos + sessionsSize_;
+    for (uint32_t i = 0; i < sessionCount_; ++i) {
+        if (end - pos < 4) {
+            return false;
+        }
+        uint32_t length = loadAt<uint32_t>(pos);
+        if ((uint64_t)(end - pos) < 8 + (uint64_t)length) {
+            return false;
+        }
+        std::string sessionId(reinterpret_cast<const char*>(pos + 4), length);
+        visit(sessionId, loadAt<uint32_t>(pos + 4 + length));
+        pos += 8 + length;
+    }
+    return true;
+}
@@ -0,0 +1,160 @@
+#ifndef DATABASE_FILE_H
+#define DATABASE_FILE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// User structure
+struct User {
+    uint32_t id;
+    std::string email;
+    std::string username;
+    std::string passwordHash;
+    uint64_t registrationTime;
+};
+
+// Episode metadata
+struct EpisodeMetadata {
+    uint32_t episodeNumber;
+    uint64_t startTimestamp;
+    uint64_t endTimestamp;
+};
+
+// Database file, format v2 (little-endian, 4 KiB pages). The file only
+// grows: a checkpoint appends what changed and then commits a new header, so
+// the data of the committed version is never overwritten.
+//
+// Page 0 holds two header slots, at offsets 0 and 2048; the valid one with
+// the higher generation is current, and a commit writes the other one.
+//
+//   offset size  field
+//   0      4     magic "OMN2"
+//   4      2     format version (2)
+//   6      2     reserved (0)
+//   8      4     page size (4096)
+//   12     4     next user ID
+//   16     4     user count
+//   20     4     session count
+//   24     4     episode count
+//   28     4     segment count
+//   32     8     generation
+//   40     8     committed length of the file
+//   48     8     string bytes of all users
+//   56     8     segment table offset
+//   64     8     episodes offset
+//   72     8     sessions offset, then size
+//   88     4     FNV-1a of bytes 0-87
+//
+// Users are stored in segments, each covering a run of records and written
+// by one checkpoint (or by merging the newest segments). Every offset is
+// absolute.
+//   - Segment table: 56 bytes per segment, oldest first: u32 first record,
+//     u32 record count, u32 smallest ID, u32 largest ID, u64 records offset,
+//     u64 email index offset, u64 email index slots, u64 ID index offset, u64
+//     ID index pages.
+//   - Records (page-aligned): 32 bytes each, in registration order: u32 id,
+//     u32 email length, u32 username length, u32 password hash length, u64
+//     registration time, u64 offset of the three strings (back to back).
+//   - Strings: written just before the records of the segment that added
+//     them, and left in place when segments are merged.
+//   - Email index (page-aligned): open-addressing hash table (power-of-two
+//     slots, linear probing); each u64 slot is FNV-1a(email) << 32 |
+//     (record + 1), 0 = empty.
+//   - ID index (page-aligned): B+ tree of 4 KiB nodes (u32 key count, u32
+//     level, 511 u32 keys, 511 u32 values), leaves first in key order, root
+//     last. Leaf values are records; inner keys are the smallest key under
+//     each child and values the child's node number.
+//   - Episodes: 24-byte records: u32 number, u32 reserved, u64 start, u64 end.
+//   - Sessions: per session u32 length + session ID, u32 user ID.
+//
+// Version 1 files (magic 0x4F4D4E49) are read by Database::load, which
+// rewrites them in this format right away (through save()).
+const uint16_t DATABASE_FORMAT_VERSION = 2;
+
+// Read-only, memory-mapped view of one file version. Opening maps the file
+// and checks the header and segment table, so it takes the same time for any
+// number of users; records and index pages are read from the mapping on
+// lookup, which probes each segment (there are O(log users) of them).
+class DatabaseFile {
+public:
+    // What a new file version holds: the users of `base` (if any) followed by
+    // `users`, plus the rest as given
+    struct Image {
+        uint32_t nextUserId = 1;
+        const DatabaseFile* base = nullptr;
+        std::vector<const User*> users;
+        std::vector<EpisodeMetadata> episodes;
+        uint32_t sessionCount = 0;
+        std::vector<std::shared_ptr<const std::string>> sessions;   // Encoded session entries
+    };
+    
+    DatabaseFile();
+    ~DatabaseFile();
+    DatabaseFile(const DatabaseFile&) = delete;
+    DatabaseFile& operator=(const DatabaseFile&) = delete;
+    
+    // Make `image` the next version of the file at `path`. When `base` is
+    // that file, the new users are appended as a segment, merged with the
+    // newest segments while those hold at most twice as many users, followed
+    // by the episodes and sessions and a new header: the cost follows the
+    // new users and the sessions, not the size of the file. Once more than
+    // half the file is superseded data (or without a base), every user is
+    // written to a temporary file that is renamed to `path` instead.
+    static bool write(const std::string& path, const Image& image);
+    
+    // False if the file is missing, truncated or not a v2 file
+    bool open(const std::string& path);
+    void close();
+    
+    uint32_t nextUserId() const { return nextUserId_; }
+    uint32_t userCount() const { return userCount_; }
+    const std::vector<EpisodeMetadata>& episodes() const { return episodes_; }
+    
+    // Record number of a user, or -1
+    int64_t findById(uint32_t id) const;
+    int64_t findByEmail(const std::string& email) const;
+    
+    // False if the record points outside the file
+    bool user(uint32_t record, User& out) const;
+    
+    // False if the session section is malformed
+    bool forEachSession(const std::function<void(const std::string&, uint32_t)>& visit) const;
+
+private:
+    struct UserRecord;
+    
+    struct Segment {
+        uint32_t firstRecord;
+        uint32_t count;
+        uint32_t minId;
+        uint32_t maxId;
+        uint64_t records;
+        uint64_t emailIndex;
+        uint64_t emailSlots;
+        uint64_t idIndex;
+        uint64_t idPages;
+    };
+    
+    std::string path_;
+    const uint8_t* data_;
+    size_t size_;       // Mapped bytes
+    uint64_t length_;   // Committed bytes, at most size_
+    uint64_t generation_;
+    uint64_t stringBytes_;
+    uint32_t nextUserId_;
+    uint32_t userCount_;
+    uint32_t sessionCount_;
+    uint64_t sessionsOffset_;
+    uint64_t sessionsSize_;
+    std::vector<Segment> segments_;
+    std::vector<EpisodeMetadata> episodes_;
+    
+    bool parseHeader();
+    const Segment* segmentOf(uint32_t record) const;
+    bool readRecord(uint32_t record, UserRecord& out) const;
+};
+
+#endif
@@ -0,0 +1,488 @@
+#include "episode_archive.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t HEADER_SIZE = 8;
+const size_t BLOCK_HEADER_SIZE = 12;
+const size_t TRAILER_SIZE = 16;
+
+void putFixed(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += (char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Run-length encode one plane of `cells` values
+template <typename Get, typename Put>
+void putRuns(std::string& out, size_t cells, Get get, Put putValue) {
+    size_t i = 0;
+    while (i < cells) {
+        auto value = get(i);
+        size_t run = 1;
+        while (i + run < cells && get(i + run) == value) {
+            ++run;
+        }
+        putVarint(out, run);
+        putValue(out, value);
+        i += run;
+    }
+}
+
+// Bounds-checked cursor over mapped bytes; any overrun sets ok = false and
+// reads zeros from then on
+struct ByteReader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok = true;
+    
+    uint64_t fixed(int bytes) {
+        if (end - pos < bytes) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= (uint64_t)pos[i] << (8 * i);
+        }
+        pos += bytes;
+        return value;
+    }
+    
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos == end) {
+                break;
+            }
+            uint8_t byte = *pos++;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+    
+    std::string string(size_t length) {
+        if ((size_t)(end - pos) < length) {
+            ok = false;
+            return std::string();
+        }
+        std::string value(reinterpret_cast<const char*>(pos), length);
+        pos += length;
+        return value;
+    }
+};
+
+// Decode one run-length plane into `out` (exactly out.size() values)
+template <typename T, typename Get>
+bool readRuns(ByteReader& in, std::vector<T>& out, Get getValue) {
+    size_t i = 0;
+    while (i < out.size() && in.ok) {
+        uint64_t run = in.varint();
+        T value = (T)getValue(in);
+        if (run == 0 || run > out.size() - i) {
+            return false;
+        }
+        std::fill(out.begin() + i, out.begin() + i + run, value);
+        i += run;
+    }
+    return in.ok;
+}
+
+}  // namespace
+
+EpisodeArchive::EpisodeArchive() : data_(nullptr), size_(0), info_{} {
+}
+
+EpisodeArchive::~EpisodeArchive() {
+    close();
+}
+
+std::string EpisodeArchive::pathFor(uint32_t episodeNumber) {
+    return "data/episodes/episode_" + std::to_string(episodeNumber) + ".scar";
+}
+
+bool EpisodeArchive::write(const std::string& path, const ArchiveInfo& info, const std::vector<Quest>& quests,
+                           const EpisodeTimeline::LogView& log) {
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LOG_WARN("[Archive] cannot create ", tempPath);
+        return false;
+    }
+    
+    std::string header("SCAR", 4);
+    putFixed(header, ARCHIVE_FORMAT_VERSION, 2);
+    putFixed(header, 0, 2);
+    out.write(header.data(), header.size());
+    uint64_t offset = HEADER_SIZE;
+    
+    std::vector<BlockEntry> index;
+    std::string block;
+    std::string payload;
+    auto writeBlock = [&](uint8_t type, uint32_t count, uint64_t firstEvent, uint32_t firstOffsetMs) {
+        block.clear();
+        block += (char)type;
+        block.append(3, '\0');
+        putFixed(block, count, 4);
+        putFixed(block, payload.size(), 4);
+        out.write(block.data(), block.size());
+        out.write(payload.data(), payload.size());
+        uint32_t size = (uint32_t)(block.size() + payload.size());
+        index.push_back({type, offset, size, firstEvent, count, firstOffsetMs});
+        offset += size;
+        payload.clear();
+    };
+    
+    // Board replayed alongside the log, dumped as a keyframe every ARCHIVE_KEYFRAME_EVENTS
+    PixelGrid board(info.width, info.height);
+    size_t cells = (size_t)info.width * info.height;
+    
+    for (size_t first = 0; first < log.count; first += ARCHIVE_BLOCK_EVENTS) {
+        if (first > 0 && first % ARCHIVE_KEYFRAME_EVENTS == 0) {
+            const uint8_t* colors = board.colors();
+            const uint8_t* moods = board.moods();
+            putRuns(payload, cells, [&](size_t i) { return (uint8_t)(colors[i] | moods[i] << 4); },
+                    [](std::string& o, uint8_t v) { o += (char)v; });
+            putRuns(payload, cells, [&](size_t i) { return board.timestamps()[i]; }, putVarint);
+            putRuns(payload, cells, [&](size_t i) { return board.userIds()[i]; }, putVarint);
+            writeBlock(KeyframeBlock, (uint32_t)cells, first, log[first - 1].offsetMs);
+        }
+        
+        size_t end = std::min(log.count, first + ARCHIVE_BLOCK_EVENTS);
+        uint32_t previousOffset = 0;
+        int64_t previousCell = 0;
+        for (size_t i = first; i < end; ++i) {
+            const PlacementEvent& event = log[i];
+            putVarint(payload, event.offsetMs - previousOffset);
+            putVarint(payload, zigzag((int64_t)event.cell - previousCell));
+            putVarint(payload, event.userId);
+            payload += (char)((event.color & 0x0F) | event.mood << 4);
+            previousOffset = event.offsetMs;
+            previousCell = event.cell;
+            
+            board.set(event.cell % info.width, event.cell / info.width, event.color,
+                      static_cast<PixelMood>(event.mood), info.startTimestamp + event.offsetMs / 1000, event.userId);
+        }
+        writeBlock(EventBlock, (uint32_t)(end - first), first, log[first].offsetMs);
+    }
+    
+    std::string footer;
+    putFixed(footer, info.episodeNumber, 4);
+    putFixed(footer, info.startTimestamp, 8);
+    putFixed(footer, info.endTimestamp, 8);
+    putFixed(footer, (uint32_t)info.width, 4);
+    putFixed(footer, (uint32_t)info.height, 4);
+    putFixed(footer, log.count, 8);
+    putFixed(footer, info.durationMs, 4);
+    putFixed(footer, quests.size(), 4);
+    for (const auto& quest : quests) {
+        putFixed(footer, quest.description.size(), 4);
+        footer += quest.description;
+        putFixed(footer, (uint32_t)quest.progress, 4);
+        putFixed(footer, (uint32_t)quest.target, 4);
+        footer += (char)(quest.completed ? 1 : 0);
+    }
+    putFixed(footer, index.size(), 4);
+    for (const auto& entry : index) {
+        footer += (char)entry.type;
+        putFixed(footer, entry.offset, 8);
+        putFixed(footer, entry.size, 4);
+        putFixed(footer, entry.firstEvent, 8);
+        putFixed(footer, entry.count, 4);
+        putFixed(footer, entry.firstOffsetMs, 4);
+    }
+    putFixed(footer, offset, 8);
+    putFixed(footer, footer.size() - 8, 4);
+    footer.append("SCAE", 4);
+    out.write(footer.data(), footer.size());
+    
+    out.close();
+    if (!out) {
+        LOG_WARN("[Archive] failed writing ", tempPath);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOG_WARN("[Archive] cannot rename ", tempPath, " to ", path);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool EpisodeArchive::open(const std::string& path) {
+    close();
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE + TRAILER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+    size_ = (size_t)st.st_size;
+    
+    if (!parseFooter()) {
+        LOG_WARN("[Archive] ", path, " is not a valid episode archive");
+        close();
+        return false;
+    }
+    return true;
+}
+
+void EpisodeArchive::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    info_ = ArchiveInfo{};
+    quests_.clear();
+    events_.clear();
+    keyframes_.clear();
+}
+
+bool EpisodeArchive::parseFooter() {
+    ByteReader header{data_, data_ + HEADER_SIZE};
+    if (memcmp(data_, "SCAR", 4) != 0) {
+        return false;
+    }
+    header.pos += 4;
+    if (header.fixed(2) != ARCHIVE_FORMAT_VERSION) {
+        return false;
+    }
+    
+    ByteReader trailer{data_ + size_ - TRAILER_SIZE, data_ + size_};
+    uint64_t footerOffset = trailer.fixed(8);
+    uint64_t footerSize = trailer.fixed(4);
+    // Compared against what is left rather than summed, so hostile values
+    // cannot wrap around the bounds check
+    if (memcmp(trailer.pos, "SCAE", 4) != 0 || footerOffset < HEADER_SIZE ||
+        footerOffset > size_ - TRAILER_SIZE || footerSize != size_ - TRAILER_SIZE - footerOffset) {
+        return false;
+    }
+    
+    ByteReader in{data_ + footerOffset, data_ + size_ - TRAILER_SIZE};
+    info_.episodeNumber = (uint32_t)in.fixed(4);
+    info_.startTimestamp = in.fixed(8);
+    info_.endTimestamp = in.fixed(8);
+    info_.width = (int)in.fixed(4);
+    info_.height = (int)in.fixed(4);
+    info_.eventCount = in.fixed(8);
+    info_.durationMs = (uint32_t)in.fixed(4);
+    if (info_.width <= 0 || info_.height <= 0) {
+        return false;
+    }
+    
+    uint32_t questCount = (uint32_t)in.fixed(4);
+    for (uint32_t i = 0; i < questCount && in.ok; ++i) {
+        Quest quest;
+        quest.description = in.string(in.fixed(4));
+        quest.progress = (int)(uint32_t)in.fixed(4);
+        quest.target = (int)(uint32_t)in.fixed(4);
+        quest.completed = in.fixed(1) != 0;
+        quests_.push_back(std::move(quest));
+    }
+    
+    uint32_t blockCount = (uint32_t)in.fixed(4);
+    uint64_t nextEvent = 0;
+    for (uint32_t i = 0; i < blockCount && in.ok; ++i) {
+        BlockEntry entry;
+        entry.type = (uint8_t)in.fixed(1);
+        entry.offset = in.fixed(8);
+        entry.size = (uint32_t)in.fixed(4);
+        entry.firstEvent = in.fixed(8);
+        entry.count = (uint32_t)in.fixed(4);
+        entry.firstOffsetMs = (uint32_t)in.fixed(4);
+        if (entry.offset < HEADER_SIZE || entry.size < BLOCK_HEADER_SIZE || entry.size > footerOffset ||
+            entry.offset > footerOffset - entry.size) {
+            return false;
+        }
+        
+        if (entry.type == EventBlock) {
+            if (entry.firstEvent != nextEvent) {
+                return false;  // Event blocks must tile the log in order
+            }
+            nextEvent += entry.count;
+            events_.push_back(entry);
+        } else if (entry.type == KeyframeBlock) {
+            keyframes_.push_back(entry);
+        }
+    }
+    return in.ok && nextEvent == info_.eventCount;
+}
+
+bool EpisodeArchive::decodeEvents(const BlockEntry& block, std::vector<PlacementEvent>& out) const {
+    ByteReader in{data_ + block.offset, data_ + block.offset + block.size};
+    in.pos += 4;
+    uint32_t count = (uint32_t)in.fixed(4);
+    uint32_t payloadSize = (uint32_t)in.fixed(4);
+    if (count != block.count || BLOCK_HEADER_SIZE + payloadSize != block.size) {
+        return false;
+    }
+    
+    uint64_t cells = (uint64_t)info_.width * info_.height;
+    uint64_t offset = 0;
+    int64_t cell = 0;
+    out.clear();
+    out.reserve(count);
+    for (uint32_t i = 0; i < count && in.ok; ++i) {
+        offset += in.varint();
+        cell += unzigzag(in.varint());
+        uint32_t userId = (uint32_t)in.varint();
+        uint8_t packed = (uint8_t)in.fixed(1);
+        if (cell < 0 || (uint64_t)cell >= cells || offset > UINT32_MAX ||
+            (packed >> 4) > (uint8_t)PixelMood::Energetic) {
+            return false;
+        }
+        out.push_back({(uint32_t)offset, (uint32_t)cell, userId, (uint8_t)(packed & 0x0F), (uint8_t)(packed >> 4)});
+    }
+    return in.ok;
+}
+
+bool EpisodeArchive::decodeKeyframe(const BlockEntry& block, PixelGrid& board) const {
+    ByteReader in{data_ + block.offset + BLOCK_HEADER_SIZE, data_ + block.offset + block.size};
+    size_t cells = (size_t)info_.width * info_.height;
+    std::vector<uint8_t> packed(cells);
+    std::vector<uint32_t> timestamps(cells);
+    std::vector<uint32_t> userIds(cells);
+    if (!readRuns(in, packed, [](ByteReader& r) { return r.fixed(1); }) ||
+        !readRuns(in, timestamps, [](ByteReader& r) { return r.varint(); }) ||
+        !readRuns(in, userIds, [](ByteReader& r) { return r.varint(); })) {
+        return false;
+    }
+    
+    board = PixelGrid(info_.width, info_.height);
+    for (size_t i = 0; i < cells; ++i) {
+        board.set((int)(i % info_.width), (int)(i / info_.width), packed[i] & 0x0F,
+                  static_cast<PixelMood>((packed[i] >> 4) & 0x03), timestamps[i], userIds[i]);
+    }
+    return true;
+}
+
+bool EpisodeArchive::regionAt(uint64_t offsetMs, int x, int y, int w, int h, std::vector<Pixel>& out,
+                              TimelinePosition& position) const {
+    PixelGrid board;
+    if (!boardAt(offsetMs, board, position)) {
+        return false;
+    }
+    board.appendRegion(x, y, w, h, out);
+    return true;
+}
+
+bool EpisodeArchive::boardAt(uint64_t offsetMs, PixelGrid& board, TimelinePosition& position) const {
+    if (!data_) {
+        return false;
+    }
+    position.durationMs = info_.durationMs;
+    position.offsetMs = std::min<uint64_t>(offsetMs, info_.durationMs);
+    
+    // Last keyframe made only of events at or before the requested time
+    board = PixelGrid(info_.width, info_.height);
+    uint64_t next = 0;
+    auto keyframe = std::upper_bound(keyframes_.begin(), keyframes_.end(), position.offsetMs,
+                                     [](uint64_t t, const BlockEntry& k) { return t < k.firstOffsetMs; });
+    if (keyframe != keyframes_.begin()) {
+        --keyframe;
+        if (!decodeKeyframe(*keyframe, board)) {
+            return false;
+        }
+        next = keyframe->firstEvent;
+    }
+    
+    // Then the events after it, up to the requested time
+    auto block = std::upper_bound(events_.begin(), events_.end(), next,
+                                  [](uint64_t e, const BlockEntry& b) { return e < b.firstEvent; });
+    if (block != events_.begin()) {
+        --block;
+    }
+    std::vector<PlacementEvent> events;
+    bool done = false;
+    for (; block != events_.end() && !done && block->firstOffsetMs <= position.offsetMs; ++block) {
+        if (!decodeEvents(*block, events)) {
+            return false;
+        }
+        for (size_t i = next - block->firstEvent; i < events.size(); ++i, ++next) {
+            const PlacementEvent& event = events[i];
+            if (event.offsetMs > position.offsetMs) {
+                done = true;
+                break;
+            }
+            board.set(event.cell % info_.width, event.cell / info_.width, event.color,
+                      static_cast<PixelMood>(event.mood), info_.startTimestamp + event.offsetMs / 1000, event.userId);
+        }
+    }
+    position.events = next;
+    return true;
+}
+
+bool EpisodeArchive::sample(uint64_t intervalMs, std::vector<SnapshotHandle>& frames) const {
+    if (!data_) {
+        return false;
+    }
+    frames.clear();
+    TileGrid board(info_.width, info_.height);
+    uint64_t nextFrame = intervalMs > 0 ? intervalMs : UINT64_MAX;
+    auto capture = [&]() {
+        frames.push_back(CanvasSnapshot::capture(board, frames.empty() ? nullptr : frames.back().get()));
+    };
+    
+    std::vector<PlacementEvent> events;
+    for (const auto& block : events_) {
+        if (!decodeEvents(block, events)) {
+            return false;
+        }
+        for (size_t i = 0; i < events.size(); ++i) {
+            const PlacementEvent& event = events[i];
+            while (event.offsetMs > nextFrame && nextFrame < info_.durationMs) {
+                capture();
+                nextFrame += intervalMs;
+            }
+            board.set(event.cell % info_.width, event.cell / info_.width, event.color,
+                      static_cast<PixelMood>(event.mood), info_.startTimestamp + event.offsetMs / 1000,
+                      event.userId, block.firstEvent + i + 1);
+        }
+    }
+    while (nextFrame < info_.durationMs) {
+        capture();
+        nextFrame += intervalMs;
+    }
+    capture();  // Final board
+    return true;
+}
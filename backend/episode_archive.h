@@ -0,0 +1,113 @@
+#ifndef EPISODE_ARCHIVE_H
+#define EPISODE_ARCHIVE_H
+
+#include "episode_timeline.h"
+#include "quest_board.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Episode archive file (data/episodes/episode_<n>.scar), little-endian:
+//
+//   offset size  field
+//   0      4     magic "SCAR"
+//   4      2     format version (1)
+//   6      2     reserved (0)
+//   8      ...   blocks
+//          ...   footer: metadata, quest results, block index
+//   end-16 8     footer offset
+//   end-8  4     footer size
+//   end-4  4     magic "SCAE"
+//
+// Every block starts with a 12-byte header (u8 type, 3 reserved bytes,
+// u32 item count, u32 payload size) and decodes on its own:
+//   - Event blocks hold up to ARCHIVE_BLOCK_EVENTS placements, each as
+//     varint(offsetMs delta), zigzag varint(cell delta), varint(userId) and
+//     one byte color | mood << 4; the first event's deltas are from zero.
+//   - Keyframe blocks hold the whole board after `firstEvent` placements as
+//     three run-length planes (color | mood << 4, timestamp, userId), each
+//     run being varint(length) followed by the value (a byte or a varint).
+//
+// Footer: u32 episode, u64 start, u64 end, u32 width, u32 height,
+// u64 event count, u32 duration ms; u32 quest count, then per quest u32
+// length + description, i32 progress, i32 target, u8 completed; u32 block
+// count, then per block u8 type, u64 offset, u32 size, u64 firstEvent,
+// u32 count, u32 firstOffsetMs (for keyframes: offset of the last event folded in).
+const uint16_t ARCHIVE_FORMAT_VERSION = 1;
+const size_t ARCHIVE_BLOCK_EVENTS = 4096;
+const size_t ARCHIVE_KEYFRAME_EVENTS = 4 * ARCHIVE_BLOCK_EVENTS;
+
+struct ArchiveInfo {
+    uint32_t episodeNumber;
+    uint64_t startTimestamp;
+    uint64_t endTimestamp;
+    int width;
+    int height;
+    uint64_t eventCount;
+    uint32_t durationMs;
+};
+
+// Read-only view of one archive. The file is memory-mapped, and only the
+// footer is parsed on open; blocks are decoded from the mapping when a
+// query needs them, so browsing a long episode never reads the whole file.
+class EpisodeArchive {
+public:
+    EpisodeArchive();
+    ~EpisodeArchive();
+    EpisodeArchive(const EpisodeArchive&) = delete;
+    EpisodeArchive& operator=(const EpisodeArchive&) = delete;
+    
+    static std::string pathFor(uint32_t episodeNumber);
+    
+    // Write the archive for a finished episode (to a temporary file, then
+    // renamed into place). `log` must hold the episode's placements.
+    static bool write(const std::string& path, const ArchiveInfo& info, const std::vector<Quest>& quests,
+                      const EpisodeTimeline::LogView& log);
+    
+    // False if the file is missing, truncated or not an archive
+    bool open(const std::string& path);
+    void close();
+    
+    const ArchiveInfo& info() const { return info_; }
+    const std::vector<Quest>& quests() const { return quests_; }
+    
+    // Clipped region as it was `offsetMs` into the episode, appended to `out`
+    // in row-major order; false if a block fails to decode
+    bool regionAt(uint64_t offsetMs, int x, int y, int w, int h, std::vector<Pixel>& out,
+                  TimelinePosition& position) const;
+    
+    // Whole board at `offsetMs` (the final board at info().durationMs): the
+    // last keyframe before it plus the events after that
+    bool boardAt(uint64_t offsetMs, PixelGrid& board, TimelinePosition& position) const;
+    
+    // Board every `intervalMs`, ending with the final board (for replays)
+    bool sample(uint64_t intervalMs, std::vector<SnapshotHandle>& frames) const;
+
+private:
+    enum BlockType : uint8_t {
+        EventBlock = 1,
+        KeyframeBlock = 2
+    };
+    
+    struct BlockEntry {
+        uint8_t type;
+        uint64_t offset;
+        uint32_t size;
+        uint64_t firstEvent;
+        uint32_t count;
+        uint32_t firstOffsetMs;
+    };
+    
+    const uint8_t* data_;
+    size_t size_;
+    ArchiveInfo info_;
+    std::vector<Quest> quests_;
+    std::vector<BlockEntry> events_;      // Event blocks in log order
+    std::vector<BlockEntry> keyframes_;   // Keyframe blocks in log order
+    
+    bool parseFooter();
+    bool decodeEvents(const BlockEntry& block, std::vector<PlacementEvent>& out) const;
+    bool decodeKeyframe(const BlockEntry& block, PixelGrid& board) const;
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "episode_timeline.h"
+#include "logger.h"
+#include <algorithm>
+#include <thread>
+
+EpisodeTimeline::EventLog::EventLog()
+    : head(0), published(0), full(false), chunks(new std::atomic<EventChunk*>[MAX_CHUNKS]) {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    chunks[0].store(new EventChunk(), std::memory_order_release);   // Value-initialized: nothing ready
+}
+
+EpisodeTimeline::EventLog::~EventLog() {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+EpisodeTimeline::EpisodeTimeline(int width, int height)
+    : width_(width), height_(height), log_(std::make_shared<EventLog>()), episode_(0), generation_(0),
+      start_(std::chrono::steady_clock::now()), startTime_(0), finished_(false), finishedAtMs_(0),
+      board_(width, height), boardEvents_(0), boardGeneration_(0) {
+    current_.store(log_.get());
+}
+
+void EpisodeTimeline::reset(uint32_t episode, uint64_t startTime) {
+    std::lock_guard lock(mutex_);
+    log_ = std::make_shared<EventLog>();
+    episode_ = episode;
+    ++generation_;
+    keyframes_.clear();
+    start_ = std::chrono::steady_clock::now();
+    startTime_ = startTime;
+    finished_ = false;
+    current_.store(log_.get(), std::memory_order_release);
+}
+
+void EpisodeTimeline::finish() {
+    std::lock_guard lock(mutex_);
+    if (!finished_) {
+        finishedAtMs_ = currentDurationMs();
+        finished_ = true;
+    }
+}
+
+uint32_t EpisodeTimeline::elapsedMs() const {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_);
+    return (uint32_t)std::max<int64_t>(0, elapsed.count());
+}
+
+// Called with mutex_ held
+uint64_t EpisodeTimeline::currentDurationMs() const {
+    uint32_t lastOffsetMs = (uint32_t)log_->head.load(std::memory_order_relaxed);
+    return finished_ ? finishedAtMs_ : std::max(lastOffsetMs, elapsedMs());
+}
+
+void EpisodeTimeline::record(int x, int y, uint8_t color, PixelMood mood, uint32_t userId) {
+    EventLog& log = *current_.load(std::memory_order_acquire);
+    uint32_t now = elapsedMs();
+    
+    // Reserve the slot and stamp its offset in one step, so offsets never go
+    // backwards along the log
+    uint64_t head = log.head.load(std::memory_order_relaxed);
+    uint64_t index;
+    do {
+        index = head >> 32;
+        if (index >= MAX_CHUNKS * CHUNK_EVENTS) {
+            if (!log.full.exchange(true)) {
+                LOG_WARN("[Timeline] episode log is full, later placements are not recorded");
+            }
+            return;
+        }
+    } while (!log.head.compare_exchange_weak(head, (index + 1) << 32 | std::max((uint32_t)head, now),
+                                             std::memory_order_relaxed));
+    uint32_t offsetMs = std::max((uint32_t)head, now);
+    
+    // The first writer into a chunk allocates the next one, so writers
+    // crossing into it normally find it ready
+    size_t chunkIndex = index / CHUNK_EVENTS;
+    if (index % CHUNK_EVENTS == 0 && chunkIndex + 1 < MAX_CHUNKS) {
+        log.chunks[chunkIndex + 1].store(new EventChunk(), std::memory_order_release);
+    }
+    EventChunk* chunk;
+    while (!(chunk = log.chunks[chunkIndex].load(std::memory_order_acquire))) {
+        std::this_thread::yield();
+    }
+    
+    PlacementEvent& event = chunk->events[index % CHUNK_EVENTS];
+    event.offsetMs = offsetMs;
+    event.cell = (uint32_t)y * width_ + x;
+    event.userId = userId;
+    event.color = color;
+    event.mood = static_cast<uint8_t>(mood);
+    chunk->ready[index % CHUNK_EVENTS].store(1, std::memory_order_release);
+}
+
+size_t EpisodeTimeline::publish(EventLog& log) {
+    size_t published = log.published.load(std::memory_order_acquire);
+    size_t reserved = (size_t)(log.head.load(std::memory_order_acquire) >> 32);
+    while (published < reserved) {
+        EventChunk* chunk = log.chunks[published / CHUNK_EVENTS].load(std::memory_order_acquire);
+        if (!chunk || !chunk->ready[published % CHUNK_EVENTS].load(std::memory_order_acquire)) {
+            break;   // Still being written; a later view picks it up
+        }
+        // Another reader may have moved it on; a failed exchange reloads it
+        if (log.published.compare_exchange_weak(published, published + 1, std::memory_order_acq_rel)) {
+            ++published;
+        }
+    }
+    return published;
+}
+
+EpisodeTimeline::LogView EpisodeTimeline::view() {
+    return {log_, publish(*log_)};
+}
+
+void EpisodeTimeline::apply(TileGrid& board, const PlacementEvent& event, uint64_t version,
+                            uint64_t startTime) const {
+    board.set(event.cell % width_, event.cell / width_, event.color, static_cast<PixelMood>(event.mood),
+              startTime + event.offsetMs / 1000, event.userId, version);
+}
+
+void EpisodeTimeline::buildKeyframe() {
+    std::lock_guard buildLock(keyframeMutex_);
+    
+    LogView log;
+    SnapshotHandle previous;
+    uint64_t generation;
+    uint64_t startTime;
+    {
+        std::lock_guard lock(mutex_);
+        log = view();
+        generation = generation_;
+        startTime = startTime_;
+        if (!keyframes_.empty()) {
+            previous = keyframes_.back().frame;
+        }
+    }
+    
+    if (generation != boardGeneration_) {
+        board_ = TileGrid(width_, height_);
+        boardEvents_ = 0;
+        boardGeneration_ = generation;
+    }
+    if (log.count == boardEvents_) {
+        return;
+    }
+    
+    // Event index + 1 doubles as the tile version, so unchanged tiles keep
+    // their version and are shared with the previous keyframe
+    for (size_t i = boardEvents_; i < log.count; ++i) {
+        apply(board_, log[i], i + 1, startTime);
+    }
+    boardEvents_ = log.count;
+    Keyframe keyframe{log.count, log[log.count - 1].offsetMs, CanvasSnapshot::capture(board_, previous.get())};
+    
+    std::lock_guard lock(mutex_);
+    if (generation_ == generation) {
+        keyframes_.push_back(std::move(keyframe));
+    }
+}
+
+TimelinePosition EpisodeTimeline::regionAt(uint64_t offsetMs, int x, int y, int w, int h, std::vector<Pixel>& out) {
+    LogView log;
+    Keyframe keyframe{0, 0, nullptr};
+    TimelinePosition position;
+    uint64_t startTime;
+    {
+        std::lock_guard lock(mutex_);
+        log = view();
+        startTime = startTime_;
+        position.durationMs = currentDurationMs();
+        position.offsetMs = std::min(offsetMs, position.durationMs);
+        
+        // Last keyframe made only of events at or before the requested time
+        auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), position.offsetMs,
+                                   [](uint64_t t, const Keyframe& k) { return t < k.lastOffsetMs; });
+        if (it != keyframes_.begin()) {
+            keyframe = *(it - 1);
+        }
+    }
+    
+    // First event after the requested time (offsets are non-decreasing)
+    size_t lo = keyframe.events;
+    size_t hi = log.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (log[mid].offsetMs <= position.offsetMs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    position.events = lo;
+    
+    int startX = std::max(0, x);
+    int startY = std::max(0, y);
+    int endX = (int)std::min<int64_t>((int64_t)x + w, width_);   // x + w may not fit in an int
+    int endY = (int)std::min<int64_t>((int64_t)y + h, height_);
+    if (startX >= endX || startY >= endY) {
+        return position;
+    }
+    
+    size_t offset = out.size();
+    if (keyframe.frame) {
+        keyframe.frame->appendRegion(x, y, w, h, out);
+    } else {
+        TileGrid(width_, height_).appendRegion(x, y, w, h, out);
+    }
+    
+    int stride = endX - startX;
+    for (size_t i = keyframe.events; i < position.events; ++i) {
+        const PlacementEvent& event = log[i];
+        int cx = (int)(event.cell % width_);
+        int cy = (int)(event.cell / width_);
+        if (cx < startX || cx >= endX || cy < startY || cy >= endY) {
+            continue;
+        }
+        out[offset + (size_t)(cy - startY) * stride + (cx - startX)] =
+            {cx, cy, event.color, static_cast<PixelMood>(event.mood), startTime + event.offsetMs / 1000, event.userId};
+    }
+    return position;
+}
+
+EpisodeTimeline::Capture EpisodeTimeline::capture() {
+    std::lock_guard lock(mutex_);
+    Capture capture{episode_, view(), startTime_, currentDurationMs(), 0, nullptr};
+    // Keyframes are built from earlier views, so the last one is within this one
+    if (!keyframes_.empty()) {
+        capture.keyframeEvents = keyframes_.back().events;
+        capture.keyframe = keyframes_.back().frame;
+    }
+    return capture;
+}
+
+std::vector<SnapshotHandle> EpisodeTimeline::sample(const Capture& capture, uint64_t intervalMs) const {
+    const LogView& log = capture.log;
+    std::vector<SnapshotHandle> frames;
+    TileGrid board(width_, height_);
+    size_t next = 0;
+    auto frameAt = [&](uint64_t t) {
+        for (; next < log.count && log[next].offsetMs <= t; ++next) {
+            apply(board, log[next], next + 1, capture.startTime);
+        }
+        frames.push_back(CanvasSnapshot::capture(board, frames.empty() ? nullptr : frames.back().get()));
+    };
+    
+    if (intervalMs > 0) {
+        for (uint64_t t = intervalMs; t < capture.durationMs; t += intervalMs) {
+            frameAt(t);
+        }
+    }
+    frameAt(UINT64_MAX);  // Everything captured
+    return frames;
+}
+
+PixelGrid EpisodeTimeline::board(const Capture& capture) const {
+    PixelGrid board = capture.keyframe ? capture.keyframe->toGrid() : PixelGrid(width_, height_);
+    for (size_t i = capture.keyframeEvents; i < capture.log.count; ++i) {
+        const PlacementEvent& event = capture.log[i];
+        board.set(event.cell % width_, event.cell / width_, event.color, static_cast<PixelMood>(event.mood),
+                  capture.startTime + event.offsetMs / 1000, event.userId);
+    }
+    return board;
+}
+
+EpisodeTimeline::LogView EpisodeTimeline::log() {
+    std::lock_guard lock(mutex_);
+    return view();
+}
+
+uint64_t EpisodeTimeline::durationMs() {
+    std::lock_guard lock(mutex_);
+    return currentDurationMs();
+}
+
+size_t EpisodeTimeline::eventCount() {
+    std::lock_guard lock(mutex_);
+    return publish(*log_);
+}
+
+size_t EpisodeTimeline::keyframeCount() {
+    std::lock_guard lock(mutex_);
+    return keyframes_.size();
+}
@@ -0,0 +1,162 @@
+#ifndef EPISODE_TIMELINE_H
+#define EPISODE_TIMELINE_H
+
+#include "canvas_snapshot.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+// One accepted placement, 16 bytes. Time is kept relative to the episode
+// start so the log can be replayed to millisecond precision.
+struct PlacementEvent {
+    uint32_t offsetMs;   // Milliseconds since the episode started
+    uint32_t cell;       // y * width + x
+    uint32_t userId;
+    uint8_t color;
+    uint8_t mood;
+};
+
+// Point on the timeline a reconstructed view corresponds to
+struct TimelinePosition {
+    uint64_t offsetMs;     // Requested time, clamped to [0, durationMs]
+    uint64_t durationMs;   // Length of the episode so far
+    size_t events;         // Placements at or before offsetMs
+};
+
+// Append-only placement log for the current episode, plus keyframes.
+//
+// Every placement is appended in the order it was applied to the board.
+// Appending takes no lock: a writer reserves its slot and stamps the time
+// offset with one compare-and-swap, fills the slot and marks it ready.
+// Events live in fixed-size chunks that are never moved or rewritten;
+// readers see the prefix of the log whose slots are all ready and replay it
+// without any lock. buildKeyframe() folds the events logged since the
+// previous keyframe into a private board and captures it as a copy-on-write
+// snapshot; a time-travel query starts from the last keyframe at or before
+// the requested time and applies only the events after it.
+class EpisodeTimeline {
+public:
+    static const size_t CHUNK_EVENTS = 4096;
+    static const size_t MAX_CHUNKS = 1 << 16;   // Placements past ~268M in one episode are not logged
+    
+    struct EventChunk {
+        PlacementEvent events[CHUNK_EVENTS];
+        std::atomic<uint8_t> ready[CHUNK_EVENTS];   // Set once the event is written
+    };
+    
+    // One episode's events. Chunks are allocated ahead of the writers and
+    // published with release stores; the table never moves.
+    struct EventLog {
+        std::atomic<uint64_t> head;        // Reserved events << 32 | offset of the last one
+        std::atomic<size_t> published;     // Slots [0, published) are all ready
+        std::atomic<bool> full;            // Warned that placements are being dropped
+        std::unique_ptr<std::atomic<EventChunk*>[]> chunks;
+        
+        EventLog();
+        ~EventLog();
+        EventLog(const EventLog&) = delete;
+        EventLog& operator=(const EventLog&) = delete;
+    };
+    
+    // Events [0, count) of a log, safe to read without the lock. Holding a
+    // view keeps its episode's events alive across reset().
+    struct LogView {
+        std::shared_ptr<const EventLog> log;
+        size_t count;
+        
+        const PlacementEvent& operator[](size_t i) const {
+            return log->chunks[i / CHUNK_EVENTS].load(std::memory_order_acquire)->events[i % CHUNK_EVENTS];
+        }
+    };
+    
+    // The timeline at one instant. Rendering from it needs no lock and gives
+    // the same boards however much is logged (or reset) afterwards.
+    struct Capture {
+        uint32_t episode;
+        LogView log;
+        uint64_t startTime;
+        uint64_t durationMs;
+        size_t keyframeEvents;     // Log prefix folded into `keyframe`
+        SnapshotHandle keyframe;   // Last keyframe within the capture, if any
+    };
+    
+    EpisodeTimeline(int width, int height);
+    
+    // Start a new, empty timeline for `episode` beginning now; `startTime` is
+    // the episode's wall-clock start (seconds), used for reconstructed timestamps
+    void reset(uint32_t episode, uint64_t startTime);
+    
+    // Stop the clock: the episode ended, later queries see it at its final length
+    void finish();
+    
+    // Log a placement. Callers must hold the cell's writer lock so events on
+    // the same cell are logged in the order they were applied, and must not
+    // call it concurrently with reset() (the canvas only resets when frozen).
+    void record(int x, int y, uint8_t color, PixelMood mood, uint32_t userId);
+    
+    // Fold new events into a keyframe; no-op if nothing was placed since the last one
+    void buildKeyframe();
+    
+    // Clipped region [x, x+w) x [y, y+h) as it was `offsetMs` into the episode,
+    // appended to `out` in row-major order like TileGrid::appendRegion
+    TimelinePosition regionAt(uint64_t offsetMs, int x, int y, int w, int h, std::vector<Pixel>& out);
+    
+    Capture capture();
+    
+    // Board every `intervalMs` from the start, the last frame being the
+    // captured state (for replays)
+    std::vector<SnapshotHandle> sample(const Capture& capture, uint64_t intervalMs) const;
+    
+    // Captured board: its last keyframe plus the events after it
+    PixelGrid board(const Capture& capture) const;
+    
+    // Everything logged so far
+    LogView log();
+    
+    uint64_t durationMs();
+    size_t eventCount();
+    size_t keyframeCount();
+
+private:
+    struct Keyframe {
+        size_t events;           // Log prefix folded into `frame`
+        uint32_t lastOffsetMs;   // Offset of the last of those events
+        SnapshotHandle frame;
+    };
+    
+    int width_;
+    int height_;
+    
+    // Current episode's log. record() only loads `current_`; the owning
+    // pointer is swapped by reset(), so views taken earlier stay valid.
+    std::atomic<EventLog*> current_;
+    
+    // Guards the fields below (start_ is also read by record(), which cannot
+    // overlap the reset() that writes it)
+    std::mutex mutex_;
+    std::shared_ptr<EventLog> log_;
+    uint32_t episode_;
+    uint64_t generation_;   // Bumped by every reset
+    std::vector<Keyframe> keyframes_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t startTime_;
+    bool finished_;
+    uint32_t finishedAtMs_;
+    
+    // Private board keyframes are built from; only buildKeyframe() touches it
+    std::mutex keyframeMutex_;
+    TileGrid board_;
+    size_t boardEvents_;
+    uint64_t boardGeneration_;
+    
+    uint32_t elapsedMs() const;
+    uint64_t currentDurationMs() const;
+    static size_t publish(EventLog& log);   // Extend the ready prefix; returns its length
+    LogView view();   // log() with mutex_ already held
+    void apply(TileGrid& board, const PlacementEvent& event, uint64_t version, uint64_t startTime) const;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "event_hub.h"
+#include <algorithm>
+
+void EventHub::setWakeup(std::function<void()> wakeup) {
+    std::lock_guard lock(mutex_);
+    wakeup_ = std::move(wakeup);
+    if (queued_ && wakeup_) {
+        wakeup_();
+    }
+}
+
+template <typename Fn>
+void EventHub::publish(Fn&& apply) {
+    std::lock_guard lock(mutex_);
+    apply();
+    if (!queued_) {
+        queued_ = true;
+        if (wakeup_) {
+            wakeup_();
+        }
+    }
+}
+
+void EventHub::publishPixel(const Pixel& pixel, uint64_t version) {
+    publish([&] {
+        pending_.version = std::max(pending_.version, version);
+        if (pending_.resync) {
+            return;  // Client refetches everything anyway
+        }
+        if (pixels_.size() < MAX_QUEUED_PIXELS) {
+            pixels_.push_back({pixel, version});
+        } else {
+            // Nobody is keeping up: trade the backlog for one resync
+            pixels_.clear();
+            pending_.resync = true;
+        }
+    });
+}
+
+void EventHub::publishResync() {
+    publish([&] {
+        pixels_.clear();
+        pending_.resync = true;
+    });
+}
+
+void EventHub::publishChat(const ChatMessage& message) {
+    publish([&] {
+        auto& chat = pending_.chat;
+        if (chat.size() >= MAX_QUEUED_CHAT) {
+            chat.erase(chat.begin());
+        }
+        chat.push_back(message);
+    });
+}
+
+void EventHub::publishSeason(const std::string& season) {
+    publish([&] {
+        pending_.hasSeason = true;
+        pending_.season = season;
+    });
+}
+
+void EventHub::publishQuests(const std::vector<Quest>& quests) {
+    publish([&] {
+        pending_.hasQuests = true;
+        pending_.quests = quests;
+    });
+}
+
+void EventHub::publishEpisode(const EpisodeInfo& episode) {
+    publish([&] {
+        pending_.hasEpisode = true;
+        pending_.episode = episode;
+    });
+}
+
+bool EventHub::drain(EventBatch& out) {
+    {
+        std::lock_guard lock(mutex_);
+        if (!queued_) {
+            return false;
+        }
+        out = std::move(pending_);
+        pending_ = EventBatch();
+        draining_.swap(pixels_);   // Hands the publishers last round's (empty) buffer
+        queued_ = false;
+    }
+    
+    // Coalesce off the lock: events on a cell arrive in version order, so
+    // the last one wins
+    out.pixels.clear();
+    pixelSlots_.clear();
+    for (const PixelEvent& event : draining_) {
+        uint64_t key = (uint64_t)event.pixel.y << 32 | (uint32_t)event.pixel.x;
+        auto slot = pixelSlots_.emplace(key, out.pixels.size());
+        if (slot.second) {
+            out.pixels.push_back(event.pixel);
+        } else {
+            out.pixels[slot.first->second] = event.pixel;
+        }
+    }
+    draining_.clear();
+    
+    if (out.resync || out.pixels.size() > MAX_BATCH_PIXELS) {
+        out.pixels.clear();
+        out.resync = true;
+    }
+    return true;
+}
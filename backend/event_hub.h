@@ -0,0 +1,80 @@
+#ifndef EVENT_HUB_H
+#define EVENT_HUB_H
+
+#include "canvas.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+// Everything published since the consumer last drained the hub
+struct EventBatch {
+    std::vector<Pixel> pixels;          // Latest value per cell
+    uint64_t version = 0;               // Canvas version of the newest pixel
+    std::vector<ChatMessage> chat;
+    bool resync = false;                // Pixels were dropped; client must refetch the board
+    bool hasSeason = false;
+    std::string season;
+    bool hasQuests = false;
+    std::vector<Quest> quests;
+    bool hasEpisode = false;
+    EpisodeInfo episode{};
+    
+    bool empty() const {
+        return pixels.empty() && chat.empty() && !resync && !hasSeason && !hasQuests && !hasEpisode;
+    }
+};
+
+// Collects canvas, chat, season, quest and episode updates for the event
+// streams. Publishing only appends to a queue under one short lock (pixels
+// are published under a canvas stripe lock); the single consumer drains it
+// on its own thread, coalescing as it goes: a cell keeps only its latest
+// pixel and season/quests/episode keep only their latest state. If too many
+// pixels pile up they are dropped in favour of a single resync marker, so
+// the queue stays bounded even with no consumer.
+class EventHub {
+public:
+    static const size_t MAX_QUEUED_PIXELS = 65536;
+    static const size_t MAX_BATCH_PIXELS = 4096;    // More cells than this go out as a resync
+    static const size_t MAX_QUEUED_CHAT = 100;
+    
+    // `wakeup` runs, with the hub locked, whenever the queue goes from empty
+    // to non-empty; it must be cheap and must not publish
+    void setWakeup(std::function<void()> wakeup);
+    
+    // Placements on one cell must be published in version order (Canvas
+    // publishes under the cell's stripe lock): a coalesced cell keeps the last one
+    void publishPixel(const Pixel& pixel, uint64_t version);
+    void publishResync();
+    void publishChat(const ChatMessage& message);
+    void publishSeason(const std::string& season);
+    void publishQuests(const std::vector<Quest>& quests);
+    void publishEpisode(const EpisodeInfo& episode);
+    
+    // Move everything queued so far into `out`; false if nothing was. Only
+    // one thread may drain.
+    bool drain(EventBatch& out);
+
+private:
+    struct PixelEvent {
+        Pixel pixel;
+        uint64_t version;
+    };
+    
+    std::mutex mutex_;
+    std::vector<PixelEvent> pixels_;   // In publish order
+    EventBatch pending_;               // Everything but the pixels
+    bool queued_ = false;
+    std::function<void()> wakeup_;
+    
+    // Drain scratch, reused between batches
+    std::vector<PixelEvent> draining_;
+    std::unordered_map<uint64_t, size_t> pixelSlots_;   // (y << 32 | x) -> index in the batch
+    
+    template <typename Fn>
+    void publish(Fn&& apply);
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include "event_stream.h"
+#include "logger.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int MAX_EPOLL_EVENTS = 256;
+
+// Worker thread's connection, for StreamingServer
+thread_local int t_socket = -1;
+thread_local bool t_handedOver = false;
+
+}  // namespace
+
+EventStreams::EventStreams(EventHub* events, Formatter format)
+    : events_(events), format_(std::move(format)), epoll_(-1), wake_(-1), running_(false), count_(0) {
+}
+
+EventStreams::~EventStreams() {
+    stop();
+}
+
+bool EventStreams::start() {
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ < 0 || wake_ < 0) {
+        LOG_ERROR("[Events] cannot create the event stream dispatcher: ", strerror(errno));
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wake_;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+    
+    running_ = true;
+    thread_ = std::thread(&EventStreams::run, this);
+    events_->setWakeup([this] { wake(); });
+    return true;
+}
+
+void EventStreams::stop() {
+    if (thread_.joinable()) {
+        events_->setWakeup(nullptr);
+        {
+            std::lock_guard lock(adoptMutex_);
+            running_ = false;
+        }
+        wake();
+        thread_.join();
+    }
+    if (epoll_ >= 0) {
+        ::close(epoll_);
+        epoll_ = -1;
+    }
+    if (wake_ >= 0) {
+        ::close(wake_);
+        wake_ = -1;
+    }
+}
+
+void EventStreams::wake() {
+    uint64_t one = 1;
+    ssize_t written = ::write(wake_, &one, sizeof(one));
+    (void)written;   // EAGAIN: the counter is saturated, a wakeup is pending anyway
+}
+
+bool EventStreams::adopt(int fd, size_t maxStreams) {
+    // Reserve a slot first, so concurrent adopts cannot overshoot
+    size_t open = count_.load(std::memory_order_relaxed);
+    do {
+        if (open >= maxStreams) {
+            return false;
+        }
+    } while (!count_.compare_exchange_weak(open, open + 1, std::memory_order_relaxed));
+    
+    {
+        std::lock_guard lock(adoptMutex_);
+        if (running_) {
+            adopted_.push_back(fd);
+            wake();
+            return true;
+        }
+    }
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+EventStreams::Chunk EventStreams::frame(const std::string& payload) const {
+    char size[20];
+    int length = snprintf(size, sizeof(size), "%zx\r\n", payload.size());
+    auto chunk = std::make_shared<std::string>();
+    chunk->reserve(length + payload.size() + 2);
+    chunk->append(size, length).append(payload).append("\r\n");
+    return chunk;
+}
+
+void EventStreams::registerAdopted() {
+    std::vector<int> fds;
+    {
+        std::lock_guard lock(adoptMutex_);
+        fds.swap(adopted_);
+    }
+    if (fds.empty()) {
+        return;
+    }
+    
+    Chunk hello = frame("retry: 3000\n\n");
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            LOG_WARN("[Events] cannot watch stream socket: ", strerror(errno));
+            ::close(fd);
+            count_.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (!send(fd, streams_[fd], hello)) {
+            close(fd);
+        }
+    }
+}
+
+void EventStreams::run() {
+    epoll_event ready[MAX_EPOLL_EVENTS];
+    auto nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT;
+    
+    while (running_) {
+        auto untilHeartbeat = std::chrono::duration_cast<std::chrono::milliseconds>(
+            nextHeartbeat - std::chrono::steady_clock::now());
+        int n = epoll_wait(epoll_, ready, MAX_EPOLL_EVENTS, (int)std::max<int64_t>(0, untilHeartbeat.count()));
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("[Events] epoll_wait failed: ", strerror(errno));
+            break;
+        }
+        
+        for (int i = 0; i < n; ++i) {
+            int fd = ready[i].data.fd;
+            if (fd == wake_) {
+                uint64_t count;
+                ssize_t got = ::read(wake_, &count, sizeof(count));
+                (void)got;
+                continue;
+            }
+            auto it = streams_.find(fd);
+            if (it == streams_.end()) {
+                continue;
+            }
+            bool open = !(ready[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP));
+            if (open && (ready[i].events & EPOLLIN)) {
+                // Clients send nothing after the request; drain whatever
+                // arrives and watch for the close
+                char discard[512];
+                ssize_t got = ::recv(fd, discard, sizeof(discard), 0);
+                open = got > 0 || (got < 0 && (errno == EAGAIN || errno == EINTR));
+            }
+            if (open && (ready[i].events & EPOLLOUT)) {
+                open = flush(fd, it->second);
+            }
+            if (!open) {
+                close(fd);
+            }
+        }
+        
+        registerAdopted();
+        
+        EventBatch batch;
+        if (events_->drain(batch)) {
+            if (batch.version > 0) {
+                state_.version = std::max(state_.version, batch.version);
+            }
+            if (batch.hasSeason) {
+                state_.hasSeason = true;
+                state_.season = batch.season;
+            }
+            if (batch.hasQuests) {
+                state_.hasQuests = true;
+                state_.quests = batch.quests;
+            }
+            if (batch.hasEpisode) {
+                state_.hasEpisode = true;
+                state_.episode = batch.episode;
+            }
+            if (!streams_.empty()) {
+                broadcast(frame(format_(batch)));
+            }
+        }
+        
+        if (std::chrono::steady_clock::now() >= nextHeartbeat) {
+            // Keeps proxies from timing out idle streams and finds dead peers
+            Chunk ping = frame(": ping\n\n");
+            std::vector<int> failed;
+            for (auto& [fd, stream] : streams_) {
+                if (stream.queue.empty() && !send(fd, stream, ping)) {
+                    failed.push_back(fd);
+                }
+            }
+            for (int fd : failed) {
+                close(fd);
+            }
+            nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT;
+        }
+    }
+    
+    // Shutting down. adopt() refuses new sockets by now; close the ones not
+    // yet registered and end the others cleanly if their socket has room.
+    std::vector<int> unregistered;
+    {
+        std::lock_guard lock(adoptMutex_);
+        unregistered.swap(adopted_);
+    }
+    for (int fd : unregistered) {
+        ::close(fd);
+        count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    static const char done[] = "0\r\n\r\n";
+    std::vector<int> fds;
+    for (auto& [fd, stream] : streams_) {
+        if (stream.queue.empty()) {
+            ssize_t written = ::send(fd, done, sizeof(done) - 1, MSG_NOSIGNAL);
+            (void)written;
+        }
+        fds.push_back(fd);
+    }
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+void EventStreams::broadcast(const Chunk& chunk) {
+    std::vector<int> failed;
+    for (auto& [fd, stream] : streams_) {
+        if (!send(fd, stream, chunk)) {
+            failed.push_back(fd);
+        }
+    }
+    for (int fd : failed) {
+        close(fd);
+    }
+}
+
+// Queue `chunk` and write as much as the socket takes; false if the
+// connection failed and must be closed
+bool EventStreams::send(int fd, Stream& stream, const Chunk& chunk) {
+    if (stream.bytes + chunk->size() > MAX_BUFFERED_BYTES) {
+        // Too far behind: drop everything not yet started on for one resync
+        // that carries the latest state
+        while (stream.queue.size() > (stream.offset > 0 ? 1 : 0)) {
+            stream.bytes -= stream.queue.back()->size();
+            stream.queue.pop_back();
+        }
+        EventBatch resync = state_;
+        resync.resync = true;
+        Chunk catchUp = frame(format_(resync));
+        stream.queue.push_back(catchUp);
+        stream.bytes += catchUp->size();
+    } else {
+        stream.queue.push_back(chunk);
+        stream.bytes += chunk->size();
+    }
+    return stream.waitingWritable || flush(fd, stream);
+}
+
+bool EventStreams::flush(int fd, Stream& stream) {
+    while (!stream.queue.empty()) {
+        const std::string& head = *stream.queue.front();
+        ssize_t written = ::send(fd, head.data() + stream.offset, head.size() - stream.offset, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            if (!stream.waitingWritable) {
+                // Socket buffer is full: resume when it drains
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT;
+                event.data.fd = fd;
+                epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &event);
+                stream.waitingWritable = true;
+            }
+            return true;
+        }
+        stream.offset += (size_t)written;
+        stream.bytes -= (size_t)written;
+        if (stream.offset == head.size()) {
+            stream.queue.pop_front();
+            stream.offset = 0;
+        }
+    }
+    if (stream.waitingWritable) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &event);
+        stream.waitingWritable = false;
+    }
+    return true;
+}
+
+void EventStreams::close(int fd) {
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    streams_.erase(fd);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    LOG_DEBUG("[Events] stream closed, ", count_.load(std::memory_order_relaxed), " open");
+}
+
+int StreamingServer::currentSocket() {
+    return t_socket;
+}
+
+void StreamingServer::handOver() {
+    t_handedOver = true;
+}
+
+// httplib's own, except that a handed-over socket is left open
+bool StreamingServer::process_and_close_socket(socket_t sock) {
+    std::string remoteAddr;
+    int remotePort = 0;
+    httplib::detail::get_remote_ip_and_port(sock, remoteAddr, remotePort);
+    
+    std::string localAddr;
+    int localPort = 0;
+    httplib::detail::get_local_ip_and_port(sock, localAddr, localPort);
+    
+    t_socket = sock;
+    t_handedOver = false;
+    bool ret = httplib::detail::process_server_socket(
+        svr_sock_, sock, keep_alive_max_count_, keep_alive_timeout_sec_, read_timeout_sec_, read_timeout_usec_,
+        write_timeout_sec_, write_timeout_usec_,
+        [&](httplib::Stream& strm, bool closeConnection, bool& connectionClosed) {
+            return process_request(strm, remoteAddr, remotePort, localAddr, localPort, closeConnection,
+                                   connectionClosed, nullptr);
+        });
+    t_socket = -1;
+    
+    if (!t_handedOver) {
+        httplib::detail::shutdown_socket(sock);
+        httplib::detail::close_socket(sock);
+    }
+    return ret;
+}
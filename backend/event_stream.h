@@ -0,0 +1,96 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include "event_hub.h"
+#include "httplib.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Every open /api/events connection, served by one dispatcher thread. The
+// HTTP worker writes the response headers and hands the socket over; from
+// then on the dispatcher waits on all the sockets with epoll, drains the
+// EventHub, formats each batch once and queues the same chunk on every
+// stream. An idle stream costs a socket and a few bytes, not a thread. A
+// stream whose unsent data passes MAX_BUFFERED_BYTES loses it for a single
+// resync (plus the latest season, quests and episode).
+class EventStreams {
+public:
+    using Formatter = std::function<std::string(const EventBatch&)>;
+    
+    static const size_t MAX_BUFFERED_BYTES = 1024 * 1024;   // Per stream
+    static constexpr std::chrono::milliseconds HEARTBEAT{15000};
+    
+    EventStreams(EventHub* events, Formatter format);
+    ~EventStreams();
+    
+    EventStreams(const EventStreams&) = delete;
+    EventStreams& operator=(const EventStreams&) = delete;
+    
+    bool start();
+    // End every stream (final chunk, best effort) and join the dispatcher
+    void stop();
+    
+    // Take over `fd`, whose chunked text/event-stream headers are written.
+    // False once `maxStreams` are open or after stop(); the caller keeps the
+    // socket then.
+    bool adopt(int fd, size_t maxStreams);
+    size_t count() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    using Chunk = std::shared_ptr<const std::string>;
+    
+    struct Stream {
+        std::deque<Chunk> queue;   // Framed chunks not yet fully written
+        size_t offset = 0;         // Bytes of queue.front() already written
+        size_t bytes = 0;          // Unwritten bytes in queue
+        bool waitingWritable = false;
+    };
+    
+    EventHub* events_;
+    Formatter format_;
+    int epoll_;
+    int wake_;   // eventfd: new events or adopted sockets
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> count_;
+    
+    std::mutex adoptMutex_;
+    std::vector<int> adopted_;   // Handed over, not yet registered
+    
+    // Dispatcher thread only
+    std::unordered_map<int, Stream> streams_;
+    EventBatch state_;   // Latest season/quests/episode and pixel version, for resyncs
+    
+    void wake();
+    void run();
+    void registerAdopted();
+    void broadcast(const Chunk& chunk);
+    bool send(int fd, Stream& stream, const Chunk& chunk);
+    bool flush(int fd, Stream& stream);
+    void close(int fd);
+    Chunk frame(const std::string& payload) const;
+};
+
+// httplib::Server that can leave a connection open after its response:
+// a handler running on the connection's worker thread may release the
+// socket (see handOver()) to whoever now owns it.
+class StreamingServer : public httplib::Server {
+public:
+    // Socket of the connection the calling worker thread is serving
+    static int currentSocket();
+    // Do not shut down or close the current socket once the response ends
+    static void handOver();
+
+protected:
+    bool process_and_close_socket(socket_t sock) override;
+};
+
+#endif
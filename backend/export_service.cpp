@@ -0,0 +1,235 @@
+#include "export_service.h"
+#include "snapshot.h"
+#include "video_export.h"
+#include "gif_export.h"
+#include "logger.h"
+
+const char* exportKindName(ExportKind kind) {
+    switch (kind) {
+        case ExportKind::Png: return "png";
+        case ExportKind::Video: return "video";
+        case ExportKind::Gif: return "gif";
+    }
+    return "unknown";
+}
+
+const char* exportStateName(ExportState state) {
+    switch (state) {
+        case ExportState::Queued: return "queued";
+        case ExportState::Running: return "running";
+        case ExportState::Done: return "done";
+        case ExportState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+bool parseExportKind(const std::string& name, ExportKind& out) {
+    if (name == "png") {
+        out = ExportKind::Png;
+    } else if (name == "video") {
+        out = ExportKind::Video;
+    } else if (name == "gif") {
+        out = ExportKind::Gif;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+size_t ExportKeyHash::operator()(const ExportKey& key) const {
+    uint64_t h = key.placements * 0x9E3779B97F4A7C15ULL;
+    h ^= ((uint64_t)key.episode << 8 | (uint64_t)key.kind) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    h ^= key.frames + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    return (size_t)h;
+}
+
+ExportService::ExportService(Canvas* canvas)
+    : canvas_(canvas), renderPool_(WorkStealingPool::defaultThreads()), workers_(EXPORT_WORKERS), nextId_(1), queued_(0), cachedBytes_(0) {
+}
+
+ExportService::~ExportService() {
+    stop();
+}
+
+void ExportService::stop() {
+    workers_.stop();
+}
+
+ExportKey ExportService::keyFor(ExportKind kind, uint32_t episode, const EpisodeTimeline::Capture& capture) {
+    if (episode != capture.episode) {
+        return {kind, episode, 0, 0};
+    }
+    uint64_t frames = kind == ExportKind::Png ? 1 : Canvas::getSnapshotCount(capture);
+    return {kind, episode, capture.log.count, frames};
+}
+
+bool ExportService::submit(ExportKind kind, uint32_t episode, uint64_t& id) {
+    // Cheap: a view of the log, not a copy. The job renders from it later.
+    EpisodeTimeline::Capture capture = canvas_->captureEpisode();
+    ExportKey key = keyFor(kind, episode, capture);
+    
+    std::shared_ptr<Job> job;
+    {
+        std::lock_guard lock(mutex_);
+        auto existing = byKey_.find(key);
+        if (existing != byKey_.end()) {
+            id = existing->second;
+            return true;
+        }
+        if (queued_ >= MAX_QUEUED_EXPORTS) {
+            return false;
+        }
+        
+        job = std::make_shared<Job>();
+        job->id = nextId_++;
+        job->key = key;
+        if (episode == capture.episode) {
+            job->capture = std::move(capture);
+        }
+        job->state = ExportState::Queued;
+        job->missing = false;
+        job->finishedPos = finished_.end();
+        jobs_[job->id] = job;
+        byKey_[key] = job->id;
+        ++queued_;
+        id = job->id;
+    }
+    
+    LOG_DEBUG("[Export] job ", id, ": ", exportKindName(kind), " of episode ", episode, " at ", key.placements, " placements");
+    if (!workers_.submit([this, job] { run(job); })) {
+        std::lock_guard lock(mutex_);
+        jobs_.erase(job->id);
+        byKey_.erase(key);
+        --queued_;
+        return false;
+    }
+    return true;
+}
+
+void ExportService::run(const std::shared_ptr<Job>& job) {
+    {
+        std::lock_guard lock(mutex_);
+        job->state = ExportState::Running;
+        --queued_;
+    }
+    
+    std::string artifact;
+    std::string error;
+    bool missing = false;
+    bool success = render(*job, artifact, error, missing);
+    job->capture = {};   // Let go of the log; the artifact is all that is kept
+    
+    {
+        std::lock_guard lock(mutex_);
+        if (success) {
+            cachedBytes_ += artifact.size();
+            job->artifact = std::make_shared<const std::string>(std::move(artifact));
+            job->state = ExportState::Done;
+        } else {
+            // Forget the key, so asking again retries instead of joining the failure
+            byKey_.erase(job->key);
+            job->error = error;
+            job->missing = missing;
+            job->state = ExportState::Failed;
+        }
+        finished_.push_front(job->id);
+        job->finishedPos = finished_.begin();
+        evict();
+    }
+    finishedCv_.notify_all();
+}
+
+bool ExportService::render(const Job& job, std::string& artifact, std::string& error, bool& missing) {
+    const ExportKey& key = job.key;
+    bool current = job.capture.log.log != nullptr;   // Captured on submit: the running episode
+    
+    if (key.kind == ExportKind::Png) {
+        PixelGrid frame(canvas_->getWidth(), canvas_->getHeight());
+        if (current) {
+            frame = canvas_->getFrame(job.capture);
+        } else if (!canvas_->getArchivedFrame(key.episode, frame)) {
+            error = "Episode archive not found";
+            missing = true;
+            return false;
+        }
+        if (!Snapshot::encodePNG(frame, artifact)) {
+            error = "Failed to generate PNG";
+            return false;
+        }
+        return true;
+    }
+    
+    std::vector<SnapshotHandle> frames;
+    if (current) {
+        frames = canvas_->getSnapshots(job.capture);
+    } else if (!canvas_->getArchivedSnapshots(key.episode, frames)) {
+        error = "Episode archive not found";
+        missing = true;
+        return false;
+    }
+    if (key.kind == ExportKind::Gif) {
+        if (!GifExport::encode(frames, artifact, renderPool_)) {
+            error = "Failed to generate GIF";
+            return false;
+        }
+        return true;
+    }
+    if (!VideoExport::generateVideo(frames, artifact, renderPool_)) {
+        error = "Failed to generate video. Ensure FFmpeg is installed.";
+        return false;
+    }
+    return true;
+}
+
+// Called with mutex_ held
+void ExportService::evict() {
+    while (!finished_.empty() && (finished_.size() > MAX_EXPORT_JOBS || cachedBytes_ > EXPORT_CACHE_BYTES)) {
+        uint64_t id = finished_.back();
+        finished_.pop_back();
+        auto it = jobs_.find(id);
+        const Job& job = *it->second;
+        if (job.artifact) {
+            cachedBytes_ -= job.artifact->size();
+            byKey_.erase(job.key);
+        }
+        LOG_DEBUG("[Export] job ", id, " evicted");
+        jobs_.erase(it);
+    }
+}
+
+void ExportService::copyStatus(const Job& job, ExportStatus& out) {
+    out.id = job.id;
+    out.key = job.key;
+    out.state = job.state;
+    out.error = job.error;
+    out.missing = job.missing;
+    out.artifact = job.artifact;
+}
+
+bool ExportService::status(uint64_t id, ExportStatus& out) {
+    std::lock_guard lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    Job& job = *it->second;
+    if (job.finishedPos != finished_.end()) {
+        finished_.splice(finished_.begin(), finished_, job.finishedPos);   // Recently used
+    }
+    copyStatus(job, out);
+    return true;
+}
+
+bool ExportService::wait(uint64_t id, ExportStatus& out) {
+    std::unique_lock lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    std::shared_ptr<Job> job = it->second;
+    finishedCv_.wait(lock, [&job] {
+        return job->state == ExportState::Done || job->state == ExportState::Failed;
+    });
+    copyStatus(*job, out);
+    return true;
+}
@@ -0,0 +1,122 @@
+#ifndef EXPORT_SERVICE_H
+#define EXPORT_SERVICE_H
+
+#include "canvas.h"
+#include "job_queue.h"
+#include "work_stealing_pool.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <unordered_map>
+
+enum class ExportKind : uint8_t {
+    Png,
+    Video,
+    Gif      // Animated replay, encoded in-process
+};
+
+enum class ExportState : uint8_t {
+    Queued,
+    Running,
+    Done,
+    Failed
+};
+
+const char* exportKindName(ExportKind kind);
+const char* exportStateName(ExportState state);
+bool parseExportKind(const std::string& name, ExportKind& out);
+
+// Content an export is built from. Two requests with the same key produce
+// the same file, so they share one job and one cached artifact.
+struct ExportKey {
+    ExportKind kind;
+    uint32_t episode;
+    uint64_t placements;   // Logged placements rendered (0 for archived episodes, which never change)
+    uint64_t frames;       // Replay frames (replays of the running episode grow over time)
+    
+    bool operator==(const ExportKey& other) const {
+        return kind == other.kind && episode == other.episode && placements == other.placements &&
+               frames == other.frames;
+    }
+};
+
+struct ExportKeyHash {
+    size_t operator()(const ExportKey& key) const;
+};
+
+// Status of one export job, copied out for the HTTP layer
+struct ExportStatus {
+    uint64_t id;
+    ExportKey key;
+    ExportState state;
+    std::string error;
+    bool missing;                                  // Failed because the episode has no archive
+    std::shared_ptr<const std::string> artifact;   // Set once Done
+};
+
+// Background PNG/video/GIF exports. Jobs run on a small worker pool instead of
+// HTTP threads; a request for content that is already queued, running or
+// cached joins the existing job. An export of the running episode renders
+// the placement log as captured on submit, so it is exactly its key's content. Finished artifacts stay in memory (up to
+// EXPORT_CACHE_BYTES, least recently used evicted first), so downloading
+// one again is a lookup and no re-encode.
+class ExportService {
+public:
+    static const int EXPORT_WORKERS = 2;
+    static const size_t MAX_QUEUED_EXPORTS = 16;
+    static const size_t MAX_EXPORT_JOBS = 256;                     // Finished jobs remembered
+    static const size_t EXPORT_CACHE_BYTES = 256 * 1024 * 1024;
+    
+    explicit ExportService(Canvas* canvas);
+    ~ExportService();
+    
+    ExportService(const ExportService&) = delete;
+    ExportService& operator=(const ExportService&) = delete;
+    
+    // Queue (or join) the export of `episode`; false when the queue is full
+    bool submit(ExportKind kind, uint32_t episode, uint64_t& id);
+    
+    // False for unknown (or long evicted) job ids
+    bool status(uint64_t id, ExportStatus& out);
+    
+    // Block until job `id` has finished, then report it like status()
+    bool wait(uint64_t id, ExportStatus& out);
+    
+    // Finish the jobs already queued and join the workers
+    void stop();
+
+private:
+    struct Job {
+        uint64_t id;
+        ExportKey key;
+        EpisodeTimeline::Capture capture;   // Running episode's log at submit (unused for archives)
+        ExportState state;
+        std::string error;
+        bool missing;
+        std::shared_ptr<const std::string> artifact;
+        std::list<uint64_t>::iterator finishedPos;   // Into finished_, once finished
+    };
+    
+    Canvas* canvas_;
+    WorkStealingPool renderPool_;   // Shared by the export jobs for per-frame work
+    JobQueue workers_;
+    std::mutex mutex_;
+    std::condition_variable finishedCv_;
+    uint64_t nextId_;
+    size_t queued_;
+    size_t cachedBytes_;
+    std::unordered_map<uint64_t, std::shared_ptr<Job>> jobs_;
+    std::unordered_map<ExportKey, uint64_t, ExportKeyHash> byKey_;   // Live and cached jobs
+    std::list<uint64_t> finished_;                                   // Most recently used first
+    
+    static ExportKey keyFor(ExportKind kind, uint32_t episode, const EpisodeTimeline::Capture& capture);
+    void run(const std::shared_ptr<Job>& job);
+    bool render(const Job& job, std::string& artifact, std::string& error, bool& missing);
+    void evict();
+    static void copyStatus(const Job& job, ExportStatus& out);
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include "gif_export.h"
+#include "snapshot.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// GIF-flavoured LZW: variable code width from 5 to 12 bits, codes packed
+// LSB first into sub-blocks of up to 255 bytes. Strings are a trie over the
+// 16 palette indices, stored as a dense child table.
+class LzwEncoder {
+public:
+    static const int MIN_CODE_SIZE = 4;
+    static const int CLEAR_CODE = 1 << MIN_CODE_SIZE;
+    static const int END_CODE = CLEAR_CODE + 1;
+    static const int MAX_CODE = 4095;
+    
+    LzwEncoder() : children_((size_t)(MAX_CODE + 1) * CLEAR_CODE) {}
+    
+    void begin(std::string& out) {
+        out_ = &out;
+        out_->push_back((char)MIN_CODE_SIZE);
+        blockSize_ = 0;
+        bitBuffer_ = 0;
+        bitCount_ = 0;
+        current_ = -1;
+        resetTable();
+        writeCode(CLEAR_CODE);
+    }
+    
+    void add(uint8_t index) {
+        if (current_ < 0) {
+            current_ = index;
+            return;
+        }
+        uint16_t& child = children_[(size_t)current_ * CLEAR_CODE + index];
+        if (child != 0) {
+            current_ = child;
+            return;
+        }
+        
+        writeCode(current_);
+        child = (uint16_t)++maxCode_;
+        if (maxCode_ >= (1 << codeSize_)) {
+            ++codeSize_;
+        }
+        if (maxCode_ == MAX_CODE) {
+            writeCode(CLEAR_CODE);
+            resetTable();
+        }
+        current_ = index;
+    }
+    
+    void finish() {
+        if (current_ >= 0) {
+            writeCode(current_);
+            // The decoder adds its entry for that code (one behind ours) and
+            // may widen before reading the end code
+            if (maxCode_ + 1 == (1 << codeSize_) && codeSize_ < 12) {
+                ++codeSize_;
+            }
+        }
+        writeCode(END_CODE);
+        if (bitCount_ > 0) {
+            pushByte((uint8_t)bitBuffer_);
+        }
+        flushBlock();
+        out_->push_back(0);   // Block terminator
+    }
+
+private:
+    std::vector<uint16_t> children_;   // Code * 16 + index -> code (0 = none)
+    std::string* out_;
+    uint8_t block_[255];
+    int blockSize_;
+    uint32_t bitBuffer_;
+    int bitCount_;
+    int current_;
+    int maxCode_;
+    int codeSize_;
+    
+    void resetTable() {
+        std::fill(children_.begin(), children_.end(), 0);
+        maxCode_ = END_CODE;
+        codeSize_ = MIN_CODE_SIZE + 1;
+    }
+    
+    void writeCode(int code) {
+        bitBuffer_ |= (uint32_t)code << bitCount_;
+        bitCount_ += codeSize_;
+        while (bitCount_ >= 8) {
+            pushByte((uint8_t)bitBuffer_);
+            bitBuffer_ >>= 8;
+            bitCount_ -= 8;
+        }
+    }
+    
+    void pushByte(uint8_t byte) {
+        block_[blockSize_++] = byte;
+        if (blockSize_ == 255) {
+            flushBlock();
+        }
+    }
+    
+    void flushBlock() {
+        if (blockSize_ > 0) {
+            out_->push_back((char)blockSize_);
+            out_->append(reinterpret_cast<const char*>(block_), blockSize_);
+            blockSize_ = 0;
+        }
+    }
+};
+
+void appendU16(std::string& out, int value) {
+    out.push_back((char)(value & 0xFF));
+    out.push_back((char)((value >> 8) & 0xFF));
+}
+
+inline uint8_t cellColor(const TileImage* image, int offset) {
+    uint8_t color = image ? image->color[offset] : DEFAULT_COLOR;
+    return color < 16 ? color : 15;
+}
+
+}  // namespace
+
+GifExport::Rect GifExport::changedRect(const CanvasSnapshot* previous, const CanvasSnapshot& current) {
+    int width = current.width();
+    int height = current.height();
+    if (!previous) {
+        return {0, 0, width, height};
+    }
+    
+    Rect rect{width, height, 0, 0};
+    for (int ty = 0; ty < current.tilesY(); ++ty) {
+        for (int tx = 0; tx < current.tilesX(); ++tx) {
+            const TileImage* before = previous->tile(tx, ty);
+            const TileImage* after = current.tile(tx, ty);
+            if (before == after) {
+                continue;   // Shared image: tile untouched between the frames
+            }
+            
+            int endX = std::min(width, (tx + 1) * TILE_SIZE);
+            int endY = std::min(height, (ty + 1) * TILE_SIZE);
+            for (int y = ty * TILE_SIZE; y < endY; ++y) {
+                int rowOffset = (y % TILE_SIZE) * TILE_SIZE;
+                for (int x = tx * TILE_SIZE; x < endX; ++x) {
+                    int offset = rowOffset + x % TILE_SIZE;
+                    if (cellColor(before, offset) != cellColor(after, offset)) {
+                        rect.x0 = std::min(rect.x0, x);
+                        rect.y0 = std::min(rect.y0, y);
+                        rect.x1 = std::max(rect.x1, x + 1);
+                        rect.y1 = std::max(rect.y1, y + 1);
+                    }
+                }
+            }
+        }
+    }
+    return rect;
+}
+
+void GifExport::encodeFrame(const CanvasSnapshot& frame, const Rect& rect, int scale, EncodedFrame& out) {
+    // One table per thread; it is cleared on every begin()
+    thread_local LzwEncoder lzw;
+    
+    out.rect = rect;
+    out.data.clear();
+    lzw.begin(out.data);
+    
+    std::vector<uint8_t> row((size_t)(rect.x1 - rect.x0) * scale);
+    for (int y = rect.y0; y < rect.y1; ++y) {
+        int rowOffset = (y % TILE_SIZE) * TILE_SIZE;
+        uint8_t* pixel = row.data();
+        for (int x = rect.x0; x < rect.x1; ++x) {
+            uint8_t color = cellColor(frame.tile(x / TILE_SIZE, y / TILE_SIZE), rowOffset + x % TILE_SIZE);
+            std::memset(pixel, color, scale);
+            pixel += scale;
+        }
+        for (int s = 0; s < scale; ++s) {
+            for (uint8_t index : row) {
+                lzw.add(index);
+            }
+        }
+    }
+    lzw.finish();
+}
+
+void GifExport::writeFrame(std::string& out, const EncodedFrame& frame, int delay, int scale) {
+    // Graphic control: keep the previous image under this one
+    out.append("\x21\xF9\x04\x04", 4);
+    appendU16(out, std::min(delay, 0xFFFF));
+    out.push_back(0);   // Transparent index (unused)
+    out.push_back(0);
+    
+    out.push_back(0x2C);
+    appendU16(out, frame.rect.x0 * scale);
+    appendU16(out, frame.rect.y0 * scale);
+    appendU16(out, (frame.rect.x1 - frame.rect.x0) * scale);
+    appendU16(out, (frame.rect.y1 - frame.rect.y0) * scale);
+    out.push_back(0);   // No local color table, not interlaced
+    out += frame.data;
+}
+
+bool GifExport::encode(const std::vector<SnapshotHandle>& snapshots, std::string& out, WorkStealingPool& pool) {
+    if (snapshots.empty()) {
+        LOG_WARN("No snapshots to export");
+        return false;
+    }
+    
+    int width = snapshots.front()->width();
+    int height = snapshots.front()->height();
+    int scale = VideoExport::scaleFor(width, height);
+    if (width * scale > 0xFFFF || height * scale > 0xFFFF) {
+        LOG_WARN("Board too large for a GIF: ", width, "x", height);
+        return false;
+    }
+    
+    // Header, logical screen with the 16-color global table, loop forever
+    out.clear();
+    out.append("GIF89a", 6);
+    appendU16(out, width * scale);
+    appendU16(out, height * scale);
+    out.push_back((char)0xB3);   // Global table, 4 bits per channel of resolution, 2^(3+1) entries
+    out.push_back(0);            // Background color
+    out.push_back(0);            // Pixel aspect ratio
+    for (int c = 0; c < 16; ++c) {
+        uint8_t r, g, b;
+        Snapshot::getRGB((uint8_t)c, r, g, b);
+        out.push_back((char)r);
+        out.push_back((char)g);
+        out.push_back((char)b);
+    }
+    out.append("\x21\xFF\x0B" "NETSCAPE2.0" "\x03\x01\x00\x00\x00", 19);
+    
+    // A frame only depends on its own snapshot and the one before. The
+    // latest changed frame is held back until the next change (or the end)
+    // tells how long it stays on screen.
+    std::vector<EncodedFrame> slots(2 * (pool.threads() + 1));
+    EncodedFrame pending;
+    int pendingDelay = 0;
+    bool encoded = pool.runOrdered(
+        snapshots.size(), slots.size(),
+        [&](size_t slot, size_t i) {
+            const CanvasSnapshot* previous = i > 0 ? snapshots[i - 1].get() : nullptr;
+            slots[slot].rect = changedRect(previous, *snapshots[i]);
+            if (slots[slot].rect.x0 < slots[slot].rect.x1) {
+                encodeFrame(*snapshots[i], slots[slot].rect, scale, slots[slot]);
+            }
+        },
+        [&](size_t slot, size_t i) {
+            EncodedFrame& frame = slots[slot];
+            if (frame.rect.x0 >= frame.rect.x1) {
+                pendingDelay += FRAME_DELAY_CS;
+                return true;
+            }
+            if (i > 0) {
+                writeFrame(out, pending, pendingDelay, scale);
+            }
+            std::swap(pending, frame);   // The slot keeps the old buffer for reuse
+            pendingDelay = FRAME_DELAY_CS;
+            return true;
+        });
+    if (!encoded) {
+        return false;
+    }
+    writeFrame(out, pending, FINAL_FRAME_DELAY_CS, scale);
+    out.push_back(0x3B);
+    
+    LOG_INFO("GIF encoded: ", snapshots.size(), " frames at ", width * scale, "x", height * scale, ", ",
+             out.size(), " bytes");
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef GIF_EXPORT_H
+#define GIF_EXPORT_H
+
+#include "canvas_snapshot.h"
+#include "video_export.h"
+#include "work_stealing_pool.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Animated GIF replays encoded in-process, so exports work without ffmpeg.
+//
+// The board's 16 colors are the global color table (4-bit LZW codes). Each
+// frame after the first only stores the bounding box of the cells that
+// changed since the previous frame (found tile by tile; tiles shared between
+// the two snapshots are skipped unread) and leaves the rest of the image in
+// place; frames with no change just lengthen the previous frame's delay.
+// Frames are compressed independently on a thread pool, a bounded number
+// ahead of the writer, and stitched together in order. Sizing follows the
+// video export.
+class GifExport {
+public:
+    static const int FRAME_DELAY_CS = 100 / VideoExport::FRAME_RATE;   // Centiseconds per replay frame
+    static const int FINAL_FRAME_DELAY_CS = 300;                       // Hold the final board before looping
+    
+    // Encode `snapshots` (oldest first, same board size) into `out`
+    static bool encode(const std::vector<SnapshotHandle>& snapshots, std::string& out, WorkStealingPool& pool);
+
+private:
+    // Cell rectangle [x0, x1) x [y0, y1); empty when x0 >= x1
+    struct Rect {
+        int x0, y0, x1, y1;
+    };
+    
+    // One compressed image: its rectangle in cells and its LZW sub-blocks
+    struct EncodedFrame {
+        Rect rect;
+        std::string data;
+    };
+    
+    static void writeFrame(std::string& out, const EncodedFrame& frame, int delay, int scale);
+    static Rect changedRect(const CanvasSnapshot* previous, const CanvasSnapshot& current);
+    static void encodeFrame(const CanvasSnapshot& frame, const Rect& rect, int scale, EncodedFrame& out);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "job_queue.h"
+#include "logger.h"
+#include <exception>
+
+JobQueue::JobQueue(int threads) : stopping_(false) {
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back(&JobQueue::workerLoop, this);
+    }
+}
+
+JobQueue::~JobQueue() {
+    stop();
+}
+
+bool JobQueue::submit(std::function<void()> job) {
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void JobQueue::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+size_t JobQueue::pending() {
+    std::lock_guard lock(mutex_);
+    return jobs_.size();
+}
+
+void JobQueue::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;  // Stopping and drained
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        
+        try {
+            job();
+        } catch (const std::exception& e) {
+            LOG_ERROR("[JobQueue] job failed: ", e.what());
+        }
+    }
+}
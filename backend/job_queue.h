@@ -0,0 +1,39 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed pool of worker threads running submitted jobs in FIFO order. Used for
+// work that must not run on the caller's thread (episode export, disk I/O).
+class JobQueue {
+public:
+    explicit JobQueue(int threads = 1);
+    ~JobQueue();
+    
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+    
+    // Returns false once stop() has been called
+    bool submit(std::function<void()> job);
+    
+    // Finish everything already queued, then join the workers
+    void stop();
+    
+    size_t pending();
+    
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+    
+    void workerLoop();
+};
+
+#endif
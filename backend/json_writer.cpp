@@ -0,0 +1,150 @@
+#include "json_writer.h"
+#include <charconv>
+
+namespace {
+
+std::string& threadBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+}  // namespace
+
+JsonWriter::JsonWriter()
+    : buffer_(threadBuffer()), needComma_(0), depth_(0), afterKey_(false) {
+    buffer_.clear();  // Keeps capacity
+}
+
+JsonWriter::~JsonWriter() {
+    if (buffer_.capacity() > MAX_RETAINED_BYTES) {
+        std::string().swap(buffer_);
+    }
+}
+
+void JsonWriter::separator() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (depth_ == 0) {
+        return;
+    }
+    uint32_t bit = 1u << depth_;
+    if (needComma_ & bit) {
+        buffer_ += ',';
+    }
+    needComma_ |= bit;
+}
+
+void JsonWriter::push() {
+    if (depth_ + 1 < MAX_DEPTH) {
+        ++depth_;
+    }
+    needComma_ &= ~(1u << depth_);
+}
+
+void JsonWriter::pop() {
+    if (depth_ > 0) {
+        --depth_;
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separator();
+    buffer_ += '{';
+    push();
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    pop();
+    buffer_ += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separator();
+    buffer_ += '[';
+    push();
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    pop();
+    buffer_ += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separator();
+    buffer_ += '"';
+    buffer_ += name;
+    buffer_ += "\":";
+    afterKey_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separator();
+    appendEscaped(buffer_, text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separator();
+    buffer_ += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeSigned(long long number) {
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer_.append(digits, result.ptr - digits);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeUnsigned(unsigned long long number) {
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer_.append(digits, result.ptr - digits);
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view text) {
+    buffer_ += text;
+    return *this;
+}
+
+void JsonWriter::appendEscaped(std::string& out, std::string_view text) {
+    static const char* hex = "0123456789abcdef";
+    out += '"';
+    
+    size_t runStart = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        
+        out.append(text.data() + runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0x0F];
+        }
+    }
+    
+    out.append(text.data() + runStart, text.size() - runStart);
+    out += '"';
+}
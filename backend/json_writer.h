@@ -0,0 +1,73 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Streaming JSON builder over a thread-local buffer. The buffer keeps up to
+// MAX_RETAINED_BYTES of capacity between requests, so once warmed up building
+// a typical response does no heap allocation, while one huge response does
+// not pin its memory to the thread; numbers go through std::to_chars (no
+// locale) and strings are escaped. Only one writer may be live per thread at
+// a time.
+//
+//   JsonWriter json;
+//   json.beginObject().field("success", true).field("userId", id).endObject();
+//   res.set_content(json.data(), json.size(), "application/json");
+class JsonWriter {
+public:
+    static const size_t MAX_RETAINED_BYTES = 256 * 1024;
+    
+    JsonWriter();
+    ~JsonWriter();
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+    
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);  // Not escaped: pass identifiers only
+    
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(bool flag);
+    JsonWriter& value(int number) { return writeSigned(number); }
+    JsonWriter& value(unsigned number) { return writeUnsigned(number); }
+    JsonWriter& value(long number) { return writeSigned(number); }
+    JsonWriter& value(unsigned long number) { return writeUnsigned(number); }
+    JsonWriter& value(long long number) { return writeSigned(number); }
+    JsonWriter& value(unsigned long long number) { return writeUnsigned(number); }
+    
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) { return key(name).value(v); }
+    
+    // Append text verbatim (no separator handling). Top-level values never get a
+    // ',' so several documents can be framed with raw text in between.
+    JsonWriter& raw(std::string_view text);
+    
+    const char* data() const { return buffer_.data(); }
+    size_t size() const { return buffer_.size(); }
+    std::string_view view() const { return buffer_; }
+    
+    // Append `text` to `out` as a quoted, escaped JSON string
+    static void appendEscaped(std::string& out, std::string_view text);
+    
+private:
+    static const int MAX_DEPTH = 32;
+    
+    std::string& buffer_;
+    uint32_t needComma_;   // Bit per nesting level: next element needs a ','
+    int depth_;
+    bool afterKey_;
+    
+    void separator();
+    void push();
+    void pop();
+    JsonWriter& writeSigned(long long number);
+    JsonWriter& writeUnsigned(unsigned long long number);
+};
+
+#endif
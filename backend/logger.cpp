@@ -0,0 +1,261 @@
+#include "logger.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint32_t RING_CAPACITY = 128;   // Records per thread (power of two)
+const std::chrono::milliseconds FLUSH_INTERVAL(20);
+
+struct LogRecord {
+    uint64_t timestampNs;
+    uint16_t length;
+    LogLevel level;
+    char text[LogLine::CAPACITY];
+};
+
+// Single-producer (owning thread) / single-consumer (flusher) ring
+struct LogRing {
+    LogRecord records[RING_CAPACITY];
+    alignas(64) std::atomic<uint32_t> head{0};    // Next slot the producer writes
+    alignas(64) std::atomic<uint32_t> tail{0};    // Next slot the flusher reads
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> retired{false};              // Owning thread has exited
+};
+
+std::mutex g_registryMutex;     // Guards g_rings; producers only take it once
+std::vector<LogRing*> g_rings;
+
+std::atomic<bool> g_running{false};
+std::mutex g_flushMutex;
+std::condition_variable g_flushCv;
+bool g_stopRequested = false;
+std::thread g_flusher;
+
+// Marks the ring retired when its thread exits; the flusher frees it once drained
+struct RingHandle {
+    LogRing* ring = nullptr;
+    ~RingHandle() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local RingHandle t_ring;
+
+LogRing* threadRing() {
+    if (!t_ring.ring) {
+        t_ring.ring = new LogRing();
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_rings.push_back(t_ring.ring);
+    }
+    return t_ring.ring;
+}
+
+uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO ";
+        case LogLevel::Warn: return "WARN ";
+        case LogLevel::Error: return "ERROR";
+        default: return "     ";
+    }
+}
+
+// "HH:MM:SS.mmm LEVEL text\n"
+void formatLine(std::string& out, uint64_t timestampNs, LogLevel level, std::string_view text) {
+    time_t seconds = (time_t)(timestampNs / 1000000000ULL);
+    unsigned millis = (unsigned)((timestampNs / 1000000ULL) % 1000);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    
+    char prefix[32];
+    int n = snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03u %s ",
+                     local.tm_hour, local.tm_min, local.tm_sec, millis, levelName(level));
+    out.append(prefix, n > 0 ? (size_t)n : 0);
+    out.append(text.data(), text.size());
+    out += '\n';
+}
+
+struct PendingRecord {
+    uint64_t timestampNs;
+    const LogRecord* record;
+};
+
+// Drain every ring to stderr. Only called from one thread at a time
+// (the flusher, or stop() after joining it).
+void drainRings() {
+    static std::vector<PendingRecord> pending;
+    static std::vector<std::pair<LogRing*, uint32_t>> consumed;
+    static std::string out;
+    pending.clear();
+    consumed.clear();
+    out.clear();
+    
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        for (LogRing* ring : g_rings) {
+            uint32_t head = ring->head.load(std::memory_order_acquire);
+            uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+            for (uint32_t i = tail; i != head; i++) {
+                const LogRecord& record = ring->records[i % RING_CAPACITY];
+                pending.push_back({record.timestampNs, &record});
+            }
+            consumed.push_back({ring, head});
+            dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+        }
+    }
+    
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const PendingRecord& a, const PendingRecord& b) {
+                         return a.timestampNs < b.timestampNs;
+                     });
+    for (const auto& entry : pending) {
+        formatLine(out, entry.timestampNs, entry.record->level,
+                   std::string_view(entry.record->text, entry.record->length));
+    }
+    if (dropped > 0) {
+        LogLine line;
+        line.append("[Log] dropped ");
+        line.append(dropped);
+        line.append(" messages (ring full)");
+        formatLine(out, nowNs(), LogLevel::Warn, line.view());
+    }
+    if (!out.empty()) {
+        fwrite(out.data(), 1, out.size(), stderr);
+        fflush(stderr);
+    }
+    
+    // Hand the slots back, then free rings whose threads are gone
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (const auto& entry : consumed) {
+        entry.first->tail.store(entry.second, std::memory_order_release);
+    }
+    g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [](LogRing* ring) {
+        bool done = ring->retired.load(std::memory_order_acquire) &&
+                    ring->tail.load(std::memory_order_relaxed) ==
+                        ring->head.load(std::memory_order_acquire);
+        if (done) {
+            delete ring;
+        }
+        return done;
+    }), g_rings.end());
+}
+
+void flushLoop() {
+    std::unique_lock<std::mutex> lock(g_flushMutex);
+    while (!g_stopRequested) {
+        g_flushCv.wait_for(lock, FLUSH_INTERVAL);
+        lock.unlock();
+        drainRings();
+        lock.lock();
+    }
+}
+
+}  // namespace
+
+void LogLine::append(std::string_view text) {
+    size_t count = std::min(text.size(), CAPACITY - length_);
+    memcpy(text_ + length_, text.data(), count);
+    length_ += count;
+}
+
+void LogLine::append(double number) {
+    char digits[32];
+    int n = snprintf(digits, sizeof(digits), "%g", number);
+    append(std::string_view(digits, n > 0 ? (size_t)n : 0));
+}
+
+void LogLine::appendSigned(long long number) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    append(std::string_view(digits, result.ptr - digits));
+}
+
+void LogLine::appendUnsigned(unsigned long long number) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    append(std::string_view(digits, result.ptr - digits));
+}
+
+void Logger::start() {
+    if (g_running.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_flushMutex);
+        g_stopRequested = false;
+    }
+    g_flusher = std::thread(flushLoop);
+}
+
+void Logger::stop() {
+    if (!g_running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_flushMutex);
+        g_stopRequested = true;
+    }
+    g_flushCv.notify_all();
+    if (g_flusher.joinable()) {
+        g_flusher.join();
+    }
+    drainRings();  // Anything queued while the flusher was exiting
+}
+
+bool Logger::parseLevel(std::string_view name, LogLevel& out) {
+    if (name == "debug") out = LogLevel::Debug;
+    else if (name == "info") out = LogLevel::Info;
+    else if (name == "warn") out = LogLevel::Warn;
+    else if (name == "error") out = LogLevel::Error;
+    else if (name == "off") out = LogLevel::Off;
+    else return false;
+    return true;
+}
+
+void Logger::submit(LogLevel level, std::string_view text) {
+    uint64_t timestampNs = nowNs();
+    
+    if (!g_running.load(std::memory_order_acquire)) {
+        std::string line;
+        formatLine(line, timestampNs, level, text);
+        fwrite(line.data(), 1, line.size(), stderr);
+        return;
+    }
+    
+    LogRing* ring = threadRing();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= RING_CAPACITY) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    LogRecord& record = ring->records[head % RING_CAPACITY];
+    record.timestampNs = timestampNs;
+    record.level = level;
+    record.length = (uint16_t)text.size();
+    memcpy(record.text, text.data(), text.size());
+    ring->head.store(head + 1, std::memory_order_release);
+    
+    // Half full: wake the flusher early rather than waiting out the interval
+    if (head - tail == RING_CAPACITY / 2) {
+        g_flushCv.notify_one();
+    }
+}
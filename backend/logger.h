@@ -0,0 +1,116 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+// Numeric levels, usable from the preprocessor and CMake
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+// Statements below this level are compiled out entirely (arguments are not
+// evaluated). Set with -DLOG_COMPILE_LEVEL=INFO etc. in CMake.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+enum class LogLevel : uint8_t {
+    Debug = LOG_LEVEL_DEBUG,
+    Info = LOG_LEVEL_INFO,
+    Warn = LOG_LEVEL_WARN,
+    Error = LOG_LEVEL_ERROR,
+    Off = LOG_LEVEL_OFF
+};
+
+constexpr bool logCompiledIn(LogLevel level) {
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+    return (void)level, true;
+#else
+    return (int)level >= LOG_COMPILE_LEVEL;
+#endif
+}
+
+// One formatted message, built on the stack. Text past CAPACITY is cut off.
+class LogLine {
+public:
+    static const size_t CAPACITY = 232;
+    
+    LogLine() : length_(0) {}
+    
+    void append(std::string_view text);
+    void append(const char* text) { append(std::string_view(text ? text : "(null)")); }
+    void append(const std::string& text) { append(std::string_view(text)); }
+    void append(char c) { append(std::string_view(&c, 1)); }
+    void append(bool flag) { append(flag ? '1' : '0'); }
+    void append(double number);
+    
+    template <typename T>
+    std::enable_if_t<std::is_integral<T>::value> append(T number) {
+        if (std::is_signed<T>::value) {
+            appendSigned((long long)number);
+        } else {
+            appendUnsigned((unsigned long long)number);
+        }
+    }
+    
+    std::string_view view() const { return std::string_view(text_, length_); }
+
+private:
+    char text_[CAPACITY];
+    size_t length_;
+    
+    void appendSigned(long long number);
+    void appendUnsigned(unsigned long long number);
+};
+
+// Asynchronous logger. Each logging thread owns a fixed-size single-producer
+// ring; a background flusher drains all rings every few milliseconds, orders
+// the records by timestamp and writes them to stderr in one call. Producers
+// never lock or block: when a ring is full the message is dropped and
+// counted. Before start() (and after stop()) messages are written directly.
+class Logger {
+public:
+    static void start();
+    static void stop();   // Flushes everything still queued
+    
+    static void setLevel(LogLevel level) { level_.store((int)level, std::memory_order_relaxed); }
+    static LogLevel level() { return (LogLevel)level_.load(std::memory_order_relaxed); }
+    static bool parseLevel(std::string_view name, LogLevel& out);
+    
+    static bool enabled(LogLevel level) {
+        return (int)level >= level_.load(std::memory_order_relaxed);
+    }
+    
+    template <typename... Args>
+    static void write(LogLevel level, const Args&... args) {
+        LogLine line;
+        (line.append(args), ...);
+        submit(level, line.view());
+    }
+
+private:
+    static inline std::atomic<int> level_{LOG_LEVEL_INFO};
+    
+    static void submit(LogLevel level, std::string_view text);
+};
+
+#define LOG_AT(level, ...)                                                   \
+    do {                                                                     \
+        if (logCompiledIn(level) && Logger::enabled(level)) {                \
+            Logger::write(level, __VA_ARGS__);                               \
+        }                                                                    \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+#endif
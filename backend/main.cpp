@@ -1,61 +1,157 @@
 #include "server.h"
 #include "database.h"
 #include "canvas.h"
+#include "event_hub.h"
+#include "scheduler.h"
+#include "export_service.h"
+#include "logger.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <thread>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Default board size; override at runtime with `season_canvas [width] [height]`
+const int DEFAULT_CANVAS_WIDTH = 50;
+const int DEFAULT_CANVAS_HEIGHT = 50;
+
+// How often the database log is folded into the base file, in seconds
+const int DB_CHECKPOINT_INTERVAL = 60;
 
 // Global instances
 Database* g_database = nullptr;
 Canvas* g_canvas = nullptr;
+EventHub* g_events = nullptr;
+Scheduler* g_scheduler = nullptr;
+ExportService* g_exports = nullptr;
 Server* g_server = nullptr;
 
-// Signal handler for graceful shutdown
-void signalHandler(int signal) {
-    std::cout << "\nShutting down gracefully..." << std::endl;
-    
-    if (g_server) {
-        g_server->stop();
-    }
-    
-    if (g_canvas) {
-        g_canvas->stop();
-    }
-    
-    if (g_database) {
-        g_database->save();
-    }
+// Self-pipe: the signal handler writes SHUTDOWN_SIGNAL, the server thread
+// SHUTDOWN_SERVER_EXITED once listen() returns; main waits on the read end
+int g_shutdownPipe[2] = {-1, -1};
+const char SHUTDOWN_SIGNAL = 1;
+const char SHUTDOWN_SERVER_EXITED = 2;
+
+void notifyShutdown(char reason) {
+    ssize_t written = ::write(g_shutdownPipe[1], &reason, 1);
+    (void)written;   // The pipe cannot fill up: main stops reading after the first byte
+}
+
+// Signal handler for graceful shutdown. Only async-signal-safe calls here
+// (no logging, locks or joins); main does the actual shutdown. Repeated
+// signals just add bytes nobody reads.
+void signalHandler(int) {
+    int savedErrno = errno;
+    notifyShutdown(SHUTDOWN_SIGNAL);
+    errno = savedErrno;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Logging: runtime level from LOG_LEVEL (debug, info, warn, error, off)
+    LogLevel logLevel;
+    const char* logLevelName = std::getenv("LOG_LEVEL");
+    if (logLevelName && Logger::parseLevel(logLevelName, logLevel)) {
+        Logger::setLevel(logLevel);
+    }
+    Logger::start();
+    
     // Register signal handlers
+    if (::pipe2(g_shutdownPipe, O_CLOEXEC) != 0) {
+        LOG_ERROR("Cannot create the shutdown pipe");
+        Logger::stop();
+        return 1;
+    }
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
+    // A video encoder that exits early must fail the write, not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    // Every open event stream holds a socket; allow as many as the hard limit does
+    rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &files) != 0) {
+            LOG_WARN("Cannot raise the open file limit; event streams are limited by it");
+        }
+    }
     
-    std::cout << "=== Season Canvas Server ===" << std::endl;
-    std::cout << "Initializing..." << std::endl;
+    LOG_INFO("=== Season Canvas Server ===");
+    LOG_INFO("Initializing...");
     
     // Initialize database
     g_database = new Database("data/canvas.omni");
     if (!g_database->load()) {
-        std::cerr << "Failed to load database, creating new one..." << std::endl;
+        LOG_WARN("Failed to load database, creating new one...");
         g_database->initialize();
     }
-    std::cout << "Database loaded." << std::endl;
+    LOG_INFO("Database loaded.");
     
     // Initialize canvas
-    g_canvas = new Canvas(g_database);
+    int canvasWidth = argc > 1 ? std::atoi(argv[1]) : DEFAULT_CANVAS_WIDTH;
+    int canvasHeight = argc > 2 ? std::atoi(argv[2]) : (argc > 1 ? canvasWidth : DEFAULT_CANVAS_HEIGHT);
+    if (canvasWidth <= 0 || canvasHeight <= 0) {
+        LOG_ERROR("Invalid canvas size ", canvasWidth, "x", canvasHeight);
+        Logger::stop();
+        return 1;
+    }
+    g_events = new EventHub();
+    g_scheduler = new Scheduler();
+    g_scheduler->start();
+    g_scheduler->scheduleEvery("db-checkpoint", std::chrono::seconds(DB_CHECKPOINT_INTERVAL),
+                               [] { g_database->checkpoint(); }, JobMode::Dedicated);
+    g_canvas = new Canvas(g_database, g_scheduler, canvasWidth, canvasHeight);
+    g_canvas->setEventHub(g_events);
     g_canvas->start();
-    std::cout << "Canvas initialized." << std::endl;
+    LOG_INFO("Canvas initialized (", canvasWidth, "x", canvasHeight, ").");
+    
+    g_exports = new ExportService(g_canvas);
     
     // Initialize and start server
-    g_server = new Server(8080, g_database, g_canvas);
-    std::cout << "Starting server on http://localhost:8080" << std::endl;
-    std::cout << "Press Ctrl+C to stop." << std::endl;
+    g_server = new Server(8080, g_database, g_canvas, g_events, g_scheduler, g_exports);
+    LOG_INFO("Starting server on http://localhost:8080");
+    LOG_INFO("Press Ctrl+C to stop.");
     
-    g_server->start();
+    // The server listens on its own thread; this one waits for a signal (or
+    // for listen() to fail) and shuts down
+    std::atomic<bool> serverExited{false};
+    std::thread serverThread([&serverExited] {
+        g_server->start();
+        serverExited = true;
+        notifyShutdown(SHUTDOWN_SERVER_EXITED);
+    });
+    char reason = 0;
+    while (::read(g_shutdownPipe[0], &reason, 1) < 0 && errno == EINTR) {
+    }
+    if (reason == SHUTDOWN_SIGNAL) {
+        LOG_INFO("Shutting down gracefully...");
+        // A signal can arrive before listen() is up, and stop() only reaches
+        // a running server
+        while (!serverExited && !g_server->isRunning()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!serverExited) {
+            g_server->stop();
+        }
+    }
+    serverThread.join();
+    g_canvas->stop();
     
-    // Cleanup (unreachable in normal flow due to server blocking)
+    // Cleanup once the server has stopped; the scheduler and export workers
+    // go first so no job can still be touching the canvas. The database is
+    // saved when it is deleted.
+    g_scheduler->stop();
+    g_exports->stop();
     delete g_server;
+    delete g_exports;
     delete g_canvas;
+    delete g_scheduler;
+    delete g_events;
     delete g_database;
     
+    Logger::stop();
     return 0;
 }
\ No newline at end of file
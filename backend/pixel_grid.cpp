@@ -0,0 +1,51 @@
+#include "pixel_grid.h"
+#include <algorithm>
+
+PixelGrid::PixelGrid(int width, int height)
+    : width_(std::max(0, width)), height_(std::max(0, height)) {
+    size_t cells = (size_t)width_ * height_;
+    color_.assign(cells, DEFAULT_COLOR);
+    mood_.assign(cells, static_cast<uint8_t>(DEFAULT_MOOD));
+    timestamp_.assign(cells, 0);
+    userId_.assign(cells, 0);
+}
+
+void PixelGrid::set(int x, int y, uint8_t color, PixelMood mood, uint64_t timestamp, uint32_t userId) {
+    size_t index = (size_t)y * width_ + x;
+    color_[index] = color;
+    mood_[index] = static_cast<uint8_t>(mood);
+    timestamp_[index] = (uint32_t)timestamp;
+    userId_[index] = userId;
+}
+
+Pixel PixelGrid::get(int x, int y) const {
+    size_t index = (size_t)y * width_ + x;
+    return {x, y, color_[index], static_cast<PixelMood>(mood_[index]), timestamp_[index], userId_[index]};
+}
+
+void PixelGrid::clear() {
+    std::fill(color_.begin(), color_.end(), DEFAULT_COLOR);
+    std::fill(mood_.begin(), mood_.end(), static_cast<uint8_t>(DEFAULT_MOOD));
+    std::fill(timestamp_.begin(), timestamp_.end(), 0);
+    std::fill(userId_.begin(), userId_.end(), 0);
+}
+
+void PixelGrid::appendRegion(int x, int y, int w, int h, std::vector<Pixel>& out) const {
+    int startX = std::max(0, x);
+    int startY = std::max(0, y);
+    int endX = (int)std::min<int64_t>((int64_t)x + w, width_);   // x + w may not fit in an int
+    int endY = (int)std::min<int64_t>((int64_t)y + h, height_);
+    if (startX >= endX || startY >= endY) {
+        return;
+    }
+    
+    out.reserve(out.size() + (size_t)(endX - startX) * (endY - startY));
+    for (int j = startY; j < endY; ++j) {
+        size_t row = (size_t)j * width_;
+        for (int i = startX; i < endX; ++i) {
+            size_t index = row + i;
+            out.push_back({i, j, color_[index], static_cast<PixelMood>(mood_[index]),
+                           timestamp_[index], userId_[index]});
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef PIXEL_GRID_H
+#define PIXEL_GRID_H
+
+#include <vector>
+#include <cstdint>
+
+// Pixel moods
+enum class PixelMood : uint8_t {
+    Happy = 0,
+    Sad = 1,
+    Calm = 2,
+    Energetic = 3
+};
+
+// Pixel structure (expanded view of a single cell, used by the API layer)
+struct Pixel {
+    int x, y;
+    uint8_t color;
+    PixelMood mood;
+    uint64_t timestamp;
+    uint32_t userId;
+};
+
+// Default cell contents: white, calm, never painted
+const uint8_t DEFAULT_COLOR = 15;
+const PixelMood DEFAULT_MOOD = PixelMood::Calm;
+
+// Flat, row-major pixel storage laid out as structure-of-arrays.
+// Each plane is one contiguous allocation, so a cell costs 10 bytes
+// (color + mood + 32-bit timestamp + userId) and coordinates are implied
+// by the index instead of being stored.
+class PixelGrid {
+public:
+    PixelGrid(int width = 0, int height = 0);
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    bool contains(int x, int y) const { return x >= 0 && x < width_ && y >= 0 && y < height_; }
+    
+    void set(int x, int y, uint8_t color, PixelMood mood, uint64_t timestamp, uint32_t userId);
+    Pixel get(int x, int y) const;
+    void clear();
+    
+    // Append the clipped region [x, x+w) x [y, y+h) to `out` in row-major order
+    void appendRegion(int x, int y, int w, int h, std::vector<Pixel>& out) const;
+    
+    // Raw planes, indexed by y * width() + x
+    const uint8_t* colors() const { return color_.data(); }
+    const uint8_t* moods() const { return mood_.data(); }
+    const uint32_t* timestamps() const { return timestamp_.data(); }
+    const uint32_t* userIds() const { return userId_.data(); }
+    
+private:
+    int width_;
+    int height_;
+    std::vector<uint8_t> color_;
+    std::vector<uint8_t> mood_;
+    std::vector<uint32_t> timestamp_;
+    std::vector<uint32_t> userId_;
+};
+
+#endif
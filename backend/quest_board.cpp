@@ -0,0 +1,58 @@
+#include "quest_board.h"
+#include "logger.h"
+
+QuestBoard::QuestBoard() {
+    quests_.emplace_back("Place 40 blue pixels", 40);
+    quests_.emplace_back("Fill top-left 10x10 area", 100);
+    quests_.emplace_back("Place 20 calm pixels", 20);
+}
+
+bool QuestBoard::record(int x, int y, uint8_t color, PixelMood mood) {
+    bool changed = false;
+    
+    // Quest 0: Place 40 blue pixels
+    if (color == 2) {  // Blue
+        changed |= advance(quests_[0]);
+    }
+    
+    // Quest 1: Fill top-left 10x10 area
+    if (x < 10 && y < 10) {
+        changed |= advance(quests_[1]);
+    }
+    
+    // Quest 2: Place 20 calm pixels
+    if (mood == PixelMood::Calm) {
+        changed |= advance(quests_[2]);
+    }
+    return changed;
+}
+
+bool QuestBoard::advance(Entry& quest) {
+    // Progress stops at the target; exactly one placement observes completion
+    int progress = quest.progress.load(std::memory_order_relaxed);
+    while (progress < quest.target) {
+        if (quest.progress.compare_exchange_weak(progress, progress + 1, std::memory_order_relaxed)) {
+            if (progress + 1 == quest.target) {
+                LOG_INFO("Quest completed: ", quest.description);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Quest> QuestBoard::getQuests() const {
+    std::vector<Quest> result;
+    result.reserve(quests_.size());
+    for (const auto& quest : quests_) {
+        int progress = quest.progress.load(std::memory_order_relaxed);
+        result.push_back({quest.description, progress, quest.target, progress >= quest.target});
+    }
+    return result;
+}
+
+void QuestBoard::reset() {
+    for (auto& quest : quests_) {
+        quest.progress.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef QUEST_BOARD_H
+#define QUEST_BOARD_H
+
+#include "pixel_grid.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <cstdint>
+
+// Quest structure
+struct Quest {
+    std::string description;
+    int progress;
+    int target;
+    bool completed;
+};
+
+// Community quests. Progress counters are atomics, so recording a placement
+// never takes a lock and never contends with readers.
+class QuestBoard {
+public:
+    QuestBoard();
+    
+    // Count a placement towards every quest it satisfies; true if any progress changed
+    bool record(int x, int y, uint8_t color, PixelMood mood);
+    std::vector<Quest> getQuests() const;
+    void reset();
+    
+private:
+    struct Entry {
+        std::string description;
+        int target;
+        std::atomic<int> progress;
+        
+        Entry(const std::string& desc, int goal) : description(desc), target(goal), progress(0) {}
+    };
+    
+    std::deque<Entry> quests_;
+    
+    bool advance(Entry& quest);
+};
+
+#endif
@@ -0,0 +1,322 @@
+#include "scheduler.h"
+#include "logger.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+
+uint64_t toMicros(Scheduler::Clock::duration d) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    return us > 0 ? (uint64_t)us : 0;
+}
+
+}  // namespace
+
+Scheduler::Scheduler(int workerThreads)
+    : workers_(workerThreads), epoch_(Clock::now()), currentTick_(0), nextId_(1), running_(false), inFlight_(0) {
+}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+void Scheduler::start() {
+    std::lock_guard lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    timerThread_ = std::thread(&Scheduler::timerLoop, this);
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (timerThread_.joinable()) {
+        timerThread_.join();
+    }
+    
+    {
+        std::unique_lock lock(mutex_);
+        drainDue(lock);
+    }
+    workers_.stop();
+    for (auto& [name, worker] : dedicated_) {
+        worker->stop();
+    }
+}
+
+// Run the one-shot jobs that are due until none is left and no worker run
+// could schedule another. The timer thread is gone, so due jobs are found by
+// deadline rather than through the wheel.
+void Scheduler::drainDue(std::unique_lock<std::mutex>& lock) {
+    std::vector<std::shared_ptr<Job>> due;
+    while (true) {
+        Clock::time_point now = Clock::now();
+        due.clear();
+        for (const auto& [id, job] : jobs_) {
+            if (job->interval == Clock::duration::zero() && job->deadline <= now) {
+                due.push_back(job);
+            }
+        }
+        if (due.empty() && inFlight_ == 0) {
+            return;
+        }
+        for (const auto& job : due) {
+            if (!job->cancelled) {
+                dispatch(job, now);
+            }
+        }
+        if (due.empty()) {
+            cv_.wait(lock);   // A worker run finishing or scheduling a job wakes us
+        }
+    }
+}
+
+Scheduler::JobId Scheduler::scheduleAfter(const std::string& name, Clock::duration delay,
+                                          std::function<void()> fn, JobMode mode) {
+    return add(name, delay, Clock::duration::zero(), std::move(fn), mode);
+}
+
+Scheduler::JobId Scheduler::scheduleEvery(const std::string& name, Clock::duration interval,
+                                          std::function<void()> fn, JobMode mode) {
+    interval = std::max<Clock::duration>(interval, TICK);
+    return add(name, interval, interval, std::move(fn), mode);
+}
+
+Scheduler::JobId Scheduler::add(const std::string& name, Clock::duration delay, Clock::duration interval,
+                                std::function<void()> fn, JobMode mode) {
+    auto job = std::make_shared<Job>();
+    job->name = name;
+    job->fn = std::move(fn);
+    job->mode = mode;
+    job->interval = interval;
+    job->deadline = Clock::now() + delay;
+    job->running = false;
+    job->cancelled = false;
+    
+    JobId id;
+    {
+        std::lock_guard lock(mutex_);
+        id = job->id = nextId_++;
+        metrics_[name].periodic = interval != Clock::duration::zero();
+        if (mode == JobMode::Dedicated && !dedicated_.count(name)) {
+            dedicated_[name] = std::make_unique<JobQueue>(1);
+        }
+        jobs_[id] = job;
+        arm(*job);
+    }
+    cv_.notify_all();  // The new deadline may be earlier than the current sleep
+    return id;
+}
+
+bool Scheduler::cancel(JobId id) {
+    std::lock_guard lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    it->second->cancelled = true;
+    jobs_.erase(it);
+    return true;
+}
+
+std::vector<JobStats> Scheduler::stats() {
+    std::lock_guard lock(mutex_);
+    std::vector<JobStats> result;
+    result.reserve(metrics_.size());
+    for (const auto& [name, m] : metrics_) {
+        result.push_back({name, m.periodic, m.runs, m.missed,
+                          m.runs ? m.totalLatencyUs / m.runs : 0, m.maxLatencyUs,
+                          m.runs ? m.totalDurationUs / m.runs : 0, m.maxDurationUs});
+    }
+    return result;
+}
+
+// First tick at or after `time`
+uint64_t Scheduler::tickAt(Clock::time_point time) const {
+    if (time <= epoch_) {
+        return 0;
+    }
+    auto ticks = (time - epoch_ + TICK - Clock::duration(1)) / TICK;
+    return (uint64_t)ticks;
+}
+
+void Scheduler::arm(Job& job) {
+    // Never arm in the past: the earliest a timer can fire is the next tick
+    job.expiresTick = std::max(tickAt(job.deadline), currentTick_ + 1);
+    insert({job.id, job.expiresTick});
+}
+
+void Scheduler::insert(const Entry& entry) {
+    uint64_t delta = entry.expiresTick - currentTick_;
+    uint64_t expires = entry.expiresTick;
+    
+    if (delta < LEVEL0_SLOTS) {
+        level0_[expires & (LEVEL0_SLOTS - 1)].push_back(entry);
+        return;
+    }
+    
+    // Beyond the last level: park in the farthest slot, re-inserted on cascade
+    if (delta >= MAX_TICKS) {
+        expires = currentTick_ + MAX_TICKS - 1;
+    }
+    
+    for (int level = 1; level < LEVELS; ++level) {
+        int shift = LEVEL0_BITS + level * LEVEL_BITS;
+        if (delta < (1ULL << shift) || level == LEVELS - 1) {
+            int slotShift = shift - LEVEL_BITS;
+            levels_[level - 1][(expires >> slotShift) & (LEVEL_SLOTS - 1)].push_back(entry);
+            return;
+        }
+    }
+}
+
+// Move the slot of `level` that covers the current tick down the hierarchy
+void Scheduler::cascade(int level) {
+    int slotShift = LEVEL0_BITS + (level - 1) * LEVEL_BITS;
+    auto& slot = levels_[level - 1][(currentTick_ >> slotShift) & (LEVEL_SLOTS - 1)];
+    std::vector<Entry> entries;
+    entries.swap(slot);
+    for (const auto& entry : entries) {
+        insert(entry);
+    }
+}
+
+// Tick the timer thread next has to act on: the next occupied level-0 slot,
+// or the next level-0 wrap (where higher levels cascade)
+uint64_t Scheduler::nextWakeTick() const {
+    uint64_t boundary = (currentTick_ | (LEVEL0_SLOTS - 1)) + 1;
+    for (uint64_t tick = currentTick_ + 1; tick < boundary; ++tick) {
+        if (!level0_[tick & (LEVEL0_SLOTS - 1)].empty()) {
+            return tick;
+        }
+    }
+    return boundary;
+}
+
+void Scheduler::advance(uint64_t targetTick, std::vector<std::shared_ptr<Job>>& due) {
+    while (currentTick_ < targetTick) {
+        ++currentTick_;
+        
+        // Cascade from the top so entries can drop several levels in one tick
+        if ((currentTick_ & (LEVEL0_SLOTS - 1)) == 0) {
+            for (int level = LEVELS - 1; level >= 1; --level) {
+                uint64_t mask = (1ULL << (LEVEL0_BITS + (level - 1) * LEVEL_BITS)) - 1;
+                if ((currentTick_ & mask) == 0) {
+                    cascade(level);
+                }
+            }
+        }
+        
+        auto& slot = level0_[currentTick_ & (LEVEL0_SLOTS - 1)];
+        if (slot.empty()) {
+            continue;
+        }
+        std::vector<Entry> entries;
+        entries.swap(slot);
+        for (const auto& entry : entries) {
+            auto it = jobs_.find(entry.id);
+            if (it == jobs_.end() || it->second->expiresTick != entry.expiresTick) {
+                continue;  // Cancelled or re-armed since
+            }
+            if (entry.expiresTick > currentTick_) {
+                insert(entry);  // Was parked past the wheel's range
+                continue;
+            }
+            due.push_back(it->second);
+        }
+    }
+}
+
+// Called with mutex_ held for a job whose deadline has come
+void Scheduler::dispatch(const std::shared_ptr<Job>& job, Clock::time_point now) {
+    Clock::time_point deadline = job->deadline;
+    Metrics& metrics = metrics_[job->name];
+    
+    if (job->interval != Clock::duration::zero()) {
+        // Next deadline from the previous one, skipping any that already passed
+        job->deadline += job->interval;
+        while (job->deadline <= now) {
+            job->deadline += job->interval;
+            ++metrics.missed;
+        }
+        arm(*job);
+    } else {
+        jobs_.erase(job->id);
+    }
+    
+    if (job->running) {
+        ++metrics.missed;  // Previous run still going; never overlap a job with itself
+        return;
+    }
+    job->running = true;
+    
+    if (job->mode != JobMode::Inline) {
+        JobQueue& queue = job->mode == JobMode::Dedicated ? *dedicated_[job->name] : workers_;
+        if (queue.submit([this, job, deadline] { run(job, deadline); })) {
+            ++inFlight_;
+        } else {
+            job->running = false;
+        }
+    } else {
+        mutex_.unlock();
+        run(job, deadline);
+        mutex_.lock();
+    }
+}
+
+void Scheduler::run(const std::shared_ptr<Job>& job, Clock::time_point deadline) {
+    Clock::time_point start = Clock::now();
+    try {
+        job->fn();
+    } catch (const std::exception& e) {
+        LOG_ERROR("[Scheduler] job ", job->name, " failed: ", e.what());
+    }
+    Clock::time_point end = Clock::now();
+    
+    std::lock_guard lock(mutex_);
+    job->running = false;
+    if (job->mode != JobMode::Inline) {
+        --inFlight_;
+        if (!running_) {
+            cv_.notify_all();   // stop() is waiting for worker runs to finish
+        }
+    }
+    Metrics& metrics = metrics_[job->name];
+    uint64_t latency = toMicros(start - deadline);
+    uint64_t duration = toMicros(end - start);
+    ++metrics.runs;
+    metrics.totalLatencyUs += latency;
+    metrics.maxLatencyUs = std::max(metrics.maxLatencyUs, latency);
+    metrics.totalDurationUs += duration;
+    metrics.maxDurationUs = std::max(metrics.maxDurationUs, duration);
+}
+
+void Scheduler::timerLoop() {
+    std::vector<std::shared_ptr<Job>> due;
+    std::unique_lock lock(mutex_);
+    
+    while (running_) {
+        // Tick times are derived from the epoch, so sleeping never accumulates drift
+        Clock::time_point wakeAt = epoch_ + TICK * nextWakeTick();
+        cv_.wait_until(lock, wakeAt);
+        if (!running_) {
+            break;
+        }
+        
+        Clock::time_point now = Clock::now();
+        uint64_t nowTick = (uint64_t)((now - epoch_) / TICK);
+        due.clear();
+        advance(nowTick, due);
+        
+        for (const auto& job : due) {
+            if (!job->cancelled && running_) {
+                dispatch(job, now);
+            }
+        }
+    }
+}
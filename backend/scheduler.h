@@ -0,0 +1,149 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "job_queue.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Where a job body runs. Inline jobs run on the timer thread and must be
+// short (flag flips, event publishing); anything that copies the board or
+// touches disk should use Worker. Dedicated jobs get a worker thread of their
+// own (one per job name), for long periodic work that must not hold up the
+// shared workers.
+enum class JobMode {
+    Inline,
+    Worker,
+    Dedicated
+};
+
+// Timing metrics, aggregated per job name (one-shots that are re-armed under
+// the same name accumulate into one entry)
+struct JobStats {
+    std::string name;
+    bool periodic;
+    uint64_t runs;
+    uint64_t missed;          // Periodic deadlines skipped (job overran or thread stalled)
+    uint64_t avgLatencyUs;    // Start time minus deadline
+    uint64_t maxLatencyUs;
+    uint64_t avgDurationUs;
+    uint64_t maxDurationUs;
+};
+
+// Single-threaded hierarchical timer wheel plus a worker pool for heavy jobs.
+//
+// Time advances in TICK steps. Level 0 has 256 one-tick slots; levels 1-3
+// have 64 slots each covering 256, 2^14 and 2^20 ticks, and are cascaded
+// down as time reaches them, so arming and firing a timer is O(1) whatever
+// the number of jobs. The timer thread sleeps until the next non-empty slot
+// (or the next cascade). Periodic jobs are re-armed from their previous
+// deadline rather than from when they ran, so they do not drift; a periodic
+// worker job that is still running when it is due again skips that run.
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using JobId = uint64_t;
+    
+    static constexpr std::chrono::milliseconds TICK{1};
+    
+    explicit Scheduler(int workerThreads = 2);
+    ~Scheduler();
+    
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    
+    void start();
+    // Stop firing timers and join the threads. One-shot jobs that are due by
+    // then still run, including ones that running jobs schedule while the
+    // scheduler drains (e.g. a zero-delay export); later deadlines and
+    // periodic jobs are dropped.
+    void stop();
+    
+    // Run once after `delay`
+    JobId scheduleAfter(const std::string& name, Clock::duration delay,
+                        std::function<void()> fn, JobMode mode = JobMode::Inline);
+    // Run every `interval`, first after one interval
+    JobId scheduleEvery(const std::string& name, Clock::duration interval,
+                        std::function<void()> fn, JobMode mode = JobMode::Inline);
+    // Cancel a pending job; a run already in progress completes
+    bool cancel(JobId id);
+    
+    std::vector<JobStats> stats();
+
+private:
+    static const int LEVELS = 4;
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVEL0_SLOTS = 1 << LEVEL0_BITS;
+    static const int LEVEL_SLOTS = 1 << LEVEL_BITS;
+    static const uint64_t MAX_TICKS = 1ULL << (LEVEL0_BITS + 3 * LEVEL_BITS);
+    
+    struct Job {
+        JobId id;
+        std::string name;
+        std::function<void()> fn;
+        JobMode mode;
+        Clock::duration interval;    // Zero for one-shot jobs
+        Clock::time_point deadline;
+        uint64_t expiresTick;        // Tick the wheel entry for `deadline` fires at
+        bool running;
+        bool cancelled;
+    };
+    
+    // Wheel entries refer to jobs by id; cancelled or re-armed jobs leave
+    // stale entries behind that are skipped when they come due
+    struct Entry {
+        JobId id;
+        uint64_t expiresTick;
+    };
+    
+    struct Metrics {
+        bool periodic = false;
+        uint64_t runs = 0;
+        uint64_t missed = 0;
+        uint64_t totalLatencyUs = 0;
+        uint64_t maxLatencyUs = 0;
+        uint64_t totalDurationUs = 0;
+        uint64_t maxDurationUs = 0;
+    };
+    
+    std::array<std::vector<Entry>, LEVEL0_SLOTS> level0_;
+    std::array<std::array<std::vector<Entry>, LEVEL_SLOTS>, LEVELS - 1> levels_;
+    std::unordered_map<JobId, std::shared_ptr<Job>> jobs_;
+    std::map<std::string, Metrics> metrics_;
+    
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread timerThread_;
+    JobQueue workers_;
+    std::map<std::string, std::unique_ptr<JobQueue>> dedicated_;   // Job name -> its worker
+    Clock::time_point epoch_;
+    uint64_t currentTick_;
+    JobId nextId_;
+    bool running_;
+    int inFlight_;   // Worker runs submitted and not yet finished
+    
+    JobId add(const std::string& name, Clock::duration delay, Clock::duration interval,
+              std::function<void()> fn, JobMode mode);
+    uint64_t tickAt(Clock::time_point time) const;
+    void arm(Job& job);
+    void insert(const Entry& entry);
+    void cascade(int level);
+    uint64_t nextWakeTick() const;
+    void advance(uint64_t targetTick, std::vector<std::shared_ptr<Job>>& due);
+    void dispatch(const std::shared_ptr<Job>& job, Clock::time_point now);
+    void run(const std::shared_ptr<Job>& job, Clock::time_point deadline);
+    void timerLoop();
+    void drainDue(std::unique_lock<std::mutex>& lock);
+};
+
+#endif
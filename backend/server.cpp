@@ -1,18 +1,138 @@
 #include "server.h"
-#include "snapshot.h"
-#include "video_export.h"
-#include <iostream>
+#include "episode_archive.h"
+#include "canvas_wire.h"
+#include "json_writer.h"
+#include "body_parser.h"
+#include "logger.h"
 #include <sstream>
 #include <fstream>
-#include <filesystem>
 #include <random>
 #include <string>
 #include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 
-namespace fs = std::filesystem;
+// Largest region edge served by a single /api/canvas request
+const int MAX_REGION_SIZE = 256;
 
-Server::Server(int port, Database* db, Canvas* canvas)
-    : port_(port), db_(db), canvas_(canvas) {
+// Event streams live on the dispatcher thread, not on HTTP workers; the
+// limit is on sockets (see main(), which raises the descriptor limit)
+const size_t MAX_EVENT_STREAMS = 65536;
+
+namespace {
+
+void sendJson(httplib::Response& res, const JsonWriter& json) {
+    res.set_content(json.data(), json.size(), "application/json");
+}
+
+void sendBadRequest(httplib::Response& res) {
+    res.set_content("{\"error\":\"Malformed request\"}", "application/json");
+    res.status = 400;
+}
+
+// Integer query parameter; fallback when absent, false when not a number
+template <typename T>
+bool queryParam(const httplib::Request& req, const char* name, T fallback, T& out) {
+    auto it = req.params.find(name);
+    if (it == req.params.end()) {
+        out = fallback;
+        return true;
+    }
+    return parseInteger(it->second, out);
+}
+
+void writePixels(JsonWriter& json, const std::vector<Pixel>& pixels) {
+    json.beginArray();
+    for (const auto& pixel : pixels) {
+        json.beginObject()
+            .field("x", pixel.x)
+            .field("y", pixel.y)
+            .field("color", (int)pixel.color)
+            .field("mood", (int)pixel.mood)
+            .field("timestamp", pixel.timestamp)
+            .field("userId", pixel.userId)
+            .endObject();
+    }
+    json.endArray();
+}
+
+void writeChatMessages(JsonWriter& json, const std::vector<ChatMessage>& messages) {
+    json.beginArray();
+    for (const auto& msg : messages) {
+        json.beginObject()
+            .field("username", msg.username)
+            .field("message", msg.message)
+            .field("timestamp", msg.timestamp)
+            .endObject();
+    }
+    json.endArray();
+}
+
+void writeQuests(JsonWriter& json, const std::vector<Quest>& quests) {
+    json.beginArray();
+    for (const auto& quest : quests) {
+        json.beginObject()
+            .field("description", quest.description)
+            .field("progress", quest.progress)
+            .field("target", quest.target)
+            .field("completed", quest.completed)
+            .endObject();
+    }
+    json.endArray();
+}
+
+void writeEpisodeFields(JsonWriter& json, const EpisodeInfo& info) {
+    json.field("episodeNumber", info.episodeNumber)
+        .field("timeRemaining", info.timeRemaining)
+        .field("isActive", info.isActive)
+        .field("isFrozen", info.isFrozen)
+        .field("phase", episodePhaseName(info.phase))
+        .field("freezeRemaining", info.freezeRemaining);
+}
+
+void writeExportStatus(JsonWriter& json, const ExportStatus& status) {
+    json.beginObject()
+        .field("id", status.id)
+        .field("kind", exportKindName(status.key.kind))
+        .field("episode", status.key.episode)
+        .field("placements", status.key.placements)
+        .field("state", exportStateName(status.state));
+    if (status.state == ExportState::Done) {
+        json.field("size", (uint64_t)status.artifact->size())
+            .field("download", "/api/exports/" + std::to_string(status.id) + "/download");
+    } else if (status.state == ExportState::Failed) {
+        json.field("error", status.error);
+    }
+    json.endObject();
+}
+
+// Stream a finished export straight from the cached buffer (no copy)
+void sendArtifact(httplib::Response& res, const ExportStatus& status) {
+    std::shared_ptr<const std::string> artifact = status.artifact;
+    const char* contentType = "video/mp4";
+    const char* disposition = "attachment; filename=\"canvas_replay.mp4\"";
+    if (status.key.kind == ExportKind::Png) {
+        contentType = "image/png";
+        disposition = "attachment; filename=\"canvas.png\"";
+    } else if (status.key.kind == ExportKind::Gif) {
+        contentType = "image/gif";
+        disposition = "attachment; filename=\"canvas_replay.gif\"";
+    }
+    res.set_content_provider(
+        artifact->size(), contentType,
+        [artifact](size_t offset, size_t length, httplib::DataSink& sink) {
+            return sink.write(artifact->data() + offset, length);
+        });
+    res.set_header("Content-Disposition", disposition);
+}
+
+}  // namespace
+
+Server::Server(int port, Database* db, Canvas* canvas, EventHub* events, Scheduler* scheduler,
+               ExportService* exports)
+    : port_(port), db_(db), canvas_(canvas), events_(events), scheduler_(scheduler), exports_(exports),
+      streams_(events, [this](const EventBatch& batch) { return formatEvents(batch); }) {
 }
 
 Server::~Server() {
@@ -22,12 +142,16 @@ Server::~Server() {
 void Server::start() {
     setupRoutes();
     serveStatic();
+    streams_.start();
     
-    std::cout << "Server listening on port " << port_ << std::endl;
-    server_.listen("0.0.0.0", port_);
+    LOG_INFO("Server listening on port ", port_);
+    if (!server_.listen("0.0.0.0", port_)) {
+        LOG_ERROR("Cannot listen on port ", port_);
+    }
 }
 
 void Server::stop() {
+    streams_.stop();
     server_.stop();
 }
 
@@ -37,6 +161,10 @@ void Server::setupRoutes() {
         handleGetCanvas(req, res);
     });
     
+    server_.Get("/api/canvas/delta", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetCanvasDelta(req, res);
+    });
+    
     server_.Post("/api/place_pixel", [this](const httplib::Request& req, httplib::Response& res) {
         handlePlacePixel(req, res);
     });
@@ -69,6 +197,14 @@ void Server::setupRoutes() {
         handleGetEpisode(req, res);
     });
     
+    server_.Get("/api/timeline", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetTimeline(req, res);
+    });
+    
+    server_.Get("/api/archive", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetArchive(req, res);
+    });
+    
     server_.Get("/api/export_png", [this](const httplib::Request& req, httplib::Response& res) {
         handleExportPNG(req, res);
     });
@@ -77,10 +213,30 @@ void Server::setupRoutes() {
         handleExportVideo(req, res);
     });
     
+    server_.Post("/api/exports", [this](const httplib::Request& req, httplib::Response& res) {
+        handleCreateExport(req, res);
+    });
+    
+    server_.Get(R"(/api/exports/(\d+))", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetExport(req, res);
+    });
+    
+    server_.Get(R"(/api/exports/(\d+)/download)", [this](const httplib::Request& req, httplib::Response& res) {
+        handleDownloadExport(req, res);
+    });
+    
     server_.Get("/api/history", [this](const httplib::Request& req, httplib::Response& res) {
         handleGetHistory(req, res);
     });
     
+    server_.Get("/api/events", [this](const httplib::Request& req, httplib::Response& res) {
+        handleEvents(req, res);
+    });
+    
+    server_.Get("/api/scheduler", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetScheduler(req, res);
+    });
+    
     server_.Get("/test", [](const httplib::Request&, httplib::Response& res) {
         res.set_content("{}", "application/json");
     });
@@ -89,7 +245,7 @@ void Server::setupRoutes() {
 void Server::serveStatic() {
     // Serve frontend files
     server_.Get("/", [](const httplib::Request&, httplib::Response& res) {
-        std::cerr << "[HTTP] Serving index.html" << std::endl;
+        LOG_DEBUG("[HTTP] Serving index.html");
         std::ifstream file("frontend/index.html");
         if (file) {
             std::stringstream buffer;
@@ -124,73 +280,111 @@ void Server::serveStatic() {
 }
 
 void Server::handleGetCanvas(const httplib::Request& req, httplib::Response& res) {
-    std::cerr << "[HTTP] handleGetCanvas called" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetCanvas called");
     // Get visible region parameters
-    int x = req.has_param("x") ? std::stoi(req.get_param_value("x")) : 0;
-    int y = req.has_param("y") ? std::stoi(req.get_param_value("y")) : 0;
-    int width = req.has_param("width") ? std::stoi(req.get_param_value("width")) : 50;
-    int height = req.has_param("height") ? std::stoi(req.get_param_value("height")) : 50;
+    int x, y, width, height;
+    if (!queryParam(req, "x", 0, x) || !queryParam(req, "y", 0, y) ||
+        !queryParam(req, "width", canvas_->getWidth(), width) ||
+        !queryParam(req, "height", canvas_->getHeight(), height)) {
+        sendBadRequest(res);
+        return;
+    }
+    width = std::min(width, MAX_REGION_SIZE);
+    height = std::min(height, MAX_REGION_SIZE);
     
-    // Get canvas data
+    // Get canvas data (version first, so the pixels are at least that new)
+    uint64_t version = canvas_->getVersion();
     auto pixels = canvas_->getRegion(x, y, width, height);
-    std::cerr << "[HTTP] handleGetCanvas sending " << pixels.size() << " pixels" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetCanvas sending ", pixels.size(), " pixels");
+    
+    // Packed binary representation on request
+    bool binary = req.get_param_value("format") == "bin" ||
+                  req.get_header_value("Accept").find("application/octet-stream") != std::string::npos;
+    if (binary) {
+        // Same clipping as Canvas::getRegion
+        int startX = std::max(0, x);
+        int startY = std::max(0, y);
+        WireRegion region{startX, startY,
+                          std::max(0, (int)std::min<int64_t>((int64_t)x + width, canvas_->getWidth()) - startX),
+                          std::max(0, (int)std::min<int64_t>((int64_t)y + height, canvas_->getHeight()) - startY),
+                          canvas_->getWidth(), canvas_->getHeight(), version, canvas_->getCurrentTime()};
+        if (pixels.empty()) {
+            region.width = region.height = 0;
+        }
+        
+        std::string planes = req.get_param_value("planes");
+        uint16_t flags = 0;
+        if (planes.find("mood") != std::string::npos) flags |= WIRE_MOOD_PLANE;
+        if (planes.find("timestamp") != std::string::npos) flags |= WIRE_TIMESTAMP_PLANE;
+        
+        res.set_content(CanvasWire::encode(region, pixels, flags), "application/octet-stream");
+        return;
+    }
     
     // Build JSON response
-    std::stringstream json;
-    json << "{\"pixels\":[";
-    
-    bool first = true;
-    for (const auto& pixel : pixels) {
-        if (!first) json << ",";
-        first = false;
-        
-        json << "{"
-             << "\"x\":" << pixel.x << ","
-             << "\"y\":" << pixel.y << ","
-             << "\"color\":" << (int)pixel.color << ","
-             << "\"mood\":" << (int)pixel.mood << ","
-             << "\"timestamp\":" << pixel.timestamp << ","
-             << "\"userId\":" << pixel.userId
-             << "}";
+    JsonWriter json;
+    json.beginObject().key("pixels");
+    writePixels(json, pixels);
+    json.field("width", canvas_->getWidth())
+        .field("height", canvas_->getHeight())
+        .field("version", version)
+        .field("timestamp", canvas_->getCurrentTime())
+        .endObject();
+    
+    sendJson(res, json);
+}
+
+void Server::handleGetCanvasDelta(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleGetCanvasDelta called");
+    uint64_t since;
+    int x, y, width, height;
+    if (!queryParam(req, "since", (uint64_t)0, since) ||
+        !queryParam(req, "x", 0, x) || !queryParam(req, "y", 0, y) ||
+        !queryParam(req, "width", canvas_->getWidth(), width) ||
+        !queryParam(req, "height", canvas_->getHeight(), height)) {
+        sendBadRequest(res);
+        return;
     }
+    width = std::min(width, MAX_REGION_SIZE);
+    height = std::min(height, MAX_REGION_SIZE);
+    
+    auto delta = canvas_->getDelta(since, x, y, width, height);
     
-    json << "],\"timestamp\":" << canvas_->getCurrentTime() << "}";
+    JsonWriter json;
+    json.beginObject()
+        .field("version", delta.version)
+        .field("fullResync", delta.fullResync)
+        .key("pixels");
+    writePixels(json, delta.pixels);
+    json.field("timestamp", canvas_->getCurrentTime()).endObject();
     
-    res.set_content(json.str(), "application/json");
+    sendJson(res, json);
 }
 
 void Server::handlePlacePixel(const httplib::Request& req, httplib::Response& res) {
-    std::cerr << "[HTTP] handlePlacePixel called" << std::endl;
+    LOG_DEBUG("[HTTP] handlePlacePixel called");
     // Parse request body (JSON)
-    std::string body = req.body;
+    BodyParser body;
+    if (!body.parse(req.body)) {
+        sendBadRequest(res);
+        return;
+    }
     
-    // Simple JSON parsing (in production, use a proper JSON library)
     int x = -1, y = -1, color = -1, mood = 0;
-    std::string sessionId;
-    
-    // Extract values (basic parsing)
-    size_t pos;
-    if ((pos = body.find("\"x\":")) != std::string::npos) {
-        x = std::stoi(body.substr(pos + 4));
-    }
-    if ((pos = body.find("\"y\":")) != std::string::npos) {
-        y = std::stoi(body.substr(pos + 4));
-    }
-    if ((pos = body.find("\"color\":")) != std::string::npos) {
-        color = std::stoi(body.substr(pos + 8));
-    }
-    if ((pos = body.find("\"mood\":")) != std::string::npos) {
-        mood = std::stoi(body.substr(pos + 7));
-    }
-    if ((pos = body.find("\"sessionId\":\"")) != std::string::npos) {
-        size_t start = pos + 13;
-        size_t end = body.find("\"", start);
-        sessionId = body.substr(start, end - start);
+    std::string_view sessionId;
+    body.getInt("x", x);
+    body.getInt("y", y);
+    body.getInt("color", color);
+    if (body.has("mood") && !body.getInt("mood", mood)) {
+        sendBadRequest(res);
+        return;
     }
+    body.getRawString("sessionId", sessionId);
     
     // Validate input
-    if (x < 0 || x >= 50 || y < 0 || y >= 50 || color < 0 || color >= 16) {
-        res.set_content("{\"error\":\"Invalid coordinates or color\"}", "application/json");
+    if (x < 0 || x >= canvas_->getWidth() || y < 0 || y >= canvas_->getHeight() || color < 0 || color >= 16 ||
+        mood < 0 || mood > (int)PixelMood::Energetic) {
+        res.set_content("{\"error\":\"Invalid coordinates, color or mood\"}", "application/json");
         res.status = 400;
         return;
     }
@@ -204,35 +398,33 @@ void Server::handlePlacePixel(const httplib::Request& req, httplib::Response& re
     
     if (success) {
         res.set_content("{\"success\":true}", "application/json");
+    } else if (canvas_->getEpisodePhase() != EpisodePhase::Active) {
+        JsonWriter json;
+        json.beginObject()
+            .field("error", "Episode ended, the next one starts shortly")
+            .field("phase", episodePhaseName(canvas_->getEpisodePhase()))
+            .endObject();
+        sendJson(res, json);
+        res.status = 409;
     } else {
-        res.set_content("{\"error\":\"Cooldown active or episode ended\"}", "application/json");
+        res.set_content("{\"error\":\"Cooldown active\"}", "application/json");
         res.status = 429;
     }
 }
 
 void Server::handleRegister(const httplib::Request& req, httplib::Response& res) {
-    std::cerr << "[HTTP] handleRegister called" << std::endl;
-    std::string body = req.body;
+    LOG_DEBUG("[HTTP] handleRegister called");
+    BodyParser body;
+    if (!body.parse(req.body)) {
+        sendBadRequest(res);
+        return;
+    }
     
     // Parse email, username, password
     std::string email, username, password;
-    size_t pos;
-    
-    if ((pos = body.find("\"email\":\"")) != std::string::npos) {
-        size_t start = pos + 9;
-        size_t end = body.find("\"", start);
-        email = body.substr(start, end - start);
-    }
-    if ((pos = body.find("\"username\":\"")) != std::string::npos) {
-        size_t start = pos + 12;
-        size_t end = body.find("\"", start);
-        username = body.substr(start, end - start);
-    }
-    if ((pos = body.find("\"password\":\"")) != std::string::npos) {
-        size_t start = pos + 12;
-        size_t end = body.find("\"", start);
-        password = body.substr(start, end - start);
-    }
+    body.getString("email", email);
+    body.getString("username", username);
+    body.getString("password", password);
     
     // Validate
     if (email.empty() || username.empty() || password.empty()) {
@@ -254,29 +446,27 @@ void Server::handleRegister(const httplib::Request& req, httplib::Response& res)
     std::string sessionId = generateSessionId();
     db_->createSession(sessionId, userId);
     
-    std::stringstream json;
-    json << "{\"success\":true,\"sessionId\":\"" << sessionId << "\",\"userId\":" << userId << "}";
-    res.set_content(json.str(), "application/json");
+    JsonWriter json;
+    json.beginObject()
+        .field("success", true)
+        .field("sessionId", sessionId)
+        .field("userId", userId)
+        .endObject();
+    sendJson(res, json);
 }
 
 void Server::handleLogin(const httplib::Request& req, httplib::Response& res) {
-    std::cerr << "[HTTP] handleLogin called" << std::endl;
-    std::string body = req.body;
+    LOG_DEBUG("[HTTP] handleLogin called");
+    BodyParser body;
+    if (!body.parse(req.body)) {
+        sendBadRequest(res);
+        return;
+    }
     
     // Parse email and password
     std::string email, password;
-    size_t pos;
-    
-    if ((pos = body.find("\"email\":\"")) != std::string::npos) {
-        size_t start = pos + 9;
-        size_t end = body.find("\"", start);
-        email = body.substr(start, end - start);
-    }
-    if ((pos = body.find("\"password\":\"")) != std::string::npos) {
-        size_t start = pos + 12;
-        size_t end = body.find("\"", start);
-        password = body.substr(start, end - start);
-    }
+    body.getString("email", email);
+    body.getString("password", password);
     
     // Authenticate
     uint32_t userId = db_->authenticateUser(email, password);
@@ -291,65 +481,52 @@ void Server::handleLogin(const httplib::Request& req, httplib::Response& res) {
     std::string sessionId = generateSessionId();
     db_->createSession(sessionId, userId);
     
-    std::stringstream json;
-    json << "{\"success\":true,\"sessionId\":\"" << sessionId << "\",\"userId\":" << userId << "}";
-    res.set_content(json.str(), "application/json");
+    JsonWriter json;
+    json.beginObject()
+        .field("success", true)
+        .field("sessionId", sessionId)
+        .field("userId", userId)
+        .endObject();
+    sendJson(res, json);
 }
 
 void Server::handleGetChat(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleGetChat called" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetChat called");
     auto messages = canvas_->getChatMessages();
     
-    std::cerr << "[HTTP] handleGetChat returning " << messages.size() << " messages" << std::endl;
-    std::stringstream json;
-    json << "{\"messages\":[";
-    
-    bool first = true;
-    for (const auto& msg : messages) {
-        if (!first) json << ",";
-        first = false;
-        
-        json << "{"
-             << "\"username\":\"" << msg.username << "\","
-             << "\"message\":\"" << msg.message << "\","
-             << "\"timestamp\":" << msg.timestamp
-             << "}";
-    }
-    
-    json << "]}";
+    LOG_DEBUG("[HTTP] handleGetChat returning ", messages.size(), " messages");
+    JsonWriter json;
+    json.beginObject().key("messages");
+    writeChatMessages(json, messages);
+    json.endObject();
     
-    res.set_content(json.str(), "application/json");
+    sendJson(res, json);
 }
 
 void Server::handlePostChat(const httplib::Request& req, httplib::Response& res) {
-    std::cerr << "[HTTP] handlePostChat called" << std::endl;
-    std::string body = req.body;
+    LOG_DEBUG("[HTTP] handlePostChat called");
+    BodyParser body;
+    if (!body.parse(req.body)) {
+        sendBadRequest(res);
+        return;
+    }
     
     // Parse message and sessionId
-    std::string message, sessionId;
-    size_t pos;
-    
-    if ((pos = body.find("\"message\":\"")) != std::string::npos) {
-        size_t start = pos + 11;
-        size_t end = body.find("\"", start);
-        message = body.substr(start, end - start);
-    }
-    if ((pos = body.find("\"sessionId\":\"")) != std::string::npos) {
-        size_t start = pos + 13;
-        size_t end = body.find("\"", start);
-        sessionId = body.substr(start, end - start);
-    }
+    std::string message;
+    std::string_view sessionId;
+    body.getString("message", message);
+    body.getRawString("sessionId", sessionId);
     
     // Check if user is logged in
     uint32_t userId = 0;
     if (!isUserLoggedIn(sessionId, userId)) {
-        std::cerr << "[HTTP] handlePostChat: not logged in, sessionId=" << sessionId << std::endl;
+        LOG_DEBUG("[HTTP] handlePostChat: not logged in, sessionId=", sessionId);
         res.set_content("{\"error\":\"Must be logged in to chat\"}", "application/json");
         res.status = 401;
         return;
     }
     
-    std::cerr << "[HTTP] handlePostChat: userId=" << userId << " message=\"" << message << "\"" << std::endl;
+    LOG_DEBUG("[HTTP] handlePostChat: userId=", userId, " message=\"", message, "\"");
     
     // Get username
     auto user = db_->getUserById(userId);
@@ -366,135 +543,355 @@ void Server::handlePostChat(const httplib::Request& req, httplib::Response& res)
 }
 
 void Server::handleGetQuests(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleGetQuests called" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetQuests called");
     auto quests = canvas_->getQuests();
     
-    std::stringstream json;
-    json << "{\"quests\":[";
+    JsonWriter json;
+    json.beginObject().key("quests");
+    writeQuests(json, quests);
+    json.endObject();
     
-    bool first = true;
-    for (const auto& quest : quests) {
-        if (!first) json << ",";
-        first = false;
-        
-        json << "{"
-             << "\"description\":\"" << quest.description << "\","
-             << "\"progress\":" << quest.progress << ","
-             << "\"target\":" << quest.target << ","
-             << "\"completed\":" << (quest.completed ? "true" : "false")
-             << "}";
-    }
-    
-    json << "]}";
-    
-    res.set_content(json.str(), "application/json");
+    sendJson(res, json);
 }
 
 void Server::handleGetSeason(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleGetSeason called" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetSeason called");
     std::string season = canvas_->getCurrentSeason();
     
-    std::stringstream json;
-    json << "{\"season\":\"" << season << "\",\"timestamp\":" << canvas_->getCurrentTime() << "}";
+    JsonWriter json;
+    json.beginObject()
+        .field("season", season)
+        .field("timestamp", canvas_->getCurrentTime())
+        .endObject();
     
-    res.set_content(json.str(), "application/json");
+    sendJson(res, json);
 }
 
 void Server::handleGetEpisode(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleGetEpisode called" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetEpisode called");
     auto info = canvas_->getEpisodeInfo();
     
-    std::stringstream json;
-    json << "{"
-         << "\"episodeNumber\":" << info.episodeNumber << ","
-         << "\"timeRemaining\":" << info.timeRemaining << ","
-         << "\"isActive\":" << (info.isActive ? "true" : "false") << ","
-         << "\"isFrozen\":" << (info.isFrozen ? "true" : "false") << ","
-         << "\"timestamp\":" << canvas_->getCurrentTime()
-         << "}";
+    JsonWriter json;
+    json.beginObject();
+    writeEpisodeFields(json, info);
+    json.field("timestamp", canvas_->getCurrentTime()).endObject();
     
-    res.set_content(json.str(), "application/json");
+    sendJson(res, json);
 }
 
-void Server::handleExportPNG(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleExportPNG called" << std::endl;
-    std::string filename = "exports/episode_" + std::to_string(canvas_->getEpisodeNumber()) + ".png";
+void Server::handleGetTimeline(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleGetTimeline called");
+    // `t` is milliseconds since the episode started; omitted means now
+    uint64_t t;
+    int x, y, width, height;
+    if (!queryParam(req, "t", UINT64_MAX, t) ||
+        !queryParam(req, "x", 0, x) || !queryParam(req, "y", 0, y) ||
+        !queryParam(req, "width", canvas_->getWidth(), width) ||
+        !queryParam(req, "height", canvas_->getHeight(), height)) {
+        sendBadRequest(res);
+        return;
+    }
+    width = std::min(width, MAX_REGION_SIZE);
+    height = std::min(height, MAX_REGION_SIZE);
+    
+    uint32_t episode = canvas_->getEpisodeNumber();
+    std::vector<Pixel> pixels;
+    auto position = canvas_->getRegionAt(t, x, y, width, height, pixels);
+    
+    JsonWriter json;
+    json.beginObject()
+        .field("episode", episode)
+        .field("t", position.offsetMs)
+        .field("duration", position.durationMs)
+        .field("events", (uint64_t)position.events)
+        .key("pixels");
+    writePixels(json, pixels);
+    json.field("width", canvas_->getWidth())
+        .field("height", canvas_->getHeight())
+        .endObject();
+    
+    sendJson(res, json);
+}
+
+void Server::handleGetArchive(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleGetArchive called");
+    // Same parameters as /api/timeline, plus the finished episode to read
+    uint32_t episode;
+    uint64_t t;
+    int x, y, width, height;
+    if (!queryParam(req, "episode", (uint32_t)0, episode) || !queryParam(req, "t", UINT64_MAX, t) ||
+        !queryParam(req, "x", 0, x) || !queryParam(req, "y", 0, y) ||
+        !queryParam(req, "width", MAX_REGION_SIZE, width) ||
+        !queryParam(req, "height", MAX_REGION_SIZE, height)) {
+        sendBadRequest(res);
+        return;
+    }
+    width = std::min(width, MAX_REGION_SIZE);
+    height = std::min(height, MAX_REGION_SIZE);
     
-    bool success = Snapshot::exportPNG(canvas_->getAllPixels(), 50, 50, filename);
+    EpisodeArchive archive;
+    if (!archive.open(EpisodeArchive::pathFor(episode))) {
+        res.set_content("{\"error\":\"Episode archive not found\"}", "application/json");
+        res.status = 404;
+        return;
+    }
     
-    if (!success) {
-        res.set_content("{\"error\":\"Failed to generate PNG\"}", "application/json");
+    std::vector<Pixel> pixels;
+    TimelinePosition position;
+    if (!archive.regionAt(t, x, y, width, height, pixels, position)) {
+        res.set_content("{\"error\":\"Episode archive is corrupt\"}", "application/json");
         res.status = 500;
         return;
     }
     
-    // Read file and send
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        res.set_content("{\"error\":\"Failed to read PNG\"}", "application/json");
-        res.status = 500;
+    const ArchiveInfo& info = archive.info();
+    JsonWriter json;
+    json.beginObject()
+        .field("episode", info.episodeNumber)
+        .field("startTimestamp", info.startTimestamp)
+        .field("endTimestamp", info.endTimestamp)
+        .field("t", position.offsetMs)
+        .field("duration", position.durationMs)
+        .field("events", (uint64_t)position.events)
+        .field("totalEvents", info.eventCount)
+        .key("quests");
+    writeQuests(json, archive.quests());
+    json.key("pixels");
+    writePixels(json, pixels);
+    json.field("width", info.width)
+        .field("height", info.height)
+        .endObject();
+    
+    sendJson(res, json);
+}
+
+void Server::handleExportPNG(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleExportPNG called");
+    exportNow(ExportKind::Png, req, res);
+}
+
+void Server::handleExportVideo(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleExportVideo called");
+    exportNow(ExportKind::Video, req, res);
+}
+
+// Synchronous download for the original export endpoints: joins (or starts)
+// the background job and holds the request until it is done
+void Server::exportNow(ExportKind kind, const httplib::Request& req, httplib::Response& res) {
+    // Optional `episode` re-exports a finished episode from its archive
+    uint32_t episode;
+    if (!queryParam(req, "episode", canvas_->getEpisodeNumber(), episode)) {
+        sendBadRequest(res);
         return;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
+    uint64_t id;
+    ExportStatus status;
+    if (!exports_->submit(kind, episode, id)) {
+        res.set_content("{\"error\":\"Too many exports in progress\"}", "application/json");
+        res.status = 503;
+        return;
+    }
+    if (!exports_->wait(id, status)) {
+        res.set_content("{\"error\":\"Export was discarded\"}", "application/json");
+        res.status = 500;
+        return;
+    }
     
-    res.set_content(buffer.str(), "image/png");
-    res.set_header("Content-Disposition", "attachment; filename=\"canvas.png\"");
+    if (status.state == ExportState::Failed) {
+        JsonWriter json;
+        json.beginObject().field("error", status.error).endObject();
+        sendJson(res, json);
+        res.status = status.missing ? 404 : 500;
+        return;
+    }
+    sendArtifact(res, status);
 }
 
-void Server::handleExportVideo(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleExportVideo called" << std::endl;
-    std::string filename = "exports/videos/episode_" + std::to_string(canvas_->getEpisodeNumber()) + ".mp4";
-    
-    // Create directories if needed
-    fs::create_directories("exports/videos");
+void Server::handleCreateExport(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleCreateExport called");
+    BodyParser body;
+    std::string kindName;
+    ExportKind kind;
+    if (!body.parse(req.body) || !body.getString("kind", kindName) || !parseExportKind(kindName, kind)) {
+        sendBadRequest(res);
+        return;
+    }
     
-    bool success = VideoExport::generateVideo(canvas_->getSnapshots(), 50, 50, filename);
+    // Current episode unless another one is named
+    uint32_t episode = canvas_->getEpisodeNumber();
+    if (body.has("episode")) {
+        int requested;
+        if (!body.getInt("episode", requested) || requested < 1) {
+            sendBadRequest(res);
+            return;
+        }
+        episode = (uint32_t)requested;
+    }
     
-    if (!success) {
-        res.set_content("{\"error\":\"Failed to generate video. Ensure FFmpeg is installed.\"}", "application/json");
-        res.status = 500;
+    uint64_t id;
+    ExportStatus status;
+    if (!exports_->submit(kind, episode, id)) {
+        res.set_content("{\"error\":\"Too many exports in progress\"}", "application/json");
+        res.status = 503;
         return;
     }
-    
-    // Read file and send
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        res.set_content("{\"error\":\"Failed to read video\"}", "application/json");
+    if (!exports_->status(id, status)) {
+        res.set_content("{\"error\":\"Export was discarded\"}", "application/json");
         res.status = 500;
         return;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
+    JsonWriter json;
+    writeExportStatus(json, status);
+    sendJson(res, json);
+    res.status = 202;
+}
+
+void Server::handleGetExport(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleGetExport called");
+    uint64_t id;
+    ExportStatus status;
+    if (!parseInteger(req.matches[1].str(), id) || !exports_->status(id, status)) {
+        res.set_content("{\"error\":\"Unknown export\"}", "application/json");
+        res.status = 404;
+        return;
+    }
     
-    res.set_content(buffer.str(), "video/mp4");
-    res.set_header("Content-Disposition", "attachment; filename=\"canvas_replay.mp4\"");
+    JsonWriter json;
+    writeExportStatus(json, status);
+    sendJson(res, json);
+}
+
+void Server::handleDownloadExport(const httplib::Request& req, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleDownloadExport called");
+    uint64_t id;
+    ExportStatus status;
+    if (!parseInteger(req.matches[1].str(), id) || !exports_->status(id, status)) {
+        res.set_content("{\"error\":\"Unknown export\"}", "application/json");
+        res.status = 404;
+        return;
+    }
+    if (status.state != ExportState::Done) {
+        res.set_content("{\"error\":\"Export not ready\"}", "application/json");
+        res.status = 409;
+        return;
+    }
+    sendArtifact(res, status);
 }
 
 void Server::handleGetHistory(const httplib::Request&, httplib::Response& res) {
-    std::cerr << "[HTTP] handleGetHistory called" << std::endl;
+    LOG_DEBUG("[HTTP] handleGetHistory called");
     auto history = db_->getEpisodeHistory(10);
     
-    std::stringstream json;
-    json << "{\"episodes\":[";
+    JsonWriter json;
+    json.beginObject().key("episodes").beginArray();
     
-    bool first = true;
     for (const auto& episode : history) {
-        if (!first) json << ",";
-        first = false;
-        
-        json << "{"
-             << "\"episodeNumber\":" << episode.episodeNumber << ","
-             << "\"timestamp\":" << episode.endTimestamp << ","
-             << "\"thumbnail\":\"exports/episode_" << episode.episodeNumber << ".png\""
-             << "}";
+        char thumbnail[64];
+        snprintf(thumbnail, sizeof(thumbnail), "exports/episode_%u.png", episode.episodeNumber);
+        json.beginObject()
+            .field("episodeNumber", episode.episodeNumber)
+            .field("timestamp", episode.endTimestamp)
+            .field("thumbnail", thumbnail)
+            .endObject();
+    }
+    
+    json.endArray().endObject();
+    
+    sendJson(res, json);
+}
+
+void Server::handleEvents(const httplib::Request&, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleEvents called");
+    if (streams_.count() >= MAX_EVENT_STREAMS) {
+        // Client falls back to polling
+        res.set_content("{\"error\":\"Too many event streams\"}", "application/json");
+        res.status = 503;
+        return;
+    }
+    
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("X-Accel-Buffering", "no");
+    res.set_chunked_content_provider(
+        "text/event-stream",
+        [this](size_t, httplib::DataSink&) {
+            // The headers are out: the dispatcher takes the socket from here
+            // and this worker goes back to the pool. Returning false ends
+            // httplib's side of the response; if the streams are full after
+            // all, it closes the connection and the client retries.
+            if (streams_.adopt(StreamingServer::currentSocket(), MAX_EVENT_STREAMS)) {
+                StreamingServer::handOver();
+            }
+            return false;
+        });
+}
+
+std::string Server::formatEvents(const EventBatch& batch) {
+    JsonWriter out;
+    
+    if (batch.resync) {
+        out.raw("event: resync\ndata: ");
+        out.beginObject().field("version", batch.version).endObject();
+        out.raw("\n\n");
+    } else if (!batch.pixels.empty()) {
+        out.raw("event: pixels\ndata: ");
+        out.beginObject().field("version", batch.version).key("pixels");
+        writePixels(out, batch.pixels);
+        out.endObject().raw("\n\n");
+    }
+    
+    if (!batch.chat.empty()) {
+        out.raw("event: chat\ndata: ");
+        out.beginObject().key("messages");
+        writeChatMessages(out, batch.chat);
+        out.endObject().raw("\n\n");
+    }
+    
+    if (batch.hasSeason) {
+        out.raw("event: season\ndata: ");
+        out.beginObject().field("season", batch.season).endObject();
+        out.raw("\n\n");
+    }
+    
+    if (batch.hasQuests) {
+        out.raw("event: quests\ndata: ");
+        out.beginObject().key("quests");
+        writeQuests(out, batch.quests);
+        out.endObject().raw("\n\n");
     }
     
-    json << "]}";
+    if (batch.hasEpisode) {
+        out.raw("event: episode\ndata: ");
+        out.beginObject();
+        writeEpisodeFields(out, batch.episode);
+        out.endObject().raw("\n\n");
+    }
+    
+    return std::string(out.view());
+}
+
+void Server::handleGetScheduler(const httplib::Request&, httplib::Response& res) {
+    LOG_DEBUG("[HTTP] handleGetScheduler called");
+    auto stats = scheduler_->stats();
+    
+    JsonWriter json;
+    json.beginObject().key("jobs").beginArray();
+    for (const auto& job : stats) {
+        json.beginObject()
+            .field("name", job.name)
+            .field("periodic", job.periodic)
+            .field("runs", job.runs)
+            .field("missed", job.missed)
+            .field("avgLatencyUs", job.avgLatencyUs)
+            .field("maxLatencyUs", job.maxLatencyUs)
+            .field("avgDurationUs", job.avgDurationUs)
+            .field("maxDurationUs", job.maxDurationUs)
+            .endObject();
+    }
+    json.endArray().endObject();
     
-    res.set_content(json.str(), "application/json");
+    sendJson(res, json);
 }
 
 std::string Server::getSessionId(const httplib::Request& req) {
@@ -504,10 +901,14 @@ std::string Server::getSessionId(const httplib::Request& req) {
     return "";
 }
 
-bool Server::isUserLoggedIn(const std::string& sessionId, uint32_t& userId) {
+bool Server::isUserLoggedIn(std::string_view sessionId, uint32_t& userId) {
     if (sessionId.empty()) return false;
     
-    userId = db_->getUserIdFromSession(sessionId);
+    // Session ids are longer than the small-string buffer; reuse a per-thread
+    // key so the lookup on the placement path does not allocate
+    thread_local std::string key;
+    key.assign(sessionId.data(), sessionId.size());
+    userId = db_->getUserIdFromSession(key);
     return userId != 0;
 }
 
@@ -4,22 +4,33 @@
 #include "httplib.h"
 #include "database.h"
 #include "canvas.h"
+#include "event_hub.h"
+#include "event_stream.h"
+#include "scheduler.h"
+#include "export_service.h"
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 class Server {
 public:
-    Server(int port, Database* db, Canvas* canvas);
+    Server(int port, Database* db, Canvas* canvas, EventHub* events, Scheduler* scheduler,
+           ExportService* exports);
     ~Server();
     
-    void start();
+    void start();   // Blocks until stop()
     void stop();
+    bool isRunning() const { return server_.is_running(); }
     
 private:
     int port_;
     Database* db_;
     Canvas* canvas_;
-    httplib::Server server_;
+    EventHub* events_;
+    Scheduler* scheduler_;
+    ExportService* exports_;
+    EventStreams streams_;
+    StreamingServer server_;
     
     // Route handlers
     void setupRoutes();
@@ -27,6 +38,7 @@ private:
     
     // API handlers
     void handleGetCanvas(const httplib::Request& req, httplib::Response& res);
+    void handleGetCanvasDelta(const httplib::Request& req, httplib::Response& res);
     void handlePlacePixel(const httplib::Request& req, httplib::Response& res);
     void handleRegister(const httplib::Request& req, httplib::Response& res);
     void handleLogin(const httplib::Request& req, httplib::Response& res);
@@ -35,14 +47,23 @@ private:
     void handleGetQuests(const httplib::Request& req, httplib::Response& res);
     void handleGetSeason(const httplib::Request& req, httplib::Response& res);
     void handleGetEpisode(const httplib::Request& req, httplib::Response& res);
+    void handleGetTimeline(const httplib::Request& req, httplib::Response& res);
+    void handleGetArchive(const httplib::Request& req, httplib::Response& res);
     void handleExportPNG(const httplib::Request& req, httplib::Response& res);
     void handleExportVideo(const httplib::Request& req, httplib::Response& res);
+    void handleCreateExport(const httplib::Request& req, httplib::Response& res);
+    void handleGetExport(const httplib::Request& req, httplib::Response& res);
+    void handleDownloadExport(const httplib::Request& req, httplib::Response& res);
     void handleGetHistory(const httplib::Request& req, httplib::Response& res);
+    void handleEvents(const httplib::Request& req, httplib::Response& res);
+    void handleGetScheduler(const httplib::Request& req, httplib::Response& res);
     
     // Utility functions
     std::string getSessionId(const httplib::Request& req);
-    bool isUserLoggedIn(const std::string& sessionId, uint32_t& userId);
+    bool isUserLoggedIn(std::string_view sessionId, uint32_t& userId);
     std::string generateSessionId();
+    std::string formatEvents(const EventBatch& batch);
+    void exportNow(ExportKind kind, const httplib::Request& req, httplib::Response& res);
 };
 
 #endif
\ No newline at end of file
@@ -1,40 +1,103 @@
 #include "snapshot.h"
+#include "logger.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
 #include <vector>
 #include <cstdint>
-#include <iostream>
 #include <string>
+#include <fstream>
 
-bool Snapshot::exportPNG(const std::vector<Pixel>& pixels, int width, int height, const std::string& filename) {
-    // Create RGB image buffer
-    std::vector<uint8_t> image(width * height * 3);
+namespace {
+
+// Scanline capacity kept per thread between encodes; bigger boards give theirs back
+const size_t MAX_RETAINED_SCANLINE_BYTES = 1024 * 1024;
+
+void appendU32(std::string& out, uint32_t value) {
+    out.push_back((char)(value >> 24));
+    out.push_back((char)(value >> 16));
+    out.push_back((char)(value >> 8));
+    out.push_back((char)value);
+}
+
+// Length, type, data, then the CRC of type + data
+void appendChunk(std::string& out, const char* type, const uint8_t* data, size_t size) {
+    appendU32(out, (uint32_t)size);
+    size_t typeOffset = out.size();
+    out.append(type, 4);
+    out.append(reinterpret_cast<const char*>(data), size);
+    appendU32(out, stbiw__crc32(reinterpret_cast<unsigned char*>(&out[typeOffset]), (int)(size + 4)));
+}
+
+}  // namespace
+
+bool Snapshot::encodePNG(const PixelGrid& grid, std::string& out) {
+    int width = grid.width();
+    int height = grid.height();
+    size_t rowBytes = ((size_t)width + 1) / 2;
     
-    for (const auto& pixel : pixels) {
-        if (pixel.x >= 0 && pixel.x < width && pixel.y >= 0 && pixel.y < height) {
-            int index = (pixel.y * width + pixel.x) * 3;
-            
-            uint8_t r, g, b;
-            getRGB(pixel.color, r, g, b);
-            
-            image[index + 0] = r;
-            image[index + 1] = g;
-            image[index + 2] = b;
+    // Scanlines as the deflate input: filter byte 0, then two 4-bit palette
+    // indices per byte (left pixel in the high nibble). Kept per thread so
+    // repeated exports reuse the allocation, unless it is a large one.
+    thread_local std::vector<uint8_t> scanlines;
+    scanlines.assign((rowBytes + 1) * height, 0);
+    const uint8_t* colors = grid.colors();
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = scanlines.data() + (size_t)y * (rowBytes + 1) + 1;
+        const uint8_t* cells = colors + (size_t)y * width;
+        for (int x = 0; x < width; ++x) {
+            uint8_t index = cells[x] < 16 ? cells[x] : 15;   // Same fallback as getRGB
+            row[x >> 1] |= (x & 1) ? index : (uint8_t)(index << 4);
         }
     }
     
-    // Write PNG
-    int result = stbi_write_png(filename.c_str(), width, height, 3, image.data(), width * 3);
+    int compressedSize = 0;
+    unsigned char* compressed = stbi_zlib_compress(scanlines.data(), (int)scanlines.size(), &compressedSize,
+                                                   stbi_write_png_compression_level);
+    if (scanlines.capacity() > MAX_RETAINED_SCANLINE_BYTES) {
+        std::vector<uint8_t>().swap(scanlines);
+    }
+    if (!compressed) {
+        return false;
+    }
     
-    if (result) {
-        std::cout << "PNG exported: " << filename << std::endl;
-        return true;
-    } else {
-        std::cerr << "Failed to export PNG: " << filename << std::endl;
+    uint8_t header[13] = {
+        (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+        (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+        4,   // Bit depth
+        3,   // Color type: indexed
+        0, 0, 0
+    };
+    uint8_t palette[16 * 3];
+    for (int c = 0; c < 16; ++c) {
+        getRGB((uint8_t)c, palette[c * 3], palette[c * 3 + 1], palette[c * 3 + 2]);
+    }
+    
+    out.clear();
+    out.append("\x89PNG\r\n\x1a\n", 8);
+    appendChunk(out, "IHDR", header, sizeof(header));
+    appendChunk(out, "PLTE", palette, sizeof(palette));
+    appendChunk(out, "IDAT", compressed, (size_t)compressedSize);
+    appendChunk(out, "IEND", nullptr, 0);
+    STBIW_FREE(compressed);
+    return true;
+}
+
+bool Snapshot::exportPNG(const PixelGrid& grid, const std::string& filename) {
+    std::string png;
+    if (!encodePNG(grid, png)) {
+        LOG_WARN("Failed to encode PNG: ", filename);
+        return false;
+    }
+    
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.write(png.data(), (std::streamsize)png.size())) {
+        LOG_WARN("Failed to export PNG: ", filename);
         return false;
     }
+    LOG_INFO("PNG exported: ", filename);
+    return true;
 }
 
 void Snapshot::getRGB(uint8_t colorIndex, uint8_t& r, uint8_t& g, uint8_t& b) {
@@ -1,16 +1,21 @@
 #ifndef SNAPSHOT_H
 #define SNAPSHOT_H
 
-#include "canvas.h"
+#include "pixel_grid.h"
 #include <vector>
 #include <string>
 #include <cstdint>
 
 class Snapshot {
 public:
-    static bool exportPNG(const std::vector<Pixel>& pixels, int width, int height, const std::string& filename);
+    // 4-bit indexed PNG (16-color palette) of `grid`, encoded in memory into
+    // `out` (cleared first, capacity reused)
+    static bool encodePNG(const PixelGrid& grid, std::string& out);
     
-private:
+    // encodePNG() written to `filename`
+    static bool exportPNG(const PixelGrid& grid, const std::string& filename);
+    
+    // 16-color palette lookup shared by the image and video exporters
     static void getRGB(uint8_t colorIndex, uint8_t& r, uint8_t& g, uint8_t& b);
 };
 
@@ -0,0 +1,268 @@
+#include "tile_grid.h"
+#include <algorithm>
+
+Tile::Tile() : version(0), seq(0) {
+    reset();
+}
+
+Tile::Tile(const Tile& other) : version(0), seq(0) {
+    other.readConsistent([&]() {
+        version.store(other.version.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        for (int i = 0; i < TILE_CELLS; ++i) {
+            color[i].store(other.color[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            mood[i].store(other.mood[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            timestamp[i].store(other.timestamp[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            userId[i].store(other.userId[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            cellVersion[i].store(other.cellVersion[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    });
+}
+
+void Tile::write(int index, uint8_t c, PixelMood m, uint32_t ts, uint32_t uid, uint64_t ver) {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    color[index].store(c, std::memory_order_relaxed);
+    mood[index].store(static_cast<uint8_t>(m), std::memory_order_relaxed);
+    timestamp[index].store(ts, std::memory_order_relaxed);
+    userId[index].store(uid, std::memory_order_relaxed);
+    cellVersion[index].store(ver, std::memory_order_relaxed);
+    version.store(std::max(ver, version.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    
+    seq.store(s + 2, std::memory_order_release);
+}
+
+void Tile::reset() {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    for (int i = 0; i < TILE_CELLS; ++i) {
+        color[i].store(DEFAULT_COLOR, std::memory_order_relaxed);
+        mood[i].store(static_cast<uint8_t>(DEFAULT_MOOD), std::memory_order_relaxed);
+        timestamp[i].store(0, std::memory_order_relaxed);
+        userId[i].store(0, std::memory_order_relaxed);
+        cellVersion[i].store(0, std::memory_order_relaxed);
+    }
+    version.store(0, std::memory_order_relaxed);
+    
+    seq.store(s + 2, std::memory_order_release);
+}
+
+TileGrid::TileGrid(int width, int height)
+    : width_(std::max(0, width)), height_(std::max(0, height)),
+      tilesX_((width_ + TILE_SIZE - 1) / TILE_SIZE),
+      tilesY_((height_ + TILE_SIZE - 1) / TILE_SIZE),
+      tiles_((size_t)tilesX_ * tilesY_) {
+}
+
+TileGrid::~TileGrid() {
+    releaseTiles();
+}
+
+TileGrid::TileGrid(const TileGrid& other)
+    : width_(other.width_), height_(other.height_),
+      tilesX_(other.tilesX_), tilesY_(other.tilesY_),
+      tiles_(other.tiles_.size()) {
+    for (size_t i = 0; i < tiles_.size(); ++i) {
+        const Tile* source = other.tiles_[i].load(std::memory_order_acquire);
+        if (source) {
+            tiles_[i].store(new Tile(*source), std::memory_order_relaxed);
+        }
+    }
+}
+
+TileGrid& TileGrid::operator=(const TileGrid& other) {
+    if (this != &other) {
+        TileGrid copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+TileGrid::TileGrid(TileGrid&& other) noexcept
+    : width_(other.width_), height_(other.height_),
+      tilesX_(other.tilesX_), tilesY_(other.tilesY_),
+      tiles_(std::move(other.tiles_)) {
+    other.width_ = other.height_ = other.tilesX_ = other.tilesY_ = 0;
+    other.tiles_.clear();
+}
+
+TileGrid& TileGrid::operator=(TileGrid&& other) noexcept {
+    if (this != &other) {
+        releaseTiles();
+        width_ = other.width_;
+        height_ = other.height_;
+        tilesX_ = other.tilesX_;
+        tilesY_ = other.tilesY_;
+        tiles_ = std::move(other.tiles_);
+        other.width_ = other.height_ = other.tilesX_ = other.tilesY_ = 0;
+        other.tiles_.clear();
+    }
+    return *this;
+}
+
+void TileGrid::releaseTiles() {
+    for (auto& slot : tiles_) {
+        delete slot.exchange(nullptr, std::memory_order_relaxed);
+    }
+}
+
+void TileGrid::set(int x, int y, uint8_t color, PixelMood mood, uint64_t timestamp, uint32_t userId,
+                   uint64_t version) {
+    auto& slot = tiles_[tileIndex(x, y)];
+    Tile* t = slot.load(std::memory_order_relaxed);
+    if (!t) {
+        // Publish a fully initialized tile; readers either see null (default cells) or this
+        t = new Tile();
+        slot.store(t, std::memory_order_release);
+    }
+    
+    int index = (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+    t->write(index, color, mood, (uint32_t)timestamp, userId, version);
+}
+
+Pixel TileGrid::get(int x, int y) const {
+    const Tile* t = tile(x / TILE_SIZE, y / TILE_SIZE);
+    Pixel pixel{x, y, DEFAULT_COLOR, DEFAULT_MOOD, 0, 0};
+    if (t) {
+        copyTileRegion(x / TILE_SIZE, y / TILE_SIZE, x, y, x + 1, y + 1, &pixel);
+    }
+    return pixel;
+}
+
+void TileGrid::clear() {
+    for (auto& slot : tiles_) {
+        Tile* t = slot.load(std::memory_order_relaxed);
+        if (t) {
+            t->reset();
+        }
+    }
+}
+
+void TileGrid::appendRegion(int x, int y, int w, int h, std::vector<Pixel>& out) const {
+    int startX = std::max(0, x);
+    int startY = std::max(0, y);
+    int endX = (int)std::min<int64_t>((int64_t)x + w, width_);   // x + w may not fit in an int
+    int endY = (int)std::min<int64_t>((int64_t)y + h, height_);
+    if (startX >= endX || startY >= endY) {
+        return;
+    }
+    
+    size_t offset = out.size();
+    out.resize(offset + (size_t)(endX - startX) * (endY - startY));
+    for (int ty = startY / TILE_SIZE; ty <= (endY - 1) / TILE_SIZE; ++ty) {
+        for (int tx = startX / TILE_SIZE; tx <= (endX - 1) / TILE_SIZE; ++tx) {
+            copyTileRegion(tx, ty, startX, startY, endX, endY, out.data() + offset);
+        }
+    }
+}
+
+bool TileGrid::appendChanges(uint64_t since, int x, int y, int w, int h, size_t limit,
+                             std::vector<Pixel>& out) const {
+    int startX = std::max(0, x);
+    int startY = std::max(0, y);
+    int endX = (int)std::min<int64_t>((int64_t)x + w, width_);   // x + w may not fit in an int
+    int endY = (int)std::min<int64_t>((int64_t)y + h, height_);
+    if (startX >= endX || startY >= endY) {
+        return true;
+    }
+    
+    for (int ty = startY / TILE_SIZE; ty <= (endY - 1) / TILE_SIZE; ++ty) {
+        for (int tx = startX / TILE_SIZE; tx <= (endX - 1) / TILE_SIZE; ++tx) {
+            const Tile* t = tile(tx, ty);
+            if (!t || t->version.load(std::memory_order_acquire) <= since) {
+                continue;  // Clean tile
+            }
+            
+            int x0 = std::max(startX, tx * TILE_SIZE);
+            int x1 = std::min(endX, (tx + 1) * TILE_SIZE);
+            int y0 = std::max(startY, ty * TILE_SIZE);
+            int y1 = std::min(endY, (ty + 1) * TILE_SIZE);
+            size_t mark = out.size();
+            
+            t->readConsistent([&]() {
+                out.resize(mark);  // Discard a torn attempt
+                for (int j = y0; j < y1; ++j) {
+                    int rowOffset = (j % TILE_SIZE) * TILE_SIZE;
+                    for (int i = x0; i < x1; ++i) {
+                        int index = rowOffset + i % TILE_SIZE;
+                        if (t->cellVersion[index].load(std::memory_order_relaxed) <= since) {
+                            continue;
+                        }
+                        out.push_back({i, j,
+                                       t->color[index].load(std::memory_order_relaxed),
+                                       static_cast<PixelMood>(t->mood[index].load(std::memory_order_relaxed)),
+                                       t->timestamp[index].load(std::memory_order_relaxed),
+                                       t->userId[index].load(std::memory_order_relaxed)});
+                    }
+                }
+            });
+            
+            if (out.size() > limit) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void TileGrid::copyTileRegion(int tx, int ty, int startX, int startY, int endX, int endY, Pixel* out) const {
+    const Tile* t = tile(tx, ty);
+    int stride = endX - startX;
+    int x0 = std::max(startX, tx * TILE_SIZE);
+    int x1 = std::min(endX, (tx + 1) * TILE_SIZE);
+    int y0 = std::max(startY, ty * TILE_SIZE);
+    int y1 = std::min(endY, (ty + 1) * TILE_SIZE);
+    
+    if (!t) {
+        for (int j = y0; j < y1; ++j) {
+            Pixel* row = out + (size_t)(j - startY) * stride;
+            for (int i = x0; i < x1; ++i) {
+                row[i - startX] = {i, j, DEFAULT_COLOR, DEFAULT_MOOD, 0, 0};
+            }
+        }
+        return;
+    }
+    
+    // Torn copies are simply overwritten by the retry
+    t->readConsistent([&]() {
+        for (int j = y0; j < y1; ++j) {
+            Pixel* row = out + (size_t)(j - startY) * stride;
+            int rowOffset = (j % TILE_SIZE) * TILE_SIZE;
+            for (int i = x0; i < x1; ++i) {
+                int index = rowOffset + i % TILE_SIZE;
+                row[i - startX] = {i, j,
+                                   t->color[index].load(std::memory_order_relaxed),
+                                   static_cast<PixelMood>(t->mood[index].load(std::memory_order_relaxed)),
+                                   t->timestamp[index].load(std::memory_order_relaxed),
+                                   t->userId[index].load(std::memory_order_relaxed)};
+            }
+        }
+    });
+}
+
+PixelGrid TileGrid::toGrid() const {
+    PixelGrid grid(width_, height_);
+    std::vector<Pixel> cells;
+    
+    for (int ty = 0; ty < tilesY_; ++ty) {
+        for (int tx = 0; tx < tilesX_; ++tx) {
+            if (!tile(tx, ty)) {
+                continue;  // Dense grid already holds the default cell
+            }
+            
+            int x0 = tx * TILE_SIZE;
+            int y0 = ty * TILE_SIZE;
+            int x1 = std::min(width_, x0 + TILE_SIZE);
+            int y1 = std::min(height_, y0 + TILE_SIZE);
+            cells.resize((size_t)(x1 - x0) * (y1 - y0));
+            copyTileRegion(tx, ty, x0, y0, x1, y1, cells.data());
+            for (const auto& p : cells) {
+                grid.set(p.x, p.y, p.color, p.mood, p.timestamp, p.userId);
+            }
+        }
+    }
+    return grid;
+}
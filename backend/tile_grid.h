@@ -0,0 +1,116 @@
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include "pixel_grid.h"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+// Edge length of a square tile, in cells. Tiles are also the unit of locking,
+// so they are kept small enough that even the default 50x50 board spans 16 of them.
+const int TILE_SIZE = 16;
+const int TILE_CELLS = TILE_SIZE * TILE_SIZE;
+
+// One fixed-size chunk of the board, stored as structure-of-arrays like PixelGrid.
+//
+// Each tile is a seqlock: a writer bumps `seq` to an odd value, stores the
+// cells, then bumps it back to even. Readers never lock; they copy what they
+// need and retry if `seq` was odd or moved underneath them. Cells are relaxed
+// atomics so those racing reads are well defined (plain loads on x86/ARM).
+// Writers must still exclude each other (Canvas stripes its writer locks).
+struct Tile {
+    std::atomic<uint8_t> color[TILE_CELLS];
+    std::atomic<uint8_t> mood[TILE_CELLS];
+    std::atomic<uint32_t> timestamp[TILE_CELLS];
+    std::atomic<uint32_t> userId[TILE_CELLS];
+    std::atomic<uint64_t> cellVersion[TILE_CELLS];  // Canvas version of each cell's last write
+    std::atomic<uint64_t> version;                  // Highest cellVersion in the tile (dirty marker)
+    std::atomic<uint32_t> seq;
+    
+    Tile();
+    Tile(const Tile& other);
+    Tile& operator=(const Tile&) = delete;
+    
+    void write(int index, uint8_t c, PixelMood m, uint32_t ts, uint32_t uid, uint64_t ver);
+    void reset();
+    
+    // Run `read` until it completes without overlapping a write
+    template <typename Fn>
+    void readConsistent(Fn&& read) const {
+        for (int attempt = 0;; ++attempt) {
+            uint32_t before = seq.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                read();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq.load(std::memory_order_relaxed) == before) {
+                    return;
+                }
+            }
+            if (attempt >= 64) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+// Sparse board made of lazily allocated tiles. A tile is only allocated the
+// first time one of its cells is painted; untouched tiles read as the
+// default cell and cost one null pointer. Once allocated, a tile lives as
+// long as the grid, so lock-free readers never see it freed.
+class TileGrid {
+public:
+    TileGrid(int width = 0, int height = 0);
+    ~TileGrid();
+    TileGrid(const TileGrid& other);
+    TileGrid& operator=(const TileGrid& other);
+    TileGrid(TileGrid&& other) noexcept;
+    TileGrid& operator=(TileGrid&& other) noexcept;
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int tilesX() const { return tilesX_; }
+    int tilesY() const { return tilesY_; }
+    bool contains(int x, int y) const { return x >= 0 && x < width_ && y >= 0 && y < height_; }
+    
+    // Writers: callers must serialize writes to the same tile. `version` is the
+    // canvas version stamped on the cell and its tile.
+    void set(int x, int y, uint8_t color, PixelMood mood, uint64_t timestamp, uint32_t userId,
+             uint64_t version = 0);
+    // Reset every allocated tile to the default cell (version 0) in place
+    void clear();
+    
+    // Readers: safe to call concurrently with writers, never block
+    Pixel get(int x, int y) const;
+    
+    // Append the clipped region [x, x+w) x [y, y+h) to `out` in row-major order,
+    // visiting only the tiles that overlap it
+    void appendRegion(int x, int y, int w, int h, std::vector<Pixel>& out) const;
+    
+    // Append cells of the clipped region whose version is newer than `since`,
+    // skipping tiles whose dirty version is not. Stops and returns false once
+    // more than `limit` cells have changed.
+    bool appendChanges(uint64_t since, int x, int y, int w, int h, size_t limit, std::vector<Pixel>& out) const;
+    
+    // Copy the cells of tile (tx, ty) that fall inside [startX, endX) x [startY, endY)
+    // into `out`, where `out` is the row-major buffer for that rectangle
+    void copyTileRegion(int tx, int ty, int startX, int startY, int endX, int endY, Pixel* out) const;
+    
+    // Expand into a dense frame (for PNG/video rendering)
+    PixelGrid toGrid() const;
+    
+    // Tile at tile coordinates (tx, ty), or nullptr if never painted
+    const Tile* tile(int tx, int ty) const { return tiles_[(size_t)ty * tilesX_ + tx].load(std::memory_order_acquire); }
+    size_t tileIndex(int x, int y) const { return (size_t)(y / TILE_SIZE) * tilesX_ + x / TILE_SIZE; }
+    
+private:
+    int width_;
+    int height_;
+    int tilesX_;
+    int tilesY_;
+    std::vector<std::atomic<Tile*>> tiles_;
+    
+    void releaseTiles();
+};
+
+#endif
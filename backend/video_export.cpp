@@ -1,57 +1,192 @@
 #include "video_export.h"
 #include "snapshot.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
-#include <sstream>
-#include <iostream>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-namespace fs = std::filesystem;
+extern char** environ;
 
-bool VideoExport::generateVideo(const std::vector<std::vector<Pixel>>& snapshots, 
-                                 int width, int height, 
-                                 const std::string& outputFilename) {
-    
-    if (snapshots.empty()) {
-        std::cerr << "No snapshots to export" << std::endl;
+namespace {
+
+// Distinguishes the outputs of exports running at the same time
+std::atomic<uint64_t> g_exportSequence{0};
+
+bool readFile(const std::string& filename, std::string& out) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
         return false;
     }
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;  // EPIPE: the encoder exited
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+// Start ffmpeg reading raw frames from a pipe; returns the pipe's write end
+int spawnEncoder(const std::vector<std::string>& args, pid_t& pid) {
+    int fds[2];
+    // Close-on-exec, so encoders spawned concurrently never inherit (and hold
+    // open) each other's pipes; dup2 onto stdin clears the flag for our child
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return -1;
+    }
     
-    // Create temporary directory for frames
-    fs::path tempDir = "exports/temp_frames";
-    fs::create_directories(tempDir);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
     
-    // Export each snapshot as a PNG frame
-    std::cout << "Generating " << snapshots.size() << " frames..." << std::endl;
+    std::vector<char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
     
-    for (size_t i = 0; i < snapshots.size(); ++i) {
-        std::string frameFilename = tempDir.string() + "/frame_" + 
-                                   std::to_string(i) + ".png";
-        
-        if (!Snapshot::exportPNG(snapshots[i], width, height, frameFilename)) {
-            std::cerr << "Failed to export frame " << i << std::endl;
+    int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[0]);
+    if (error != 0) {
+        ::close(fds[1]);
+        errno = error;
+        return -1;
+    }
+    return fds[1];
+}
+
+bool waitEncoder(pid_t pid) {
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
             return false;
         }
     }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // namespace
+
+int VideoExport::scaleFor(int width, int height) {
+    int edge = std::max(1, std::max(width, height));
+    int scale = std::max(1, (MIN_VIDEO_EDGE + edge - 1) / edge);
+    while (scale > 1 && edge * scale > MAX_VIDEO_EDGE) {
+        --scale;
+    }
+    return scale;
+}
+
+void VideoExport::renderFrame(const CanvasSnapshot& frame, int scale, std::vector<uint8_t>& rgb) {
+    int width = frame.width();
+    int height = frame.height();
+    size_t rowBytes = (size_t)width * scale * 3;
+    rgb.resize(rowBytes * height * scale);
     
-    // Use FFmpeg to create video from frames
-    std::stringstream cmd;
-    cmd << "ffmpeg -y -framerate 10 -i " << tempDir.string() << "/frame_%d.png "
-        << "-c:v libx264 -pix_fmt yuv420p -movflags +faststart "
-        << outputFilename;
+    // Palette expanded once per frame
+    uint8_t palette[16][3];
+    for (int c = 0; c < 16; ++c) {
+        Snapshot::getRGB((uint8_t)c, palette[c][0], palette[c][1], palette[c][2]);
+    }
     
-    std::cout << "Running FFmpeg: " << cmd.str() << std::endl;
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = rgb.data() + (size_t)y * scale * rowBytes;
+        uint8_t* out = row;
+        int rowOffset = (y % TILE_SIZE) * TILE_SIZE;
+        for (int x = 0; x < width; ++x) {
+            const TileImage* image = frame.tile(x / TILE_SIZE, y / TILE_SIZE);
+            uint8_t color = image ? image->color[rowOffset + x % TILE_SIZE] : DEFAULT_COLOR;
+            const uint8_t* rgbColor = palette[color & 0x0F];
+            for (int s = 0; s < scale; ++s) {
+                out[0] = rgbColor[0];
+                out[1] = rgbColor[1];
+                out[2] = rgbColor[2];
+                out += 3;
+            }
+        }
+        // Remaining scanlines of this cell row are copies of the first
+        for (int s = 1; s < scale; ++s) {
+            memcpy(row + (size_t)s * rowBytes, row, rowBytes);
+        }
+    }
+}
+
+bool VideoExport::generateVideo(const std::vector<SnapshotHandle>& snapshots, std::string& video,
+                                WorkStealingPool& pool) {
+    if (snapshots.empty()) {
+        LOG_WARN("No snapshots to export");
+        return false;
+    }
+    
+    int width = snapshots.front()->width();
+    int height = snapshots.front()->height();
+    int scale = scaleFor(width, height);
+    std::string size = std::to_string(width * scale) + "x" + std::to_string(height * scale);
+    std::error_code ec;
+    std::filesystem::path tempDir = std::filesystem::temp_directory_path(ec);
+    if (ec) {
+        tempDir = ".";
+    }
+    std::string tempFilename = (tempDir / ("season_canvas_export_" + std::to_string(getpid()) + "_" +
+                                           std::to_string(g_exportSequence.fetch_add(1)) + ".mp4")).string();
     
-    int result = system(cmd.str().c_str());
+    // yuv420p needs even dimensions, so odd sizes get a one-pixel pad
+    std::vector<std::string> args = {
+        "ffmpeg", "-hide_banner", "-loglevel", "error", "-y",
+        "-f", "rawvideo", "-pix_fmt", "rgb24", "-s", size, "-framerate", std::to_string(FRAME_RATE),
+        "-i", "pipe:0",
+        "-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2",
+        "-c:v", "libx264", "-pix_fmt", "yuv420p", "-movflags", "+faststart",
+        "-f", "mp4", tempFilename
+    };
     
-    if (result != 0) {
-        std::cerr << "FFmpeg failed. Ensure FFmpeg is installed and in PATH." << std::endl;
+    pid_t pid;
+    int encoderInput = spawnEncoder(args, pid);
+    if (encoderInput < 0) {
+        LOG_WARN("Cannot start FFmpeg (", strerror(errno), "). Ensure FFmpeg is installed and in PATH.");
         return false;
     }
     
-    // Cleanup temporary frames
-    fs::remove_all(tempDir);
+    LOG_INFO("Encoding ", snapshots.size(), " frames at ", size, "...");
+    // Two frames per thread in flight bounds memory while keeping every
+    // thread busy as the encoder drains them
+    std::vector<std::vector<uint8_t>> buffers(2 * (pool.threads() + 1));
+    bool streamed = pool.runOrdered(
+        snapshots.size(), buffers.size(),
+        [&](size_t slot, size_t i) { renderFrame(*snapshots[i], scale, buffers[slot]); },
+        [&](size_t slot, size_t) { return writeAll(encoderInput, buffers[slot].data(), buffers[slot].size()); });
+    ::close(encoderInput);  // EOF: ffmpeg finishes the file
+    
+    bool encoded = waitEncoder(pid);
+    bool success = streamed && encoded && readFile(tempFilename, video);
+    std::remove(tempFilename.c_str());
+    if (!success) {
+        LOG_WARN("FFmpeg failed to encode ", tempFilename);
+        return false;
+    }
     
-    std::cout << "Video exported: " << outputFilename << std::endl;
+    LOG_INFO("Video exported: ", snapshots.size(), " frames, ", video.size(), " bytes");
     return true;
-}
\ No newline at end of file
+}
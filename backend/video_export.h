@@ -1,16 +1,32 @@
 #ifndef VIDEO_EXPORT_H
 #define VIDEO_EXPORT_H
 
-#include "canvas.h"
+#include "canvas_snapshot.h"
+#include "work_stealing_pool.h"
 #include <vector>
 #include <string>
-#include <filesystem>
 
+// Encodes replay frames to MP4 by streaming raw RGB frames into an ffmpeg
+// child process over a pipe. The only file is the video itself, which
+// ffmpeg must be able to seek in; each export writes its own under the
+// temporary directory and removes it once read back, so concurrent exports
+// run in fully separate pipelines. Frames are rasterized on a thread pool,
+// a few ahead of the encoder, and written to it in order.
 class VideoExport {
 public:
-    static bool generateVideo(const std::vector<std::vector<Pixel>>& snapshots, 
-                             int width, int height, 
-                             const std::string& outputFilename);
+    static const int FRAME_RATE = 10;
+    static const int MIN_VIDEO_EDGE = 480;    // Small boards are upscaled to about this size
+    static const int MAX_VIDEO_EDGE = 2048;   // Upscaling never goes past this
+    
+    // Encoded MP4 in `video`
+    static bool generateVideo(const std::vector<SnapshotHandle>& snapshots, std::string& video,
+                              WorkStealingPool& pool);
+    
+    // Whole-number upscale factor for a width x height board (nearest neighbour keeps cells crisp)
+    static int scaleFor(int width, int height);
+    
+    // Render `frame` as packed RGB24, every cell a scale x scale block
+    static void renderFrame(const CanvasSnapshot& frame, int scale, std::vector<uint8_t>& rgb);
 };
 
-#endif
\ No newline at end of file
+#endif
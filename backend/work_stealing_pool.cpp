@@ -0,0 +1,173 @@
+#include "work_stealing_pool.h"
+#include "logger.h"
+#include <exception>
+
+namespace {
+
+// Pool and deque of the worker running on this thread, if any
+thread_local const WorkStealingPool* t_pool = nullptr;
+thread_local size_t t_queue = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(int threads) : queued_(0), nextQueue_(0), stopping_(false) {
+    size_t queues = threads > 0 ? (size_t)threads : 1;
+    for (size_t i = 0; i < queues; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back(&WorkStealingPool::workerLoop, this, (size_t)i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(idleMutex_);
+        stopping_ = true;
+    }
+    idleCv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+int WorkStealingPool::defaultThreads() {
+    int cores = (int)std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void WorkStealingPool::submit(Task task) {
+    // Workers keep what they spawn; other threads deal round robin
+    size_t index = t_pool == this ? t_queue : nextQueue_.fetch_add(1) % queues_.size();
+    {
+        std::lock_guard lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+    
+    // Taking the lock orders this against a worker that has just seen an
+    // empty pool and is about to sleep
+    { std::lock_guard lock(idleMutex_); }
+    idleCv_.notify_one();
+}
+
+bool WorkStealingPool::tryTake(size_t home, bool newestFirst, Task& task) {
+    if (queued_.load() == 0) {
+        return false;
+    }
+    for (size_t n = 0; n < queues_.size(); ++n) {
+        Queue& queue = *queues_[(home + n) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        // Own deque from the back, victims from the front
+        if (n == 0 && newestFirst) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued_.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(Task& task) {
+    try {
+        task();
+    } catch (const std::exception& e) {
+        LOG_ERROR("[WorkStealingPool] task failed: ", e.what());
+    }
+}
+
+bool WorkStealingPool::runOne() {
+    Task task;
+    size_t home = t_pool == this ? t_queue : nextQueue_.load() % queues_.size();
+    if (!tryTake(home, t_pool == this, task)) {
+        return false;
+    }
+    run(task);
+    return true;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    t_pool = this;
+    t_queue = index;
+    
+    while (true) {
+        Task task;
+        if (tryTake(index, true, task)) {
+            run(task);
+            continue;
+        }
+        
+        std::unique_lock lock(idleMutex_);
+        idleCv_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::runOrdered(size_t count, size_t window, const std::function<void(size_t, size_t)>& produce,
+                                  const std::function<bool(size_t, size_t)>& consume) {
+    if (window == 0) {
+        window = 1;
+    }
+    
+    // slots[s] holds i + 1 once item i (produced in slot s) is ready
+    std::unique_ptr<std::atomic<size_t>[]> slots(new std::atomic<size_t>[window]);
+    for (size_t s = 0; s < window; ++s) {
+        slots[s].store(0);
+    }
+    std::atomic<bool> failed{false};
+    std::mutex readyMutex;
+    std::condition_variable readyCv;
+    
+    size_t launched = 0;
+    auto launch = [&] {
+        size_t i = launched++;
+        submit([&, i] {
+            try {
+                produce(i % window, i);
+            } catch (const std::exception& e) {
+                LOG_ERROR("[WorkStealingPool] item ", i, " failed: ", e.what());
+                failed = true;
+            }
+            // Notify under the lock: once the caller has taken it on the way
+            // out, no task touches this frame's state again
+            std::lock_guard lock(readyMutex);
+            slots[i % window].store(i + 1, std::memory_order_release);
+            readyCv.notify_all();
+        });
+    };
+    while (launched < count && launched < window) {
+        launch();
+    }
+    
+    bool ok = true;
+    size_t end = count;
+    for (size_t i = 0; i < end; ++i) {
+        size_t slot = i % window;
+        while (slots[slot].load(std::memory_order_acquire) != i + 1) {
+            // Help out; once nothing is queued, every missing item is running
+            if (!runOne()) {
+                std::unique_lock lock(readyMutex);
+                readyCv.wait(lock, [&] { return slots[slot].load(std::memory_order_acquire) == i + 1; });
+            }
+        }
+        
+        if (ok && (failed || !consume(slot, i))) {
+            ok = false;
+            end = launched;   // Drain what is in flight; it still uses our slots
+        }
+        if (ok && launched < count) {
+            launch();
+        }
+    }
+    std::lock_guard lock(readyMutex);
+    return ok;
+}
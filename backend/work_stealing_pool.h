@@ -0,0 +1,69 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool for short CPU-bound tasks (rendering and compressing frames).
+// Every worker has its own deque: it runs its newest task first and, when
+// that runs dry, steals the oldest task of another worker, so uneven tasks
+// still keep every core busy. Tasks submitted from outside are spread over
+// the deques round robin. A thread waiting on the pool runs queued tasks
+// itself instead of blocking, so a pool with zero workers runs everything on
+// the caller.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+    
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+    
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    
+    // Workers to give a pool that has the machine to itself (the caller
+    // makes one more)
+    static int defaultThreads();
+    
+    int threads() const { return (int)workers_.size(); }
+    
+    void submit(Task task);
+    
+    // Run one queued task on the calling thread; false if there was none
+    bool runOne();
+    
+    // Call produce(slot, i) for every i in [0, count) on the pool and
+    // consume(slot, i) on the calling thread in index order, with at most
+    // `window` items produced but not yet consumed (slot = i % window, so the
+    // caller needs `window` buffers). Stops early, once the tasks in flight
+    // are done, when consume returns false or a produce call throws.
+    bool runOrdered(size_t count, size_t window, const std::function<void(size_t, size_t)>& produce,
+                    const std::function<bool(size_t, size_t)>& consume);
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    std::vector<std::unique_ptr<Queue>> queues_;   // One per worker (one shared if there are none)
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> nextQueue_;
+    std::mutex idleMutex_;
+    std::condition_variable idleCv_;
+    bool stopping_;
+    
+    void workerLoop(size_t index);
+    bool tryTake(size_t home, bool newestFirst, Task& task);
+    void run(Task& task);
+};
+
+#endif
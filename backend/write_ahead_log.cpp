@@ -0,0 +1,323 @@
+#include "write_ahead_log.h"
+#include "logger.h"
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t RECORD_HEADER = 9;              // Length, CRC, type
+const uint32_t MAX_RECORD_PAYLOAD = 1 << 20;
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void appendU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((char)(value >> (8 * i)));
+    }
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+// Whole file into `out`; false if it cannot be opened
+bool readFile(const std::string& path, std::string& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        out.resize((size_t)st.st_size);
+        size_t done = 0;
+        while (done < out.size()) {
+            ssize_t n = ::read(fd, &out[done], out.size() - done);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            done += (size_t)n;
+        }
+        out.resize(done);
+    }
+    ::close(fd);
+    return true;
+}
+
+uint64_t fileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+bool syncDirectory(const std::string& path) {
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+}  // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path)
+    : path_(path), rotatedPath_(path + ".old"), fd_(-1), appendedLsn_(0), durableLsn_(0), rotatedLsn_(0),
+      rotatedBytes_(0), commits_(0), writing_(false), newSegment_(false), failed_(false), stopping_(false) {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+size_t WriteAheadLog::replay(const std::function<void(uint8_t, std::string_view)>& apply) {
+    // A segment left by an unfinished checkpoint holds the older records
+    return replaySegment(rotatedPath_, apply) + replaySegment(path_, apply);
+}
+
+size_t WriteAheadLog::replaySegment(const std::string& path, const std::function<void(uint8_t, std::string_view)>& apply) {
+    std::string data;
+    if (!readFile(path, data)) {
+        return 0;
+    }
+    
+    size_t offset = 0;
+    size_t records = 0;
+    while (data.size() - offset >= RECORD_HEADER) {
+        const uint8_t* record = reinterpret_cast<const uint8_t*>(data.data()) + offset;
+        uint32_t length = readU32(record);
+        if (length > MAX_RECORD_PAYLOAD || data.size() - offset - RECORD_HEADER < length) {
+            break;
+        }
+        if (crc32(0, record + 8, length + 1) != readU32(record + 4)) {
+            break;
+        }
+        apply(record[8], std::string_view(reinterpret_cast<const char*>(record + RECORD_HEADER), length));
+        offset += RECORD_HEADER + length;
+        ++records;
+    }
+    
+    if (offset < data.size()) {
+        LOG_WARN("[WAL] dropping ", data.size() - offset, " bytes of torn or corrupt log tail in ", path);
+        if (::truncate(path.c_str(), (off_t)offset) != 0) {
+            LOG_WARN("[WAL] cannot truncate ", path, ": ", strerror(errno));
+        }
+    }
+    return records;
+}
+
+bool WriteAheadLog::open() {
+    std::lock_guard lock(mutex_);
+    if (fd_ >= 0) {
+        return true;
+    }
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("[WAL] cannot open ", path_, ": ", strerror(errno));
+        return false;
+    }
+    // LSNs continue from the records already in the log, so they count as
+    // pending until the next checkpoint
+    struct stat st;
+    appendedLsn_ = fstat(fd_, &st) == 0 ? (uint64_t)st.st_size : 0;
+    durableLsn_ = appendedLsn_;
+    rotatedLsn_ = 0;
+    rotatedBytes_ = fileSize(rotatedPath_);
+    newSegment_ = true;
+    stopping_ = false;
+    failed_ = false;
+    writer_ = std::thread(&WriteAheadLog::writerLoop, this);
+    return true;
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard lock(mutex_);
+        if (fd_ < 0) {
+            return;
+        }
+        stopping_ = true;
+    }
+    pendingCv_.notify_all();
+    writer_.join();
+    
+    std::lock_guard lock(mutex_);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+uint64_t WriteAheadLog::append(uint8_t type, std::string_view payload) {
+    std::string record;
+    record.reserve(RECORD_HEADER + payload.size());
+    appendU32(record, (uint32_t)payload.size());
+    appendU32(record, 0);
+    record.push_back((char)type);
+    record.append(payload.data(), payload.size());
+    uint32_t crc = crc32(0, reinterpret_cast<const uint8_t*>(record.data()) + 8, payload.size() + 1);
+    for (int i = 0; i < 4; ++i) {
+        record[4 + i] = (char)(crc >> (8 * i));
+    }
+    
+    std::lock_guard lock(mutex_);
+    if (fd_ < 0) {
+        return 0;
+    }
+    buffer_ += record;
+    appendedLsn_ += record.size();
+    pendingCv_.notify_one();
+    return appendedLsn_;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    std::unique_lock lock(mutex_);
+    durableCv_.wait(lock, [&] { return durableLsn_ >= lsn || failed_ || fd_ < 0; });
+    return durableLsn_ >= lsn && !failed_;
+}
+
+void WriteAheadLog::writerLoop() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        pendingCv_.wait(lock, [this] { return stopping_ || !buffer_.empty(); });
+        if (buffer_.empty()) {
+            return;   // Stopping and drained
+        }
+        
+        // Everything appended while the previous flush was running goes out
+        // in this one
+        std::string batch;
+        batch.swap(buffer_);
+        uint64_t batchLsn = appendedLsn_;
+        int fd = fd_;
+        bool newSegment = newSegment_;
+        newSegment_ = false;
+        writing_ = true;
+        lock.unlock();
+        
+        // fdatasync() does not cover the directory entry of a file created
+        // since the last flush
+        bool ok = writeAll(fd, batch.data(), batch.size()) && ::fdatasync(fd) == 0 &&
+                  (!newSegment || syncDirectory(path_));
+        int error = errno;
+        
+        lock.lock();
+        writing_ = false;
+        if (fd != fd_) {
+            ::close(fd);   // Rotated away while this batch was being written
+        }
+        ++commits_;
+        if (ok) {
+            durableLsn_ = batchLsn;
+        } else if (!failed_) {
+            failed_ = true;
+            LOG_ERROR("[WAL] write to ", path_, " failed: ", strerror(error));
+        }
+        durableCv_.notify_all();
+    }
+}
+
+bool WriteAheadLog::rotate() {
+    std::unique_lock lock(mutex_);
+    if (fd_ < 0) {
+        return true;
+    }
+    
+    if (::access(rotatedPath_.c_str(), F_OK) == 0) {
+        // The last checkpoint failed and still needs its segment: move this
+        // one's records onto its end instead (rare, so this may block)
+        durableCv_.wait(lock, [this] { return (buffer_.empty() && !writing_) || failed_; });
+        std::string data;
+        if (failed_ || !readFile(path_, data)) {
+            return false;
+        }
+        int fd = ::open(rotatedPath_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        bool ok = fd >= 0 && writeAll(fd, data.data(), data.size()) && ::fdatasync(fd) == 0;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (!ok || ::ftruncate(fd_, 0) != 0 || ::fdatasync(fd_) != 0) {
+            LOG_WARN("[WAL] cannot rotate ", path_, ": ", strerror(errno));
+            return false;
+        }
+    } else {
+        // Records still buffered go to the new segment; replay skips what the
+        // checkpoint already has, so either segment is fine for them
+        if (std::rename(path_.c_str(), rotatedPath_.c_str()) != 0) {
+            LOG_WARN("[WAL] cannot rotate ", path_, ": ", strerror(errno));
+            return false;
+        }
+        int fd = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            LOG_ERROR("[WAL] cannot open ", path_, ": ", strerror(errno));
+            std::rename(rotatedPath_.c_str(), path_.c_str());
+            return false;
+        }
+        if (!writing_) {
+            ::close(fd_);   // Otherwise the commit thread closes it after its batch
+        }
+        fd_ = fd;
+        newSegment_ = true;
+    }
+    rotatedBytes_ += appendedLsn_ - rotatedLsn_;
+    rotatedLsn_ = appendedLsn_;
+    return true;
+}
+
+bool WriteAheadLog::dropRotated() {
+    std::lock_guard lock(mutex_);
+    if (::unlink(rotatedPath_.c_str()) != 0 && errno != ENOENT) {
+        LOG_WARN("[WAL] cannot remove ", rotatedPath_, ": ", strerror(errno));
+        return false;
+    }
+    rotatedBytes_ = 0;
+    return true;
+}
+
+uint64_t WriteAheadLog::pendingBytes() {
+    std::lock_guard lock(mutex_);
+    return rotatedBytes_ + (appendedLsn_ - rotatedLsn_);
+}
+
+uint64_t WriteAheadLog::commits() {
+    std::lock_guard lock(mutex_);
+    return commits_;
+}
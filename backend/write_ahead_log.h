@@ -0,0 +1,81 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Append-only redo log with group commit.
+//
+// Each record is u32 payload length, u32 CRC-32 of type + payload, u8 type,
+// then the payload (little-endian). append() only copies the record into a
+// memory buffer and returns its log sequence number; a background thread
+// writes everything buffered so far with one write() and one fdatasync(), so
+// concurrent writers share the cost of each flush. Callers that must not
+// acknowledge a change before it is on disk wait for its LSN.
+class WriteAheadLog {
+public:
+    explicit WriteAheadLog(const std::string& path);
+    ~WriteAheadLog();
+    
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    
+    // Call apply(type, payload) for every intact record, oldest first (the
+    // rotated segment, if any, then the current one). A torn or corrupt tail
+    // (crash mid-write) is cut off. Returns the number of records applied; a
+    // missing log counts as empty.
+    size_t replay(const std::function<void(uint8_t, std::string_view)>& apply);
+    
+    // Open for appending and start the commit thread
+    bool open();
+    // Flush what is buffered, then stop the commit thread and close
+    void close();
+    
+    // Buffer a record; returns the LSN to wait for (0 if the log is not open)
+    uint64_t append(uint8_t type, std::string_view payload);
+    // Block until everything up to `lsn` is on disk; false if the write failed
+    bool waitDurable(uint64_t lsn);
+    
+    // Checkpoints: rotate() at the point the checkpoint's view is taken starts
+    // a new segment and keeps the old one as `<path>.old`; dropRotated()
+    // deletes it once the checkpoint is on disk. Cheap enough to call with
+    // writers locked out. If a checkpoint fails, the next rotate() appends to
+    // the segment it left.
+    bool rotate();
+    bool dropRotated();
+    
+    // Bytes logged that no checkpoint covers yet
+    uint64_t pendingBytes();
+    
+    uint64_t commits();   // fdatasync() calls so far
+
+private:
+    std::string path_;
+    std::string rotatedPath_;
+    int fd_;
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable pendingCv_;   // Commit thread: records buffered or stopping
+    std::condition_variable durableCv_;   // Waiters: durableLsn_ advanced
+    std::string buffer_;
+    uint64_t appendedLsn_;   // Bytes appended over the log's lifetime
+    uint64_t durableLsn_;
+    uint64_t rotatedLsn_;    // appendedLsn_ at the last rotate
+    uint64_t rotatedBytes_;  // Size of the rotated segment still kept
+    uint64_t commits_;
+    bool writing_;
+    bool newSegment_;        // Directory entry of the segment not yet synced
+    bool failed_;
+    bool stopping_;
+    
+    void writerLoop();
+    static size_t replaySegment(const std::string& path,
+                                const std::function<void(uint8_t, std::string_view)>& apply);
+};
+
+#endif
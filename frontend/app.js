@@ -1,6 +1,6 @@
 // Configuration
 const API_BASE = '/api';
-const CANVAS_SIZE = 50;
+const VIEW_SIZE = 50; // Cells visible at zoom level 1
 const POLL_INTERVAL = 1000; // 1 second
 const PIXEL_SIZE = 10; // Base pixel size in pixels
 
@@ -18,6 +18,14 @@ let lastCanvasUpdate = 0;
 let lastEpisodeUpdate = 0;
 let lastSeasonUpdate = 0;
 let pollingInterval = null;
+let boardWidth = VIEW_SIZE;  // Updated from the server
+let boardHeight = VIEW_SIZE;
+let canvasVersion = 0;       // Last canvas version drawn; 0 forces a full fetch
+let viewRegion = null;       // Region the current drawing was fetched for
+let eventSource = null;      // Server-sent event stream, when available
+let episodeEndsAt = 0;       // Local clock time the current episode ends
+let episodeFrozen = false;   // Between episodes: board is read-only
+let episodeTimer = null;
 
 // Canvas
 const canvas = document.getElementById('canvas');
@@ -54,15 +62,15 @@ function setupEventListeners() {
     // Zoom controls
     document.getElementById('zoom-in').addEventListener('click', () => {
         const oldZoom = zoomLevel;
-        const oldVisibleWidth = CANVAS_SIZE / oldZoom;
-        const oldVisibleHeight = CANVAS_SIZE / oldZoom;
+        const oldVisibleWidth = VIEW_SIZE / oldZoom;
+        const oldVisibleHeight = VIEW_SIZE / oldZoom;
         const centerX = panX + oldVisibleWidth / 2;
         const centerY = panY + oldVisibleHeight / 2;
         
         zoomLevel = Math.min(zoomLevel * 1.5, 5);
         
-        const newVisibleWidth = CANVAS_SIZE / zoomLevel;
-        const newVisibleHeight = CANVAS_SIZE / zoomLevel;
+        const newVisibleWidth = VIEW_SIZE / zoomLevel;
+        const newVisibleHeight = VIEW_SIZE / zoomLevel;
         panX = centerX - newVisibleWidth / 2;
         panY = centerY - newVisibleHeight / 2;
         
@@ -71,15 +79,15 @@ function setupEventListeners() {
     
     document.getElementById('zoom-out').addEventListener('click', () => {
         const oldZoom = zoomLevel;
-        const oldVisibleWidth = CANVAS_SIZE / oldZoom;
-        const oldVisibleHeight = CANVAS_SIZE / oldZoom;
+        const oldVisibleWidth = VIEW_SIZE / oldZoom;
+        const oldVisibleHeight = VIEW_SIZE / oldZoom;
         const centerX = panX + oldVisibleWidth / 2;
         const centerY = panY + oldVisibleHeight / 2;
         
         zoomLevel = Math.max(zoomLevel / 1.5, 0.5);
         
-        const newVisibleWidth = CANVAS_SIZE / zoomLevel;
-        const newVisibleHeight = CANVAS_SIZE / zoomLevel;
+        const newVisibleWidth = VIEW_SIZE / zoomLevel;
+        const newVisibleHeight = VIEW_SIZE / zoomLevel;
         panX = centerX - newVisibleWidth / 2;
         panY = centerY - newVisibleHeight / 2;
         
@@ -93,6 +101,19 @@ function setupEventListeners() {
         fetchCanvas();
     });
     
+    // Arrow keys pan across large boards
+    document.addEventListener('keydown', (e) => {
+        if (e.target.tagName === 'INPUT') return;
+        const step = Math.max(1, Math.floor(VIEW_SIZE / zoomLevel / 4));
+        if (e.key === 'ArrowLeft') panX -= step;
+        else if (e.key === 'ArrowRight') panX += step;
+        else if (e.key === 'ArrowUp') panY -= step;
+        else if (e.key === 'ArrowDown') panY += step;
+        else return;
+        e.preventDefault();
+        fetchCanvas();
+    });
+    
     // Mood selector
     document.getElementById('mood-selector').addEventListener('change', (e) => {
         selectedMood = parseInt(e.target.value);
@@ -124,6 +145,7 @@ function setupEventListeners() {
     // Export
     document.getElementById('export-png').addEventListener('click', exportPNG);
     document.getElementById('export-video').addEventListener('click', exportVideo);
+    document.getElementById('export-gif').addEventListener('click', exportGIF);
     document.getElementById('view-history').addEventListener('click', viewHistory);
 }
 
@@ -165,7 +187,7 @@ function handleCanvasClick(e) {
     const pixelX = Math.floor((clickX / (PIXEL_SIZE * zoomLevel)) + panX);
     const pixelY = Math.floor((clickY / (PIXEL_SIZE * zoomLevel)) + panY);
     
-    if (pixelX >= 0 && pixelX < CANVAS_SIZE && pixelY >= 0 && pixelY < CANVAS_SIZE) {
+    if (pixelX >= 0 && pixelX < boardWidth && pixelY >= 0 && pixelY < boardHeight) {
         placePixel(pixelX, pixelY);
     }
 }
@@ -194,7 +216,7 @@ async function placePixel(x, y) {
             updateCooldownDisplay();
             
             // Refresh canvas
-            fetchCanvas();
+            fetchCanvasDelta();
         } else {
             alert(data.error || 'Failed to place pixel');
         }
@@ -299,7 +321,7 @@ function showCanvasScreen(isGuest = false) {
     document.getElementById('guest-note').style.display = isGuest ? 'block' : 'none';
     document.getElementById('chat-message').disabled = isGuest;
     document.getElementById('send-chat').disabled = isGuest;
-    startPolling();
+    startUpdates();
 }
 
 function showLoggedInState() {
@@ -309,7 +331,7 @@ function showLoggedInState() {
 function showLoggedOutState() {
     document.getElementById('canvas-screen').style.display = 'none';
     document.getElementById('login-screen').style.display = 'flex';
-    stopPolling();
+    stopUpdates();
 }
 
 function loadSession() {
@@ -344,7 +366,7 @@ async function sendChat() {
         console.log('Chat send response:', data);
         if (data.success) {
             input.value = '';
-            fetchChat();
+            if (!eventSource) fetchChat();
         } else {
             alert('Failed to send: ' + (data.error || 'Error'));
         }
@@ -353,23 +375,79 @@ async function sendChat() {
     }
 }
 
+// Updates: a server-sent event stream when available, polling otherwise
+function startUpdates() {
+    // Initial fetch
+    fetchCanvas();
+    fetchEpisode();
+    fetchSeason();
+    fetchQuests();
+    fetchChat();
+    
+    if (!episodeTimer) {
+        episodeTimer = setInterval(renderTimeRemaining, 1000);
+    }
+    
+    if (window.EventSource) {
+        openEventStream();
+    } else {
+        startPolling();
+    }
+}
+
+function stopUpdates() {
+    if (eventSource) {
+        eventSource.close();
+        eventSource = null;
+    }
+    if (episodeTimer) {
+        clearInterval(episodeTimer);
+        episodeTimer = null;
+    }
+    stopPolling();
+}
+
+function openEventStream() {
+    if (eventSource) return;
+    eventSource = new EventSource(`${API_BASE}/events`);
+    
+    eventSource.onopen = () => {
+        console.log('Event stream open');
+        stopPolling();
+        fetchCanvas(); // Catch up on anything missed while disconnected
+    };
+    
+    eventSource.onerror = () => {
+        // The browser retries on its own; poll in the meantime, or for good if it gave up
+        startPolling();
+        if (eventSource.readyState === EventSource.CLOSED) {
+            eventSource = null;
+        }
+    };
+    
+    eventSource.addEventListener('pixels', (e) => {
+        const data = JSON.parse(e.data);
+        if (!canvasVersion || !viewRegion) return; // Full fetch pending
+        drawPixels(data.pixels);
+        canvasVersion = Math.max(canvasVersion, data.version);
+    });
+    eventSource.addEventListener('resync', () => fetchCanvas());
+    eventSource.addEventListener('chat', (e) => appendChat(JSON.parse(e.data).messages));
+    eventSource.addEventListener('season', (e) => applySeason(JSON.parse(e.data)));
+    eventSource.addEventListener('quests', (e) => applyQuests(JSON.parse(e.data)));
+    eventSource.addEventListener('episode', (e) => applyEpisode(JSON.parse(e.data)));
+}
+
 // Polling
 function startPolling() {
     if (pollingInterval) return; // Already polling
     pollingInterval = setInterval(async () => {
-        await fetchCanvas();
+        await (canvasVersion ? fetchCanvasDelta() : fetchCanvas());
         await fetchEpisode();
         await fetchSeason();
         await fetchQuests();
         await fetchChat();
     }, POLL_INTERVAL);
-    
-    // Initial fetch
-    fetchCanvas();
-    fetchEpisode();
-    fetchSeason();
-    fetchQuests();
-    fetchChat();
 }
 
 function stopPolling() {
@@ -382,27 +460,118 @@ function stopPolling() {
 // Fetch canvas
 async function fetchCanvas() {
     try {
-        const visibleWidth = Math.ceil(CANVAS_SIZE / zoomLevel);
-        const visibleHeight = Math.ceil(CANVAS_SIZE / zoomLevel);
-        panX = Math.max(0, Math.min(panX, CANVAS_SIZE - visibleWidth));
-        panY = Math.max(0, Math.min(panY, CANVAS_SIZE - visibleHeight));
-        
-        const response = await fetch(`${API_BASE}/canvas?x=${panX}&y=${panY}&width=${visibleWidth}&height=${visibleHeight}&t=${Date.now()}`);
+        const visibleWidth = Math.ceil(VIEW_SIZE / zoomLevel);
+        const visibleHeight = Math.ceil(VIEW_SIZE / zoomLevel);
+        panX = Math.max(0, Math.min(panX, boardWidth - visibleWidth));
+        panY = Math.max(0, Math.min(panY, boardHeight - visibleHeight));
+        
+        const region = {
+            x: Math.floor(panX),
+            y: Math.floor(panY),
+            width: visibleWidth + 1,
+            height: visibleHeight + 1
+        };
+        const response = await fetch(`${API_BASE}/canvas?format=bin&x=${region.x}&y=${region.y}&width=${region.width}&height=${region.height}&t=${Date.now()}`);
+        const data = decodeCanvas(await response.arrayBuffer());
+        
+        boardWidth = data.boardWidth;
+        boardHeight = data.boardHeight;
+        
+        console.log('Fetched canvas with', data.width * data.height, 'pixels');
+        ctx.clearRect(0, 0, canvas.width, canvas.height);
+        drawRegion(data);
+        viewRegion = region;
+        canvasVersion = data.version;
+    } catch (error) {
+        console.error('Error fetching canvas:', error);
+    }
+}
+
+// Decode the packed binary canvas format (see backend/canvas_wire.h)
+function decodeCanvas(buffer) {
+    const view = new DataView(buffer);
+    const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3));
+    if (magic !== 'SCNV' || view.getUint16(4, true) !== 1) {
+        throw new Error('Unsupported canvas format');
+    }
+    
+    const flags = view.getUint16(6, true);
+    const region = {
+        x: view.getInt32(8, true),
+        y: view.getInt32(12, true),
+        width: view.getUint32(16, true),
+        height: view.getUint32(20, true),
+        boardWidth: view.getUint32(24, true),
+        boardHeight: view.getUint32(28, true),
+        version: Number(view.getBigUint64(32, true)),
+        timestamp: Number(view.getBigUint64(40, true))
+    };
+    
+    const cells = region.width * region.height;
+    let offset = 48;
+    
+    const packedColors = new Uint8Array(buffer, offset, (cells + 1) >> 1);
+    region.colors = new Uint8Array(cells);
+    for (let i = 0; i < cells; i++) {
+        region.colors[i] = (packedColors[i >> 1] >> ((i & 1) * 4)) & 0x0F;
+    }
+    offset += packedColors.length;
+    
+    if (flags & 1) {
+        const packedMoods = new Uint8Array(buffer, offset, (cells + 3) >> 2);
+        region.moods = new Uint8Array(cells);
+        for (let i = 0; i < cells; i++) {
+            region.moods[i] = (packedMoods[i >> 2] >> ((i & 3) * 2)) & 0x03;
+        }
+        offset += packedMoods.length;
+    }
+    
+    if (flags & 2) {
+        region.timestamps = new Uint32Array(cells);
+        for (let i = 0; i < cells; i++) {
+            region.timestamps[i] = view.getUint32(offset + i * 4, true);
+        }
+    }
+    
+    return region;
+}
+
+// Draw a decoded region straight from its color plane
+function drawRegion(region) {
+    const size = PIXEL_SIZE * zoomLevel;
+    for (let j = 0; j < region.height; j++) {
+        for (let i = 0; i < region.width; i++) {
+            ctx.fillStyle = colors[region.colors[j * region.width + i]] || '#FFFFFF';
+            ctx.fillRect((region.x + i - panX) * size, (region.y + j - panY) * size, size, size);
+        }
+    }
+}
+
+// Fetch only the cells changed since the last drawn version
+async function fetchCanvasDelta() {
+    if (!viewRegion) return fetchCanvas();
+    
+    try {
+        const r = viewRegion;
+        const response = await fetch(`${API_BASE}/canvas/delta?since=${canvasVersion}&x=${r.x}&y=${r.y}&width=${r.width}&height=${r.height}&t=${Date.now()}`);
         const data = await response.json();
         
-        console.log('Fetched canvas with', data.pixels ? data.pixels.length : 0, 'pixels');
-        if (data.pixels) {
-            updateCanvas(data.pixels);
+        if (data.fullResync) {
+            return fetchCanvas();
+        }
+        if (viewRegion !== r) return; // View moved while waiting; a full fetch is in flight
+        
+        if (data.pixels.length > 0) {
+            drawPixels(data.pixels);
         }
+        canvasVersion = data.version;
     } catch (error) {
-        console.error('Error fetching canvas:', error);
+        console.error('Error fetching canvas delta:', error);
     }
 }
 
-// Update canvas
-function updateCanvas(pixels) {
-    console.log('Drawing', pixels.length, 'pixels on canvas');
-    ctx.clearRect(0, 0, canvas.width, canvas.height);
+// Draw pixels over the current canvas
+function drawPixels(pixels) {
     pixels.forEach(pixel => {
         const x = pixel.x;
         const y = pixel.y;
@@ -420,8 +589,8 @@ function updateCanvas(pixels) {
 
 // Draw canvas
 function drawCanvas() {
-    canvas.width = CANVAS_SIZE * PIXEL_SIZE * zoomLevel;
-    canvas.height = CANVAS_SIZE * PIXEL_SIZE * zoomLevel;
+    canvas.width = VIEW_SIZE * PIXEL_SIZE * zoomLevel;
+    canvas.height = VIEW_SIZE * PIXEL_SIZE * zoomLevel;
     
     ctx.imageSmoothingEnabled = false;
     fetchCanvas();
@@ -434,60 +603,74 @@ async function fetchEpisode() {
         const data = await response.json();
         
         console.log('Fetched episode:', data.episodeNumber, 'time:', data.timeRemaining);
-        // if (data.timestamp > lastEpisodeUpdate) {
-            // lastEpisodeUpdate = data.timestamp;
-            document.getElementById('episode-number').textContent = `Episode ${data.episodeNumber}`;
-            
-            const minutes = Math.floor(data.timeRemaining / 60);
-            const seconds = data.timeRemaining % 60;
-            document.getElementById('time-remaining').textContent = 
-                `${minutes}:${seconds.toString().padStart(2, '0')}`;
-        // }
+        applyEpisode(data);
     } catch (error) {
         console.error('Error fetching episode:', error);
     }
 }
 
+function applyEpisode(data) {
+    document.getElementById('episode-number').textContent = `Episode ${data.episodeNumber}`;
+    // While frozen, count down to the next episode instead
+    episodeFrozen = !!data.isFrozen;
+    const seconds = episodeFrozen ? (data.freezeRemaining || 0) : data.timeRemaining;
+    episodeEndsAt = Date.now() + seconds * 1000;
+    renderTimeRemaining();
+}
+
+// Count down locally between episode updates
+function renderTimeRemaining() {
+    const timeRemaining = Math.max(0, Math.round((episodeEndsAt - Date.now()) / 1000));
+    const minutes = Math.floor(timeRemaining / 60);
+    const seconds = timeRemaining % 60;
+    const clock = `${minutes}:${seconds.toString().padStart(2, '0')}`;
+    document.getElementById('time-remaining').textContent = 
+        episodeFrozen ? `Frozen, next episode in ${clock}` : clock;
+}
+
 // Fetch season
 async function fetchSeason() {
     try {
         const response = await fetch(`${API_BASE}/season?t=${Date.now()}`);
         const data = await response.json();
-        
-        // if (data.timestamp > lastSeasonUpdate) {
-            // lastSeasonUpdate = data.timestamp;
-            document.getElementById('season').textContent = `Season: ${data.season}`;
-        // }
+        applySeason(data);
     } catch (error) {
         console.error('Error fetching season:', error);
     }
 }
 
+function applySeason(data) {
+    document.getElementById('season').textContent = `Season: ${data.season}`;
+}
+
 // Fetch quests
 async function fetchQuests() {
     try {
         const response = await fetch(`${API_BASE}/quests?t=${Date.now()}`);
         const data = await response.json();
-        
-        const questsDiv = document.getElementById('quests');
-        questsDiv.innerHTML = '';
-        
-        data.quests.forEach(quest => {
-            const div = document.createElement('div');
-            div.className = `quest ${quest.completed ? 'completed' : ''}`;
-            
-            div.innerHTML = `
-                ${quest.description}
-                ${quest.progress}/${quest.target} ${quest.completed ? '✓' : ''}
-            `;
-            
-            questsDiv.appendChild(div);
-        });
+        applyQuests(data);
     } catch (error) {
         console.error('Error fetching quests:', error);
     }
 }
 
+function applyQuests(data) {
+    const questsDiv = document.getElementById('quests');
+    questsDiv.innerHTML = '';
+    
+    data.quests.forEach(quest => {
+        const div = document.createElement('div');
+        div.className = `quest ${quest.completed ? 'completed' : ''}`;
+        
+        div.innerHTML = `
+            ${quest.description}
+            ${quest.progress}/${quest.target} ${quest.completed ? '✓' : ''}
+        `;
+        
+        questsDiv.appendChild(div);
+    });
+}
+
 // Fetch chat
 async function fetchChat() {
     try {
@@ -495,22 +678,30 @@ async function fetchChat() {
         const data = await response.json();
         
         console.log('Fetched chat:', data.messages ? data.messages.length : 0, 'messages');
-        const chatDiv = document.getElementById('chat-messages');
-        chatDiv.innerHTML = '';
-        
-        data.messages.forEach(msg => {
-            const div = document.createElement('div');
-            div.className = 'chat-message';
-            div.innerHTML = `${msg.username}: ${msg.message}`;
-            chatDiv.appendChild(div);
-        });
-        
-        chatDiv.scrollTop = chatDiv.scrollHeight;
+        document.getElementById('chat-messages').innerHTML = '';
+        appendChat(data.messages);
     } catch (error) {
         console.error('Error fetching chat:', error);
     }
 }
 
+function appendChat(messages) {
+    const chatDiv = document.getElementById('chat-messages');
+    
+    messages.forEach(msg => {
+        const div = document.createElement('div');
+        div.className = 'chat-message';
+        div.innerHTML = `${msg.username}: ${msg.message}`;
+        chatDiv.appendChild(div);
+    });
+    
+    // Same cap the server keeps
+    while (chatDiv.children.length > 100) {
+        chatDiv.removeChild(chatDiv.firstChild);
+    }
+    chatDiv.scrollTop = chatDiv.scrollHeight;
+}
+
 // Export functions
 async function exportPNG() {
     try {
@@ -532,28 +723,41 @@ async function exportPNG() {
 
 async function exportVideo() {
     if (!confirm('Generate video? This may take a minute...')) return;
-    
+    await runExport('video', 'canvas_replay.mp4', 'Failed to export video. Ensure FFmpeg is installed on the server.');
+}
+
+async function exportGIF() {
+    await runExport('gif', 'canvas_replay.gif', 'Failed to export GIF');
+}
+
+// Start (or join) a background export, poll until it is ready, then download it
+async function runExport(kind, filename, failureMessage) {
     try {
-        const response = await fetch(`${API_BASE}/export_video`);
+        let response = await fetch(`${API_BASE}/exports`, {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify({ kind })
+        });
+        let job = await response.json();
         
-        if (!response.ok) {
-            const data = await response.json();
-            alert(data.error || 'Failed to generate video');
-            return;
+        while (response.ok && (job.state === 'queued' || job.state === 'running')) {
+            await new Promise(resolve => setTimeout(resolve, 1000));
+            response = await fetch(`${API_BASE}/exports/${job.id}`);
+            job = await response.json();
         }
         
-        const blob = await response.blob();
+        if (!response.ok || job.state !== 'done') {
+            alert(job.error || failureMessage);
+            return;
+        }
         
-        const url = window.URL.createObjectURL(blob);
         const a = document.createElement('a');
-        a.href = url;
-        a.download = 'canvas_replay.mp4';
+        a.href = job.download;
+        a.download = filename;
         a.click();
-        
-        window.URL.revokeObjectURL(url);
     } catch (error) {
-        console.error('Error exporting video:', error);
-        alert('Failed to export video. Ensure FFmpeg is installed on the server.');
+        console.error(`Error exporting ${kind}:`, error);
+        alert(failureMessage);
     }
 }
 
@@ -0,0 +1,101 @@
+// Lookup throughput of the arena B+ tree across node fanouts and intra-node
+// search kernels (scalar, SSE4.1, AVX2 as far as the CPU supports them, and
+// the default NodeSearch::Best), each in its own tree instantiation. Keys are either
+// consecutive, like user IDs, or random 32-bit values; probes are random
+// existing keys, drawn up front.
+//
+//   cmake -S . -B build -DBUILD_BENCHMARKS=ON && cmake --build build
+//   ./build/bench_btree [keys] [lookups]
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "btree.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Million lookups/s
+template <uint32_t Fanout, typename Search>
+static double lookupRate(const std::vector<uint32_t>& keys, const std::vector<uint32_t>& probes, double& arenaMB) {
+    BTree<Fanout, Search> tree;
+    for (size_t i = 0; i < keys.size(); i++) {
+        tree.insert(keys[i], (int)i);
+    }
+    arenaMB = tree.arenaBytes() / 1048576.0;
+    
+    uint64_t checksum = 0;
+    auto start = Clock::now();
+    for (uint32_t key : probes) {
+        checksum += (uint32_t)tree.search(key);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (checksum == 0) {
+        std::cout << " (no hits?)";
+    }
+    return probes.size() / seconds / 1e6;
+}
+
+template <uint32_t Fanout>
+static void runFanout(const char* pattern, const std::vector<uint32_t>& keys, const std::vector<uint32_t>& probes) {
+    double arenaMB;
+    double rates[3];
+    NodeSearch::Level best = NodeSearch::bestLevel();
+    rates[0] = lookupRate<Fanout, NodeSearch::Scalar>(keys, probes, arenaMB);
+    if (best >= NodeSearch::Level::SSE41) {
+        rates[1] = lookupRate<Fanout, NodeSearch::SSE41>(keys, probes, arenaMB);
+    }
+    if (best >= NodeSearch::Level::AVX2) {
+        rates[2] = lookupRate<Fanout, NodeSearch::AVX2>(keys, probes, arenaMB);
+    }
+    double bestRate = lookupRate<Fanout, NodeSearch::Best>(keys, probes, arenaMB);
+    
+    std::cout << std::left << std::setw(12) << pattern << std::right << std::setw(6) << Fanout << std::setw(10)
+              << std::fixed << std::setprecision(1) << arenaMB;
+    for (int level = 0; level <= (int)best; level++) {
+        std::cout << std::setw(10) << std::setprecision(2) << rates[level];
+    }
+    std::cout << std::setw(10) << bestRate << std::endl;
+}
+
+template <uint32_t... Fanouts>
+static void runAll(const char* pattern, const std::vector<uint32_t>& keys, const std::vector<uint32_t>& probes) {
+    (runFanout<Fanouts>(pattern, keys, probes), ...);
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5000000;
+    if (count == 0) {
+        return 1;
+    }
+    
+    std::mt19937 rng(42);
+    std::vector<uint32_t> sequential(count);
+    for (size_t i = 0; i < count; i++) {
+        sequential[i] = (uint32_t)i + 1;
+    }
+    std::vector<uint32_t> random(count);
+    for (auto& key : random) {
+        key = rng();
+    }
+    std::vector<uint32_t> sequentialProbes(lookups);
+    std::vector<uint32_t> randomProbes(lookups);
+    for (size_t i = 0; i < lookups; i++) {
+        sequentialProbes[i] = sequential[rng() % count];
+        randomProbes[i] = random[rng() % count];
+    }
+    
+    std::cout << count << " keys, " << lookups << " lookups; million lookups/s per search kernel" << std::endl;
+    std::cout << "keys        fanout  arena MB";
+    for (int level = 0; level <= (int)NodeSearch::bestLevel(); level++) {
+        std::cout << std::setw(10) << NodeSearch::name((NodeSearch::Level)level);
+    }
+    std::cout << std::setw(10) << "best" << std::endl;
+    runAll<7, 15, 31, 63, 127, 255>("consecutive", sequential, sequentialProbes);
+    runAll<7, 15, 31, 63, 127, 255>("random", random, randomProbes);
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Database checkpoint cost, request tail latency and startup time at scale:
+// registers `users` accounts (every fourth with a session), then times a full
+// and an incremental checkpoint, measures request latency with and without
+// checkpoints running back to back next to the request threads, and finally
+// times reopening the database and looking users up in the mapped file.
+//
+//   cmake -S . -B build -DBUILD_BENCHMARKS=ON && cmake --build build
+//   ./build/bench_database [users] [request threads] [seconds per phase] [directory]
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <filesystem>
+#include "database.h"
+#include "logger.h"
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+static double secondsFor(Fn&& fn) {
+    auto start = Clock::now();
+    fn();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::string email(uint64_t i) {
+    return "user" + std::to_string(i) + "@bench";
+}
+
+// Request mix: session lookups (reads), logins/logouts and registrations
+// (writes, which wait for the log flush)
+static void runRequests(Database& db, int threads, double seconds, uint64_t users, std::atomic<uint64_t>& nextUser,
+                        std::vector<double>& reads, std::vector<double>& writes) {
+    std::vector<std::vector<double>> readsPerThread(threads);
+    std::vector<std::vector<double>> writesPerThread(threads);
+    std::vector<std::thread> workers;
+    auto end = Clock::now() + std::chrono::duration<double>(seconds);
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            while (Clock::now() < end) {
+                uint64_t user = rng() % users;
+                std::string session = "s" + std::to_string(user);
+                int op = rng() % 10;
+                auto start = Clock::now();
+                if (op < 7) {
+                    db.getUserById(db.getUserIdFromSession(session));
+                } else if (op < 9) {
+                    if (op == 7) {
+                        db.createSession(session, (uint32_t)user + 1);
+                    } else {
+                        db.removeSession(session);
+                    }
+                } else {
+                    uint64_t id = nextUser++;
+                    db.registerUser(email(id), "bench", "password");
+                }
+                double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+                (op < 7 ? readsPerThread : writesPerThread)[t].push_back(us);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto merge = [](std::vector<std::vector<double>>& perThread, std::vector<double>& out) {
+        out.clear();
+        for (auto& v : perThread) {
+            out.insert(out.end(), v.begin(), v.end());
+        }
+        std::sort(out.begin(), out.end());
+    };
+    merge(readsPerThread, reads);
+    merge(writesPerThread, writes);
+}
+
+static void printLatencies(const char* phase, const std::vector<double>& sorted) {
+    auto at = [&](double q) {
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(q * sorted.size()))];
+    };
+    std::cout << std::left << std::setw(22) << phase << std::right << std::setw(9) << sorted.size()
+              << std::fixed << std::setprecision(1) << std::setw(10) << at(0.5) << std::setw(10) << at(0.99)
+              << std::setw(10) << at(0.999) << std::setw(12) << (sorted.empty() ? 0.0 : sorted.back()) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t users = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 8;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 5;
+    std::filesystem::path directory = argc > 4 ? argv[4] : "bench_database.data";
+    Logger::setLevel(LogLevel::Warn);
+    
+    std::filesystem::remove_all(directory);
+    {
+        Database db((directory / "canvas.omni").string());
+        db.load();
+        
+        // Many registering threads, so the log's group commit batches their flushes
+        std::atomic<uint64_t> nextUser{0};
+        double populate = secondsFor([&] {
+            std::vector<std::thread> writers;
+            for (int t = 0; t < 64; t++) {
+                writers.emplace_back([&] {
+                    for (uint64_t i; (i = nextUser++) < users;) {
+                        uint32_t id = db.registerUser(email(i), "bench", "password");
+                        if (i % 4 == 0) {
+                            db.createSession("s" + std::to_string(i), id);
+                        }
+                    }
+                });
+            }
+            for (auto& writer : writers) {
+                writer.join();
+            }
+        });
+        nextUser = users;
+        std::cout << users << " users registered in " << std::fixed << std::setprecision(1) << populate << " s"
+                  << std::endl;
+        
+        double full = secondsFor([&] { db.save(); });
+        uint64_t fileSize = std::filesystem::file_size(directory / "canvas.omni");
+        for (uint64_t i = 0; i < 1000; i++) {
+            db.registerUser(email(nextUser++), "bench", "password");
+        }
+        double incremental = secondsFor([&] { db.checkpoint(); });
+        std::cout << "full checkpoint " << std::setprecision(1) << full * 1000 << " ms, after 1000 registrations "
+                  << incremental * 1000 << " ms (" << fileSize / (1 << 20) << " MB base file)" << std::endl;
+        
+        std::cout << "phase                      ops   p50 us    p99 us  p99.9 us      max us" << std::endl;
+        std::vector<double> reads;
+        std::vector<double> writes;
+        runRequests(db, threads, seconds, users, nextUser, reads, writes);
+        printLatencies("reads", reads);
+        printLatencies("writes", writes);
+        
+        std::atomic<bool> done{false};
+        std::vector<double> checkpoints;
+        std::thread checkpointer([&] {
+            while (!done) {
+                checkpoints.push_back(secondsFor([&] { db.save(); }) * 1000);
+            }
+        });
+        runRequests(db, threads, seconds, users, nextUser, reads, writes);
+        done = true;
+        checkpointer.join();
+        printLatencies("reads, checkpointing", reads);
+        printLatencies("writes, checkpointing", writes);
+        
+        double total = 0;
+        for (double ms : checkpoints) {
+            total += ms;
+        }
+        std::cout << checkpoints.size() << " checkpoints, " << std::setprecision(1)
+                  << (checkpoints.empty() ? 0.0 : total / checkpoints.size()) << " ms on average" << std::endl;
+    }
+    
+    // Reopen after the clean shutdown above: nothing left in the log
+    {
+        Database db((directory / "canvas.omni").string());
+        double startup = secondsFor([&] { db.load(); });
+        std::mt19937_64 rng(7);
+        const int lookups = 100000;
+        size_t found = 0;
+        double lookup = secondsFor([&] {
+            for (int i = 0; i < lookups; i++) {
+                found += db.getUserById((uint32_t)(rng() % users) + 1) != nullptr;
+            }
+        });
+        std::cout << "startup " << std::setprecision(2) << startup * 1000 << " ms, getUserById "
+                  << std::setprecision(0) << lookup * 1e9 / lookups << " ns (" << found << "/" << lookups
+                  << " found)" << std::endl;
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
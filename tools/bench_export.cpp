@@ -0,0 +1,72 @@
+// Replay export throughput against thread count: rasterizes the frames of a
+// synthetic episode the way the MP4 export feeds ffmpeg (the encoder itself
+// is left out) and encodes the same frames as an animated GIF, with the
+// frame work on a WorkStealingPool of 0..N workers (plus the calling thread).
+//
+//   cmake -S . -B build -DBUILD_BENCHMARKS=ON && cmake --build build
+//   ./build/bench_export [width] [height] [frames] [placements per frame] [max threads]
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "gif_export.h"
+#include "video_export.h"
+#include "work_stealing_pool.h"
+#include "logger.h"
+
+template <typename Fn>
+static double secondsFor(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 500;
+    int height = argc > 2 ? std::atoi(argv[2]) : 500;
+    int frameCount = argc > 3 ? std::atoi(argv[3]) : 90;
+    int placements = argc > 4 ? std::atoi(argv[4]) : 2000;
+    int maxThreads = argc > 5 ? std::atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+    Logger::setLevel(LogLevel::Warn);
+
+    // Same shape as an episode replay: every frame a few more placements
+    TileGrid board(width, height);
+    std::mt19937 rng(42);
+    std::vector<SnapshotHandle> frames;
+    uint64_t version = 1;
+    for (int f = 0; f < frameCount; f++) {
+        for (int p = 0; p < placements; p++) {
+            board.set(rng() % width, rng() % height, rng() % 16, PixelMood::Calm, 0, 1, version++);
+        }
+        frames.push_back(CanvasSnapshot::capture(board, frames.empty() ? nullptr : frames.back().get()));
+    }
+    int scale = VideoExport::scaleFor(width, height);
+    std::cout << width << "x" << height << " board (x" << scale << "), " << frameCount << " frames, "
+              << placements << " placements per frame" << std::endl;
+    std::cout << "workers  raster fps  gif fps   gif bytes" << std::endl;
+
+    for (int workers = 0; workers < std::max(1, maxThreads); workers++) {
+        WorkStealingPool pool(workers);
+
+        std::vector<std::vector<uint8_t>> buffers(2 * (workers + 1));
+        uint64_t checksum = 0;
+        double raster = secondsFor([&] {
+            pool.runOrdered(
+                frames.size(), buffers.size(),
+                [&](size_t slot, size_t i) { VideoExport::renderFrame(*frames[i], scale, buffers[slot]); },
+                [&](size_t slot, size_t) { checksum += buffers[slot][buffers[slot].size() / 2]; return true; });
+        });
+
+        std::string gif;
+        double encode = secondsFor([&] { GifExport::encode(frames, gif, pool); });
+
+        std::cout << std::setw(7) << workers << std::fixed << std::setprecision(1)
+                  << std::setw(12) << frameCount / raster << std::setw(10) << frameCount / encode
+                  << std::setw(12) << gif.size() << "   (" << checksum % 10 << ")" << std::endl;
+    }
+    return 0;
+}
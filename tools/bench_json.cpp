@@ -0,0 +1,152 @@
+// Allocation/throughput benchmark for the JSON response path: builds the
+// /api/canvas and /api/chat payloads the old way (std::stringstream) and with
+// JsonWriter, counting heap allocations via a replaced global operator new.
+//
+//   cmake -S . -B build -DBUILD_BENCHMARKS=ON && cmake --build build
+//   ./build/bench_json [pixels] [iterations]
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include "json_writer.h"
+
+static thread_local uint64_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct BenchPixel {
+    int x, y;
+    uint8_t color;
+    uint8_t mood;
+    uint64_t timestamp;
+    uint32_t userId;
+};
+
+struct BenchMessage {
+    std::string username;
+    std::string message;
+    uint64_t timestamp;
+};
+
+static size_t canvasStream(const std::vector<BenchPixel>& pixels) {
+    std::stringstream json;
+    json << "{\"pixels\":[";
+    bool first = true;
+    for (const auto& pixel : pixels) {
+        if (!first) json << ",";
+        first = false;
+        json << "{"
+             << "\"x\":" << pixel.x << ","
+             << "\"y\":" << pixel.y << ","
+             << "\"color\":" << (int)pixel.color << ","
+             << "\"mood\":" << (int)pixel.mood << ","
+             << "\"timestamp\":" << pixel.timestamp << ","
+             << "\"userId\":" << pixel.userId
+             << "}";
+    }
+    json << "],\"width\":50,\"height\":50,\"version\":1}";
+    return json.str().size();
+}
+
+static size_t canvasWriter(const std::vector<BenchPixel>& pixels) {
+    JsonWriter json;
+    json.beginObject().key("pixels").beginArray();
+    for (const auto& pixel : pixels) {
+        json.beginObject()
+            .field("x", pixel.x)
+            .field("y", pixel.y)
+            .field("color", (int)pixel.color)
+            .field("mood", (int)pixel.mood)
+            .field("timestamp", pixel.timestamp)
+            .field("userId", pixel.userId)
+            .endObject();
+    }
+    json.endArray().field("width", 50).field("height", 50).field("version", 1).endObject();
+    return json.size();
+}
+
+static size_t chatStream(const std::vector<BenchMessage>& messages) {
+    std::stringstream json;
+    json << "{\"messages\":[";
+    bool first = true;
+    for (const auto& msg : messages) {
+        if (!first) json << ",";
+        first = false;
+        json << "{"
+             << "\"username\":\"" << msg.username << "\","
+             << "\"message\":\"" << msg.message << "\","
+             << "\"timestamp\":" << msg.timestamp
+             << "}";
+    }
+    json << "]}";
+    return json.str().size();
+}
+
+static size_t chatWriter(const std::vector<BenchMessage>& messages) {
+    JsonWriter json;
+    json.beginObject().key("messages").beginArray();
+    for (const auto& msg : messages) {
+        json.beginObject()
+            .field("username", msg.username)
+            .field("message", msg.message)
+            .field("timestamp", msg.timestamp)
+            .endObject();
+    }
+    json.endArray().endObject();
+    return json.size();
+}
+
+template <typename Fn>
+static void run(const char* name, int iterations, Fn fn) {
+    size_t bytes = fn();  // Warm-up (fills the thread-local buffer)
+    
+    uint64_t allocsBefore = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        bytes = fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = g_allocations - allocsBefore;
+    
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::cout << name << ": " << bytes << " bytes, "
+              << (double)allocs / iterations << " allocs/request, "
+              << (uint64_t)ns << " ns/request" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int pixelCount = argc > 1 ? std::atoi(argv[1]) : 2500;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    
+    std::vector<BenchPixel> pixels;
+    pixels.reserve(pixelCount);
+    for (int i = 0; i < pixelCount; i++) {
+        pixels.push_back({i % 50, i / 50, (uint8_t)(i % 16), (uint8_t)(i % 5),
+                          1700000000000ULL + i, (uint32_t)(i * 7)});
+    }
+    
+    std::vector<BenchMessage> messages;
+    for (int i = 0; i < 100; i++) {
+        messages.push_back({"user" + std::to_string(i), "hello \"canvas\" #" + std::to_string(i),
+                            1700000000000ULL + i});
+    }
+    
+    std::cout << "canvas: " << pixelCount << " pixels, chat: " << messages.size()
+              << " messages, " << iterations << " iterations" << std::endl;
+    run("canvas stringstream", iterations, [&] { return canvasStream(pixels); });
+    run("canvas JsonWriter  ", iterations, [&] { return canvasWriter(pixels); });
+    run("chat stringstream  ", iterations * 10, [&] { return chatStream(messages); });
+    run("chat JsonWriter    ", iterations * 10, [&] { return chatWriter(messages); });
+    return 0;
+}